@@ -16,7 +16,7 @@
 #include "tag.h"
 #include "alloc.h"
 
-#define BLOCKING 1024
+#define BLOCKING ALLOC_SLAB_NODES
 
 union any_object {
 	struct object object;
@@ -31,37 +31,171 @@ struct alloc_state {
 	int nr;    /* number of nodes left in current allocation */
 	void *p;   /* first free node in current allocation */
 
-	/* bookkeeping of allocations */
-	void **slabs;
-	int slab_nr, slab_alloc;
+	/* position of the current slab in the pool's slab directory */
+	uint32_t slab_id;
 };
 
-struct alloc_state *allocate_alloc_state(void)
+struct alloc_arena {
+	struct alloc_state blob, tree, commit, tag, object;
+
+	/* the node that was allocated last, see alloc_node_index() */
+	const void *last_node;
+	uint32_t last_node_index;
+
+	/* commit indices reserved by a thread, see alloc_commit_node() */
+	unsigned int commit_index, commit_index_nr;
+};
+
+struct alloc_arena *allocate_alloc_arena(void)
 {
-	return xcalloc(1, sizeof(struct alloc_state));
+	return xcalloc(1, sizeof(struct alloc_arena));
+}
+
+void clear_alloc_slabs(struct parsed_object_pool *pool)
+{
+	uint32_t i;
+
+	for (i = 0; i < pool->alloc_slab_nr; i++)
+		free((void *)pool->alloc_slab_dir[i / ALLOC_DIR_SLABS]
+						 [i % ALLOC_DIR_SLABS].base);
+	for (i = 0; i < ALLOC_DIR_CHUNKS && pool->alloc_slab_dir; i++)
+		free(pool->alloc_slab_dir[i]);
+	FREE_AND_NULL(pool->alloc_slab_dir);
+	pool->alloc_slab_nr = 0;
 }
 
-void clear_alloc_state(struct alloc_state *s)
+/*
+ * The returned count is to be used as an index into commit slabs,
+ * that are *NOT* maintained per repository, and that is why a single
+ * global counter is used. While any pool has threads enabled, it is
+ * protected by a mutex.
+ */
+static unsigned int parsed_commits_count;
+static int commit_index_threads;
+static pthread_mutex_t commit_index_mutex;
+
+static unsigned int reserve_commit_indices(unsigned int nr)
 {
-	while (s->slab_nr > 0) {
-		s->slab_nr--;
-		free(s->slabs[s->slab_nr]);
+	unsigned int ret;
+
+	if (commit_index_threads)
+		pthread_mutex_lock(&commit_index_mutex);
+	ret = parsed_commits_count;
+	parsed_commits_count += nr;
+	if (commit_index_threads)
+		pthread_mutex_unlock(&commit_index_mutex);
+	return ret;
+}
+
+void alloc_enable_threads(struct parsed_object_pool *pool)
+{
+	static int initialized;
+
+	if (!HAVE_THREADS)
+		return;
+	if (pool->threads)
+		BUG("threads are already enabled for this pool");
+	if (!initialized) {
+		pthread_mutex_init(&commit_index_mutex, NULL);
+		initialized = 1;
 	}
+	commit_index_threads++;
 
-	FREE_AND_NULL(s->slabs);
+	pthread_mutex_init(&pool->alloc_mutex, NULL);
+	if (pthread_key_create(&pool->arena_key, NULL))
+		die(_("unable to create thread-local storage"));
+	pool->threads = 1;
 }
 
-static inline void *alloc_node(struct alloc_state *s, size_t node_size)
+void alloc_disable_threads(struct parsed_object_pool *pool)
+{
+	int i;
+
+	if (!pool->threads)
+		return;
+
+	/*
+	 * The slabs of the thread arenas stay in the directory; only the
+	 * nodes they have left are given up.
+	 */
+	for (i = 0; i < pool->thread_arenas_nr; i++) {
+		struct alloc_arena *a = pool->thread_arenas[i];
+
+		pool->alloc_arena->blob.count += a->blob.count;
+		pool->alloc_arena->tree.count += a->tree.count;
+		pool->alloc_arena->commit.count += a->commit.count;
+		pool->alloc_arena->tag.count += a->tag.count;
+		pool->alloc_arena->object.count += a->object.count;
+		free(a);
+	}
+	FREE_AND_NULL(pool->thread_arenas);
+	pool->thread_arenas_nr = pool->thread_arenas_alloc = 0;
+
+	pthread_key_delete(pool->arena_key);
+	pthread_mutex_destroy(&pool->alloc_mutex);
+	pool->threads = 0;
+	commit_index_threads--;
+}
+
+static struct alloc_arena *current_arena(struct parsed_object_pool *pool)
+{
+	struct alloc_arena *a;
+
+	if (!pool->threads)
+		return pool->alloc_arena;
+
+	a = pthread_getspecific(pool->arena_key);
+	if (!a) {
+		a = allocate_alloc_arena();
+		pthread_mutex_lock(&pool->alloc_mutex);
+		ALLOC_GROW(pool->thread_arenas, pool->thread_arenas_nr + 1,
+			   pool->thread_arenas_alloc);
+		pool->thread_arenas[pool->thread_arenas_nr++] = a;
+		pthread_mutex_unlock(&pool->alloc_mutex);
+		pthread_setspecific(pool->arena_key, a);
+	}
+	return a;
+}
+
+static uint32_t add_slab(struct parsed_object_pool *pool,
+			 void *base, size_t node_size)
+{
+	struct alloc_slab **chunk;
+	uint32_t nr;
+
+	if (pool->threads)
+		pthread_mutex_lock(&pool->alloc_mutex);
+
+	nr = pool->alloc_slab_nr;
+	if (nr >= UINT32_MAX / BLOCKING)
+		die(_("too many objects"));
+	if (!pool->alloc_slab_dir)
+		CALLOC_ARRAY(pool->alloc_slab_dir, ALLOC_DIR_CHUNKS);
+	chunk = &pool->alloc_slab_dir[nr / ALLOC_DIR_SLABS];
+	if (!*chunk)
+		CALLOC_ARRAY(*chunk, ALLOC_DIR_SLABS);
+	(*chunk)[nr % ALLOC_DIR_SLABS].base = base;
+	(*chunk)[nr % ALLOC_DIR_SLABS].node_size = node_size;
+	pool->alloc_slab_nr++;
+
+	if (pool->threads)
+		pthread_mutex_unlock(&pool->alloc_mutex);
+	return nr;
+}
+
+static inline void *alloc_node(struct parsed_object_pool *pool,
+			       struct alloc_arena *a,
+			       struct alloc_state *s, size_t node_size)
 {
 	void *ret;
 
 	if (!s->nr) {
 		s->nr = BLOCKING;
 		s->p = xmalloc(BLOCKING * node_size);
-
-		ALLOC_GROW(s->slabs, s->slab_nr + 1, s->slab_alloc);
-		s->slabs[s->slab_nr++] = s->p;
+		s->slab_id = add_slab(pool, s->p, node_size);
 	}
+	a->last_node = s->p;
+	a->last_node_index = s->slab_id * BLOCKING + (BLOCKING - s->nr);
 	s->nr--;
 	s->count++;
 	ret = s->p;
@@ -71,55 +205,97 @@ static inline void *alloc_node(struct alloc_state *s, size_t node_size)
 	return ret;
 }
 
+uint32_t alloc_node_index(struct parsed_object_pool *pool, const void *node)
+{
+	struct alloc_arena *a = current_arena(pool);
+	uint32_t i, nr, ret = UINT32_MAX;
+
+	/* This is the common case of create_object(alloc_*_node()). */
+	if (node == a->last_node)
+		return a->last_node_index;
+
+	if (pool->threads)
+		pthread_mutex_lock(&pool->alloc_mutex);
+	nr = pool->alloc_slab_nr;
+	if (pool->threads)
+		pthread_mutex_unlock(&pool->alloc_mutex);
+
+	for (i = 0; i < nr; i++) {
+		const struct alloc_slab *slab =
+			&pool->alloc_slab_dir[i / ALLOC_DIR_SLABS][i % ALLOC_DIR_SLABS];
+		const char *p = node;
+
+		if (slab->base <= p && p < slab->base + BLOCKING * slab->node_size) {
+			ret = i * BLOCKING + (p - slab->base) / slab->node_size;
+			break;
+		}
+	}
+	if (ret == UINT32_MAX)
+		BUG("object was not allocated from this pool");
+	return ret;
+}
+
 void *alloc_blob_node(struct repository *r)
 {
-	struct blob *b = alloc_node(r->parsed_objects->blob_state, sizeof(struct blob));
+	struct alloc_arena *a = current_arena(r->parsed_objects);
+	struct blob *b = alloc_node(r->parsed_objects, a, &a->blob,
+				    sizeof(struct blob));
 	b->object.type = OBJ_BLOB;
 	return b;
 }
 
 void *alloc_tree_node(struct repository *r)
 {
-	struct tree *t = alloc_node(r->parsed_objects->tree_state, sizeof(struct tree));
+	struct alloc_arena *a = current_arena(r->parsed_objects);
+	struct tree *t = alloc_node(r->parsed_objects, a, &a->tree,
+				    sizeof(struct tree));
 	t->object.type = OBJ_TREE;
 	return t;
 }
 
 void *alloc_tag_node(struct repository *r)
 {
-	struct tag *t = alloc_node(r->parsed_objects->tag_state, sizeof(struct tag));
+	struct alloc_arena *a = current_arena(r->parsed_objects);
+	struct tag *t = alloc_node(r->parsed_objects, a, &a->tag,
+				   sizeof(struct tag));
 	t->object.type = OBJ_TAG;
 	return t;
 }
 
 void *alloc_object_node(struct repository *r)
 {
-	struct object *obj = alloc_node(r->parsed_objects->object_state, sizeof(union any_object));
+	struct alloc_arena *a = current_arena(r->parsed_objects);
+	struct object *obj = alloc_node(r->parsed_objects, a, &a->object,
+					sizeof(union any_object));
 	obj->type = OBJ_NONE;
 	return obj;
 }
 
-/*
- * The returned count is to be used as an index into commit slabs,
- * that are *NOT* maintained per repository, and that is why a single
- * global counter is used.
- */
-static unsigned int alloc_commit_index(void)
-{
-	static unsigned int parsed_commits_count;
-	return parsed_commits_count++;
-}
-
 void init_commit_node(struct commit *c)
 {
 	c->object.type = OBJ_COMMIT;
-	c->index = alloc_commit_index();
+	c->index = reserve_commit_indices(1);
 }
 
 void *alloc_commit_node(struct repository *r)
 {
-	struct commit *c = alloc_node(r->parsed_objects->commit_state, sizeof(struct commit));
-	init_commit_node(c);
+	struct alloc_arena *a = current_arena(r->parsed_objects);
+	struct commit *c = alloc_node(r->parsed_objects, a, &a->commit,
+				      sizeof(struct commit));
+
+	if (!r->parsed_objects->threads) {
+		init_commit_node(c);
+		return c;
+	}
+
+	/* Threads take their commit indices in blocks, too. */
+	if (!a->commit_index_nr) {
+		a->commit_index = reserve_commit_indices(BLOCKING);
+		a->commit_index_nr = BLOCKING;
+	}
+	c->object.type = OBJ_COMMIT;
+	c->index = a->commit_index++;
+	a->commit_index_nr--;
 	return c;
 }
 
@@ -130,8 +306,8 @@ static void report(const char *name, unsigned int count, size_t size)
 }
 
 #define REPORT(name, type)	\
-    report(#name, r->parsed_objects->name##_state->count, \
-		  r->parsed_objects->name##_state->count * sizeof(type) >> 10)
+    report(#name, r->parsed_objects->alloc_arena->name.count, \
+		  r->parsed_objects->alloc_arena->name.count * sizeof(type) >> 10)
 
 void alloc_report(struct repository *r)
 {
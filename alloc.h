@@ -1,7 +1,16 @@
 #ifndef ALLOC_H
 #define ALLOC_H
 
-struct alloc_state;
+#include "object.h"
+
+/* Objects are allocated in slabs of this many nodes. */
+#define ALLOC_SLAB_NODES 1024
+
+/* The pool's slab directory is made of chunks of this many slabs. */
+#define ALLOC_DIR_SLABS 1024
+#define ALLOC_DIR_CHUNKS (UINT32_MAX / ALLOC_SLAB_NODES / ALLOC_DIR_SLABS + 1)
+
+struct alloc_arena;
 struct tree;
 struct commit;
 struct tag;
@@ -15,7 +24,39 @@ void *alloc_tag_node(struct repository *r);
 void *alloc_object_node(struct repository *r);
 void alloc_report(struct repository *r);
 
-struct alloc_state *allocate_alloc_state(void);
-void clear_alloc_state(struct alloc_state *s);
+struct alloc_arena *allocate_alloc_arena(void);
+void clear_alloc_slabs(struct parsed_object_pool *pool);
+
+/*
+ * Let several threads allocate nodes from `pool` at once. Each thread
+ * then allocates from slabs of its own, and only takes the pool's
+ * `alloc_mutex` to register a new slab in the directory. Must be called
+ * before the threads are started, and undone with alloc_disable_threads()
+ * after they are finished.
+ */
+void alloc_enable_threads(struct parsed_object_pool *pool);
+void alloc_disable_threads(struct parsed_object_pool *pool);
+
+/*
+ * Every node allocated for a parsed_object_pool has a 32-bit index:
+ * the position of its slab in the pool's slab directory times
+ * ALLOC_SLAB_NODES plus its position within the slab. The object hash
+ * table stores these indices instead of pointers.
+ *
+ * The directory is never reallocated, so that alloc_indexed_node() can
+ * be used without a lock while other threads add slabs.
+ */
+uint32_t alloc_node_index(struct parsed_object_pool *pool, const void *node);
+
+static inline struct object *alloc_indexed_node(struct parsed_object_pool *pool,
+						uint32_t index)
+{
+	uint32_t nr = index / ALLOC_SLAB_NODES;
+	const struct alloc_slab *slab =
+		&pool->alloc_slab_dir[nr / ALLOC_DIR_SLABS][nr % ALLOC_DIR_SLABS];
+
+	return (struct object *)(slab->base +
+				 (index % ALLOC_SLAB_NODES) * slab->node_size);
+}
 
 #endif
@@ -478,13 +478,48 @@ static void attr_stack_free(struct attr_stack *e)
 	free(e);
 }
 
-static void drop_attr_stack(struct attr_stack **stack)
+/*
+ * Parsed attribute stacks are shared by all attr_check instances.  Each
+ * directory that has been looked at maps to the chain of frames that
+ * applies to it, from its own .gitattributes down to the builtin frame.
+ * Frames are never modified once they are in the cache, so the chain of
+ * a subdirectory simply points at the chain of its parent, and a chain
+ * can be used without holding any lock.  Everything is thrown away at
+ * once by drop_all_attr_stacks().
+ */
+struct attr_stack_dir {
+	struct hashmap_entry ent;
+	const struct index_state *istate;
+	const struct attr_stack *stack;
+	size_t dirlen;
+	char dir[FLEX_ARRAY];
+};
+
+static struct attr_stack_cache {
+	struct hashmap map;
+	/* $GIT_DIR/info/attributes, which goes on top of every chain */
+	struct attr_stack *info;
+	/* every frame in the map, for freeing */
+	struct attr_stack **frames;
+	size_t frames_nr, frames_alloc;
+	int initialized;
+	pthread_mutex_t mutex;
+} attr_stack_cache;
+
+static void free_attr_stack_cache(void)
 {
-	while (*stack) {
-		struct attr_stack *elem = *stack;
-		*stack = elem->prev;
-		attr_stack_free(elem);
-	}
+	struct attr_stack_cache *c = &attr_stack_cache;
+	size_t i;
+
+	if (!c->initialized)
+		return;
+	for (i = 0; i < c->frames_nr; i++)
+		attr_stack_free(c->frames[i]);
+	FREE_AND_NULL(c->frames);
+	c->frames_nr = c->frames_alloc = 0;
+	c->info = NULL;
+	hashmap_free_entries(&c->map, struct attr_stack_dir, ent);
+	c->initialized = 0;
 }
 
 /* List of all attr_check structs; access should be surrounded by mutex */
@@ -548,8 +583,9 @@ static void drop_all_attr_stacks(void)
 	vector_lock();
 
 	for (i = 0; i < check_vector.nr; i++) {
-		drop_attr_stack(&check_vector.checks[i]->stack);
+		check_vector.checks[i]->stack_dir = NULL;
 	}
+	free_attr_stack_cache();
 
 	vector_unlock();
 }
@@ -640,7 +676,7 @@ void attr_check_clear(struct attr_check *check)
 	FREE_AND_NULL(check->all_attrs);
 	check->all_attrs_nr = 0;
 
-	drop_attr_stack(&check->stack);
+	check->stack_dir = NULL;
 }
 
 void attr_check_free(struct attr_check *check)
@@ -808,10 +844,8 @@ static void debug_set(const char *what, const char *match, struct git_attr *attr
 		what, attr->name, (char *) value, match);
 }
 #define debug_push(a) debug_info("push", (a))
-#define debug_pop(a) debug_info("pop", (a))
 #else
 #define debug_push(a) do { ; } while (0)
-#define debug_pop(a) do { ; } while (0)
 #define debug_set(a,b,c,d) do { ; } while (0)
 #endif /* DEBUG_ATTR */
 
@@ -847,140 +881,175 @@ static void push_stack(struct attr_stack **attr_stack_p,
 			elem->originlen = originlen;
 		elem->prev = *attr_stack_p;
 		*attr_stack_p = elem;
+		debug_push(elem);
+		ALLOC_GROW(attr_stack_cache.frames,
+			   attr_stack_cache.frames_nr + 1,
+			   attr_stack_cache.frames_alloc);
+		attr_stack_cache.frames[attr_stack_cache.frames_nr++] = elem;
 	}
 }
 
-static void bootstrap_attr_stack(const struct index_state *istate,
-				 struct attr_stack **stack)
+struct attr_stack_dir_key {
+	const struct index_state *istate;
+	const char *dir;
+	size_t dirlen;
+};
+
+static int attr_stack_dir_cmp(const void *unused_cmp_data,
+			      const struct hashmap_entry *eptr,
+			      const struct hashmap_entry *unused_entry_or_key,
+			      const void *keydata)
 {
-	struct attr_stack *e;
+	const struct attr_stack_dir *a;
+	const struct attr_stack_dir_key *key = keydata;
 
-	if (*stack)
-		return;
+	a = container_of(eptr, const struct attr_stack_dir, ent);
+
+	return a->istate != key->istate || a->dirlen != key->dirlen ||
+		memcmp(a->dir, key->dir, a->dirlen);
+}
+
+static struct attr_stack_dir *add_attr_stack_dir(const struct index_state *istate,
+						 const char *dir, size_t dirlen,
+						 struct attr_stack *stack)
+{
+	struct attr_stack_dir *e;
+
+	FLEX_ALLOC_MEM(e, dir, dir, dirlen);
+	hashmap_entry_init(&e->ent, memhash(dir, dirlen));
+	e->istate = istate;
+	e->dirlen = dirlen;
+	e->stack = stack;
+	hashmap_add(&attr_stack_cache.map, &e->ent);
+	return e;
+}
+
+static struct attr_stack_dir *find_attr_stack_dir(const struct index_state *istate,
+						  const char *dir, size_t dirlen)
+{
+	struct attr_stack_dir_key key = { istate, dir, dirlen };
+
+	return hashmap_get_entry_from_hash(&attr_stack_cache.map,
+					   memhash(dir, dirlen), &key,
+					   struct attr_stack_dir, ent);
+}
+
+/*
+ * At the bottom of the attribute stack is the built-in set of
+ * attribute definitions, followed by the contents of
+ * $(prefix)/etc/gitattributes and a file specified by
+ * core.attributesfile, and then .gitattributes of the root
+ * directory.  $GIT_DIR/info/attributes is kept aside in
+ * attr_stack_cache.info, to be consulted before any of them.
+ */
+static struct attr_stack_dir *bootstrap_attr_stack(const struct index_state *istate)
+{
+	struct attr_stack *stack = NULL;
+	struct attr_stack *e;
 
 	/* builtin frame */
 	e = read_attr_from_array(builtin_attr);
-	push_stack(stack, e, NULL, 0);
+	push_stack(&stack, e, NULL, 0);
 
 	/* system-wide frame */
 	if (git_attr_system()) {
 		e = read_attr_from_file(git_etc_gitattributes(), 1);
-		push_stack(stack, e, NULL, 0);
+		push_stack(&stack, e, NULL, 0);
 	}
 
 	/* home directory */
 	if (get_home_gitattributes()) {
 		e = read_attr_from_file(get_home_gitattributes(), 1);
-		push_stack(stack, e, NULL, 0);
+		push_stack(&stack, e, NULL, 0);
 	}
 
 	/* root directory */
 	e = read_attr(istate, GITATTRIBUTES_FILE, 1);
-	push_stack(stack, e, xstrdup(""), 0);
+	push_stack(&stack, e, xstrdup(""), 0);
 
 	/* info frame */
-	if (startup_info->have_repository)
-		e = read_attr_from_file(git_path_info_attributes(), 1);
-	else
-		e = NULL;
-	if (!e)
-		e = xcalloc(1, sizeof(struct attr_stack));
-	push_stack(stack, e, NULL, 0);
+	if (!attr_stack_cache.info) {
+		struct attr_stack *info = NULL;
+
+		if (startup_info->have_repository)
+			e = read_attr_from_file(git_path_info_attributes(), 1);
+		else
+			e = NULL;
+		if (!e)
+			e = xcalloc(1, sizeof(struct attr_stack));
+		push_stack(&info, e, NULL, 0);
+		attr_stack_cache.info = info;
+	}
+
+	return add_attr_stack_dir(istate, "", 0, stack);
 }
 
-static void prepare_attr_stack(const struct index_state *istate,
-			       const char *path, int dirlen,
-			       struct attr_stack **stack)
+/*
+ * Return the cache entry for the directory "path[0..dirlen)", reading
+ * the .gitattributes files of it and of its leading directories as
+ * needed.  Must be called with attr_stack_cache.mutex held.
+ */
+static struct attr_stack_dir *get_attr_stack_dir(const struct index_state *istate,
+						 const char *path, int dirlen)
 {
-	struct attr_stack *info;
+	struct attr_stack_dir *parent, *e;
+	struct attr_stack *stack;
 	struct strbuf pathbuf = STRBUF_INIT;
+	int len;
 
-	/*
-	 * At the bottom of the attribute stack is the built-in
-	 * set of attribute definitions, followed by the contents
-	 * of $(prefix)/etc/gitattributes and a file specified by
-	 * core.attributesfile.  Then, contents from
-	 * .gitattributes files from directories closer to the
-	 * root to the ones in deeper directories are pushed
-	 * to the stack.  Finally, at the very top of the stack
-	 * we always keep the contents of $GIT_DIR/info/attributes.
-	 *
-	 * When checking, we use entries from near the top of the
-	 * stack, preferring $GIT_DIR/info/attributes, then
-	 * .gitattributes in deeper directories to shallower ones,
-	 * and finally use the built-in set as the default.
-	 */
-	bootstrap_attr_stack(istate, stack);
+	e = find_attr_stack_dir(istate, path, dirlen);
+	if (e)
+		return e;
+	if (!dirlen)
+		return bootstrap_attr_stack(istate);
 
-	/*
-	 * Pop the "info" one that is always at the top of the stack.
-	 */
-	info = *stack;
-	*stack = info->prev;
+	/* Build up from the nearest leading directory we know about */
+	for (len = dirlen - 1; len > 0 && !is_dir_sep(path[len]); len--)
+		;
+	parent = get_attr_stack_dir(istate, path, len);
 
-	/*
-	 * Pop the ones from directories that are not the prefix of
-	 * the path we are checking. Break out of the loop when we see
-	 * the root one (whose origin is an empty string "") or the builtin
-	 * one (whose origin is NULL) without popping it.
-	 */
-	while ((*stack)->origin) {
-		int namelen = (*stack)->originlen;
-		struct attr_stack *elem;
-
-		elem = *stack;
-		if (namelen <= dirlen &&
-		    !strncmp(elem->origin, path, namelen) &&
-		    (!namelen || path[namelen] == '/'))
-			break;
+	strbuf_add(&pathbuf, path, dirlen);
+	strbuf_addf(&pathbuf, "/%s", GITATTRIBUTES_FILE);
+	stack = (struct attr_stack *)parent->stack;
+	push_stack(&stack, read_attr(istate, pathbuf.buf, 0),
+		   xmemdupz(path, dirlen), dirlen);
+	strbuf_release(&pathbuf);
 
-		debug_pop(elem);
-		*stack = elem->prev;
-		attr_stack_free(elem);
-	}
+	return add_attr_stack_dir(istate, path, dirlen, stack);
+}
 
-	/*
-	 * bootstrap_attr_stack() should have added, and the
-	 * above loop should have stopped before popping, the
-	 * root element whose attr_stack->origin is set to an
-	 * empty string.
-	 */
-	assert((*stack)->origin);
-
-	strbuf_addstr(&pathbuf, (*stack)->origin);
-	/* Build up to the directory 'path' is in */
-	while (pathbuf.len < dirlen) {
-		size_t len = pathbuf.len;
-		struct attr_stack *next;
-		char *origin;
-
-		/* Skip path-separator */
-		if (len < dirlen && is_dir_sep(path[len]))
-			len++;
-		/* Find the end of the next component */
-		while (len < dirlen && !is_dir_sep(path[len]))
-			len++;
-
-		if (pathbuf.len > 0)
-			strbuf_addch(&pathbuf, '/');
-		strbuf_add(&pathbuf, path + pathbuf.len, (len - pathbuf.len));
-		strbuf_addf(&pathbuf, "/%s", GITATTRIBUTES_FILE);
-
-		next = read_attr(istate, pathbuf.buf, 0);
-
-		/* reset the pathbuf to not include "/.gitattributes" */
-		strbuf_setlen(&pathbuf, len);
-
-		origin = xstrdup(pathbuf.buf);
-		push_stack(stack, next, origin, len);
-	}
+/*
+ * Return the chain of frames that applies to the directory
+ * "path[0..dirlen)", without the info frame.  Frames for the
+ * .gitattributes files from directories closer to the root come after
+ * those of deeper directories in the chain.
+ *
+ * When checking, we use entries from near the top of the
+ * stack, preferring $GIT_DIR/info/attributes, then
+ * .gitattributes in deeper directories to shallower ones,
+ * and finally use the built-in set as the default.
+ */
+static const struct attr_stack *prepare_attr_stack(const struct index_state *istate,
+						   const char *path, int dirlen,
+						   struct attr_check *check)
+{
+	const struct attr_stack_dir *e = check->stack_dir;
 
-	/*
-	 * Finally push the "info" one at the top of the stack.
-	 */
-	push_stack(stack, info, NULL, 0);
+	/* Paths are often checked in order; reuse the last directory */
+	if (e && e->istate == istate && e->dirlen == dirlen &&
+	    !memcmp(e->dir, path, dirlen))
+		return e->stack;
 
-	strbuf_release(&pathbuf);
+	pthread_mutex_lock(&attr_stack_cache.mutex);
+	if (!attr_stack_cache.initialized) {
+		hashmap_init(&attr_stack_cache.map, attr_stack_dir_cmp, NULL, 0);
+		attr_stack_cache.initialized = 1;
+	}
+	e = get_attr_stack_dir(istate, path, dirlen);
+	pthread_mutex_unlock(&attr_stack_cache.mutex);
+
+	check->stack_dir = e;
+	return e->stack;
 }
 
 static int path_matches(const char *pathname, int pathlen,
@@ -1095,6 +1164,7 @@ static void collect_some_attrs(const struct index_state *istate,
 	int pathlen, rem, dirlen;
 	const char *cp, *last_slash = NULL;
 	int basename_offset;
+	const struct attr_stack *stack, *info;
 
 	for (cp = path; *cp; cp++) {
 		if (*cp == '/' && cp[1])
@@ -1109,12 +1179,15 @@ static void collect_some_attrs(const struct index_state *istate,
 		dirlen = 0;
 	}
 
-	prepare_attr_stack(istate, path, dirlen, &check->stack);
+	stack = prepare_attr_stack(istate, path, dirlen, check);
+	info = attr_stack_cache.info;
 	all_attrs_init(&g_attr_hashmap, check);
-	determine_macros(check->all_attrs, check->stack);
+	determine_macros(check->all_attrs, info);
+	determine_macros(check->all_attrs, stack);
 
 	rem = check->all_attrs_nr;
-	fill(path, pathlen, basename_offset, check->stack, check->all_attrs, rem);
+	rem = fill(path, pathlen, basename_offset, info, check->all_attrs, rem);
+	fill(path, pathlen, basename_offset, stack, check->all_attrs, rem);
 }
 
 void git_check_attr(const struct index_state *istate,
@@ -1157,4 +1230,5 @@ void attr_start(void)
 {
 	pthread_mutex_init(&g_attr_hashmap.mutex, NULL);
 	pthread_mutex_init(&check_vector.mutex, NULL);
+	pthread_mutex_init(&attr_stack_cache.mutex, NULL);
 }
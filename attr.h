@@ -120,7 +120,7 @@ struct git_attr;
 
 /* opaque structures used internally for attribute collection */
 struct all_attrs_item;
-struct attr_stack;
+struct attr_stack_dir;
 struct index_state;
 
 /*
@@ -169,7 +169,7 @@ struct attr_check {
 	struct attr_check_item *items;
 	int all_attrs_nr;
 	struct all_attrs_item *all_attrs;
-	struct attr_stack *stack;
+	const struct attr_stack_dir *stack_dir;
 };
 
 struct attr_check *attr_check_alloc(void);
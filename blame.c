@@ -11,6 +11,12 @@
 #include "commit-slab.h"
 #include "bloom.h"
 #include "commit-graph.h"
+#include "thread-utils.h"
+#include "lockfile.h"
+#include "quote.h"
+#include "oid-array.h"
+#include "blob.h"
+#include "oidset.h"
 
 define_commit_slab(blame_suspects, struct blame_origin *);
 static struct blame_suspects blame_suspects;
@@ -301,6 +307,7 @@ static struct commit *fake_working_tree_commit(struct repository *r,
 
 
 static int diff_hunks(mmfile_t *file_a, mmfile_t *file_b,
+		      xdlinehash_t *hash_a, xdlinehash_t *hash_b,
 		      xdl_emit_hunk_consume_func_t hunk_func, void *cb_data, int xdl_opts)
 {
 	xpparam_t xpp = {0};
@@ -308,6 +315,8 @@ static int diff_hunks(mmfile_t *file_a, mmfile_t *file_b,
 	xdemitcb_t ecb = {NULL};
 
 	xpp.flags = xdl_opts;
+	xpp.line_hash1 = hash_a;
+	xpp.line_hash2 = hash_b;
 	xecfg.hunk_func = hunk_func;
 	ecb.priv = cb_data;
 	return xdi_diff(file_a, file_b, &xpp, &xecfg, &ecb);
@@ -1026,7 +1035,7 @@ static void fill_origin_blob(struct diff_options *opt,
 		if (opt->flags.allow_textconv &&
 		    textconv_object(opt->repo, o->path, o->mode,
 				    &o->blob_oid, 1, &file->ptr, &file_size))
-			;
+			o->file_textconv = 1;
 		else
 			file->ptr = read_object_file(&o->blob_oid, &type,
 						     &file_size);
@@ -1044,6 +1053,19 @@ static void fill_origin_blob(struct diff_options *opt,
 		fill_origin_fingerprints(o);
 }
 
+/*
+ * The blob of an origin is usually diffed at least twice, once against
+ * its parent and once as the parent of its child, and against every
+ * unblamed chunk with -C; keep its line hashes around.
+ */
+static xdlinehash_t *origin_line_hash(struct blame_scoreboard *sb,
+				      struct blame_origin *o)
+{
+	if (o->file_textconv || is_null_oid(&o->blob_oid))
+		return NULL;
+	return xdiff_line_cache_get(&sb->line_cache, &o->blob_oid);
+}
+
 static void drop_origin_blob(struct blame_origin *o)
 {
 	FREE_AND_NULL(o->file.ptr);
@@ -1958,7 +1980,9 @@ static void pass_blame_to_parent(struct blame_scoreboard *sb,
 			 &sb->num_read_blob, ignore_diffs);
 	sb->num_get_patch++;
 
-	if (diff_hunks(&file_p, &file_o, blame_chunk_cb, &d, sb->xdl_opts))
+	if (diff_hunks(&file_p, &file_o,
+		       origin_line_hash(sb, parent), origin_line_hash(sb, target),
+		       blame_chunk_cb, &d, sb->xdl_opts))
 		die("unable to generate diff (%s -> %s)",
 		    oid_to_hex(&parent->commit->object.oid),
 		    oid_to_hex(&target->commit->object.oid));
@@ -2084,42 +2108,188 @@ static int handle_split_cb(long start_a, long count_a,
 	return 0;
 }
 
+/*
+ * The hunks of the diff between a blob and the lines of one blame
+ * entry, as computed ahead of time by a worker thread.
+ */
+struct blame_hunks {
+	struct blame_hunk {
+		long start_a, count_a, start_b, count_b;
+	} *hunk;
+	int nr, alloc;
+};
+
+static int record_hunk_cb(long start_a, long count_a,
+			  long start_b, long count_b, void *data)
+{
+	struct blame_hunks *hunks = data;
+	struct blame_hunk *h;
+
+	ALLOC_GROW(hunks->hunk, hunks->nr + 1, hunks->alloc);
+	h = &hunks->hunk[hunks->nr++];
+	h->start_a = start_a;
+	h->count_a = count_a;
+	h->start_b = start_b;
+	h->count_b = count_b;
+	return 0;
+}
+
+/*
+ * Prepare mmfile that contains only the lines in ent.
+ */
+static void fill_entry_file(struct blame_scoreboard *sb,
+			    struct blame_entry *ent, mmfile_t *file)
+{
+	const char *cp = blame_nth_line(sb, ent->lno);
+
+	file->ptr = (char *) cp;
+	file->size = blame_nth_line(sb, ent->lno + ent->num_lines) - cp;
+}
+
 /*
  * Find the lines from parent that are the same as ent so that
  * we can pass blames to it.  file_p has the blob contents for
- * the parent.
+ * the parent.  If "hunks" is given, it holds the result of the
+ * diff, which then is not run again.
  */
 static void find_copy_in_blob(struct blame_scoreboard *sb,
 			      struct blame_entry *ent,
 			      struct blame_origin *parent,
 			      struct blame_entry *split,
-			      mmfile_t *file_p)
+			      mmfile_t *file_p,
+			      const struct blame_hunks *hunks)
 {
-	const char *cp;
 	mmfile_t file_o;
 	struct handle_split_cb_data d;
+	int i;
 
 	memset(&d, 0, sizeof(d));
 	d.sb = sb; d.ent = ent; d.parent = parent; d.split = split;
-	/*
-	 * Prepare mmfile that contains only the lines in ent.
-	 */
-	cp = blame_nth_line(sb, ent->lno);
-	file_o.ptr = (char *) cp;
-	file_o.size = blame_nth_line(sb, ent->lno + ent->num_lines) - cp;
+	fill_entry_file(sb, ent, &file_o);
 
 	/*
 	 * file_o is a part of final image we are annotating.
 	 * file_p partially may match that image.
 	 */
 	memset(split, 0, sizeof(struct blame_entry [3]));
-	if (diff_hunks(file_p, &file_o, handle_split_cb, &d, sb->xdl_opts))
+	if (hunks) {
+		for (i = 0; i < hunks->nr; i++)
+			handle_split_cb(hunks->hunk[i].start_a,
+					hunks->hunk[i].count_a,
+					hunks->hunk[i].start_b,
+					hunks->hunk[i].count_b, &d);
+	} else if (diff_hunks(file_p, &file_o, origin_line_hash(sb, parent), NULL,
+			      handle_split_cb, &d, sb->xdl_opts))
 		die("unable to generate diff (%s)",
 		    oid_to_hex(&parent->commit->object.oid));
 	/* remainder, if any, all match the preimage */
 	handle_split(sb, ent, d.tlno, d.plno, ent->num_lines, parent, split);
 }
 
+struct copy_diff_data {
+	struct blame_scoreboard *sb;
+	struct blame_entry **ents;
+	struct blame_hunks *hunks;
+	mmfile_t *file_p;
+	xdlinehash_t *hash_p;
+	int nr, nr_threads, thread;
+	int failed;
+};
+
+static void *copy_diff_worker(void *data)
+{
+	struct copy_diff_data *cd = data;
+	int i;
+
+	for (i = cd->thread; i < cd->nr; i += cd->nr_threads) {
+		mmfile_t file_o;
+
+		fill_entry_file(cd->sb, cd->ents[i], &file_o);
+		if (diff_hunks(cd->file_p, &file_o, cd->hash_p, NULL,
+			       record_hunk_cb, &cd->hunks[i], cd->sb->xdl_opts)) {
+			cd->failed = 1;
+			break;
+		}
+	}
+	return NULL;
+}
+
+/*
+ * Run the diffs find_copy_in_blob() needs for the "nr" entries in
+ * "ents" in worker threads, and return their hunks for replaying them
+ * in the original order, so that the result does not depend on the
+ * scheduling.  Returns NULL when this is not worth it.
+ */
+static struct blame_hunks *diff_entries_in_threads(struct blame_scoreboard *sb,
+						   struct blame_entry **ents,
+						   int nr,
+						   struct blame_origin *parent,
+						   mmfile_t *file_p)
+{
+	int nr_threads = sb->num_threads < nr ? sb->num_threads : nr;
+	struct copy_diff_data *cd;
+	struct blame_hunks *hunks;
+	xdlinehash_t *hash_p;
+	pthread_t *threads;
+	int i, failed = 0;
+
+	if (nr_threads <= 1)
+		return NULL;
+
+	/*
+	 * The line hashes of the parent can be shared only when they
+	 * already cover all of it, as otherwise the threads would
+	 * fight over filling them in.
+	 */
+	hash_p = origin_line_hash(sb, parent);
+	if (hash_p &&
+	    (hash_p->flags != (sb->xdl_opts & XDF_WHITESPACE_FLAGS) ||
+	     !hash_p->ends ||
+	     (hash_p->nrec ? hash_p->ends[hash_p->nrec - 1] : 0) != file_p->size))
+		hash_p = NULL;
+
+	CALLOC_ARRAY(hunks, nr);
+	CALLOC_ARRAY(cd, nr_threads);
+	ALLOC_ARRAY(threads, nr_threads);
+	for (i = 0; i < nr_threads; i++) {
+		int err;
+
+		cd[i].sb = sb;
+		cd[i].ents = ents;
+		cd[i].hunks = hunks;
+		cd[i].file_p = file_p;
+		cd[i].hash_p = hash_p;
+		cd[i].nr = nr;
+		cd[i].nr_threads = nr_threads;
+		cd[i].thread = i;
+		err = pthread_create(&threads[i], NULL, copy_diff_worker, &cd[i]);
+		if (err)
+			die(_("unable to create threaded blame (%s)"),
+			    strerror(err));
+	}
+	for (i = 0; i < nr_threads; i++) {
+		pthread_join(threads[i], NULL);
+		failed |= cd[i].failed;
+	}
+	free(threads);
+	free(cd);
+	if (failed)
+		die("unable to generate diff (%s)",
+		    oid_to_hex(&parent->commit->object.oid));
+	return hunks;
+}
+
+static void free_blame_hunks(struct blame_hunks *hunks, int nr)
+{
+	int i;
+
+	if (!hunks)
+		return;
+	for (i = 0; i < nr; i++)
+		free(hunks[i].hunk);
+	free(hunks);
+}
+
 /* Move all blame entries from list *source that have a score smaller
  * than score_min to the front of list *small.
  * Returns a pointer to the link pointing to the old head of the small list.
@@ -2162,6 +2332,7 @@ static void find_move_in_parent(struct blame_scoreboard *sb,
 	struct blame_entry *unblamed = target->suspects;
 	struct blame_entry *leftover = NULL;
 	mmfile_t file_p;
+	int i;
 
 	if (!unblamed)
 		return; /* nothing remains for this target */
@@ -2178,10 +2349,22 @@ static void find_move_in_parent(struct blame_scoreboard *sb,
 	 */
 	do {
 		struct blame_entry **unblamedtail = &unblamed;
-		struct blame_entry *next;
-		for (e = unblamed; e; e = next) {
+		struct blame_entry *next, **ents = NULL;
+		struct blame_hunks *hunks = NULL;
+		int nr = 0, alloc = 0;
+
+		if (sb->num_threads > 1) {
+			for (e = unblamed; e; e = e->next) {
+				ALLOC_GROW(ents, nr + 1, alloc);
+				ents[nr++] = e;
+			}
+			hunks = diff_entries_in_threads(sb, ents, nr,
+							parent, &file_p);
+		}
+		for (e = unblamed, i = 0; e; e = next, i++) {
 			next = e->next;
-			find_copy_in_blob(sb, e, parent, split, &file_p);
+			find_copy_in_blob(sb, e, parent, split, &file_p,
+					  hunks ? &hunks[i] : NULL);
 			if (split[1].suspect &&
 			    sb->move_score < blame_entry_score(sb, &split[1])) {
 				split_blame(blamed, &unblamedtail, split, e);
@@ -2191,6 +2374,8 @@ static void find_move_in_parent(struct blame_scoreboard *sb,
 			}
 			decref_split(split);
 		}
+		free_blame_hunks(hunks, nr);
+		free(ents);
 		*unblamedtail = NULL;
 		toosmall = filter_small(sb, toosmall, &unblamed, sb->move_score);
 	} while (unblamed);
@@ -2277,6 +2462,7 @@ static void find_copy_in_parent(struct blame_scoreboard *sb,
 
 	do {
 		struct blame_entry **unblamedtail = &unblamed;
+		struct blame_entry **ents = NULL;
 		blame_list = setup_blame_list(unblamed, &num_ents);
 
 		for (i = 0; i < diff_queued_diff.nr; i++) {
@@ -2284,6 +2470,7 @@ static void find_copy_in_parent(struct blame_scoreboard *sb,
 			struct blame_origin *norigin;
 			mmfile_t file_p;
 			struct blame_entry potential[3];
+			struct blame_hunks *hunks = NULL;
 
 			if (!DIFF_FILE_VALID(p->one))
 				continue; /* does not exist in parent */
@@ -2301,13 +2488,24 @@ static void find_copy_in_parent(struct blame_scoreboard *sb,
 			if (!file_p.ptr)
 				continue;
 
+			if (sb->num_threads > 1 && num_ents > 1) {
+				if (!ents) {
+					ALLOC_ARRAY(ents, num_ents);
+					for (j = 0; j < num_ents; j++)
+						ents[j] = blame_list[j].ent;
+				}
+				hunks = diff_entries_in_threads(sb, ents, num_ents,
+								norigin, &file_p);
+			}
 			for (j = 0; j < num_ents; j++) {
 				find_copy_in_blob(sb, blame_list[j].ent,
-						  norigin, potential, &file_p);
+						  norigin, potential, &file_p,
+						  hunks ? &hunks[j] : NULL);
 				copy_split_if_better(sb, blame_list[j].split,
 						     potential);
 				decref_split(potential);
 			}
+			free_blame_hunks(hunks, num_ents);
 			blame_origin_decref(norigin);
 		}
 
@@ -2323,6 +2521,7 @@ static void find_copy_in_parent(struct blame_scoreboard *sb,
 			}
 			decref_split(split);
 		}
+		free(ents);
 		free(blame_list);
 		*unblamedtail = NULL;
 		toosmall = filter_small(sb, toosmall, &unblamed, sb->copy_score);
@@ -2344,6 +2543,7 @@ static void pass_whole_blame(struct blame_scoreboard *sb,
 	if (!porigin->file.ptr && origin->file.ptr) {
 		/* Steal its file */
 		porigin->file = origin->file;
+		porigin->file_textconv = origin->file_textconv;
 		origin->file.ptr = NULL;
 	}
 	suspects = origin->suspects;
@@ -2579,6 +2779,256 @@ static void pass_blame(struct blame_scoreboard *sb, struct blame_origin *origin,
 		free(sg_origin);
 }
 
+/*
+ * Final blame of whole files, stored per commit and path so that a
+ * later run reaching the same blob does not dig through its history
+ * again.  Every file starts with a version line, followed by one line
+ * per blame entry in line number order:
+ *
+ *	<lno> <num_lines> <s_lno> <flags> <commit>\t<path>
+ *
+ * optionally followed by "previous <commit>\t<path>" for the suspect.
+ *
+ * Every suspect of the walk is looked up, so the names of the files in
+ * the cache are listed once up front, and only those are opened.
+ */
+struct blame_cache {
+	char *dir;
+	char *key;
+	struct oidset entries;
+	int hits;
+	int stores;
+};
+
+#define BLAME_CACHE_SIGNATURE "blame-cache 1"
+#define BLAME_CACHE_IGNORED	01
+#define BLAME_CACHE_UNBLAMABLE	02
+
+struct cached_blame {
+	int lno;
+	int num_lines;
+	int s_lno;
+	unsigned flags;
+	struct commit *commit;
+	char *path;
+	struct commit *prev_commit;
+	char *prev_path;
+};
+
+static void blame_cache_name(struct blame_cache *cache, struct object_id *out,
+			     const struct object_id *oid, const char *path)
+{
+	git_hash_ctx ctx;
+
+	the_hash_algo->init_fn(&ctx);
+	the_hash_algo->update_fn(&ctx, cache->key, strlen(cache->key) + 1);
+	the_hash_algo->update_fn(&ctx, oid->hash, the_hash_algo->rawsz);
+	the_hash_algo->update_fn(&ctx, path, strlen(path) + 1);
+	the_hash_algo->final_fn(out->hash, &ctx);
+}
+
+static void blame_cache_path(struct blame_cache *cache, struct strbuf *out,
+			     const struct object_id *name)
+{
+	strbuf_reset(out);
+	strbuf_addf(out, "%s/%s", cache->dir, oid_to_hex(name));
+}
+
+static int parse_cached_commit_path(struct repository *r, const char *p,
+				    struct commit **commit, char **path)
+{
+	struct object_id oid;
+	struct strbuf buf = STRBUF_INIT;
+
+	if (parse_oid_hex(p, &oid, &p) || *p++ != '\t')
+		return -1;
+	if (*p == '"') {
+		if (unquote_c_style(&buf, p, NULL))
+			return -1;
+		*path = strbuf_detach(&buf, NULL);
+	} else
+		*path = xstrdup(p);
+	*commit = lookup_commit(r, &oid);
+	if (!*commit || parse_commit(*commit)) {
+		FREE_AND_NULL(*path);
+		return -1;
+	}
+	return 0;
+}
+
+static void free_cached_blame(struct cached_blame *c, int nr)
+{
+	int i;
+
+	for (i = 0; i < nr; i++) {
+		free(c[i].path);
+		free(c[i].prev_path);
+	}
+	free(c);
+}
+
+/*
+ * Read the cached blame of the whole of origin's blob.  Returns the
+ * number of entries, or -1 when there is no usable cache file.
+ */
+static int read_blame_cache(struct blame_scoreboard *sb,
+			    struct blame_origin *origin,
+			    struct cached_blame **result)
+{
+	struct strbuf buf = STRBUF_INIT;
+	struct cached_blame *c = NULL;
+	int nr = 0, alloc = 0, next_lno = 0;
+	struct object_id name;
+	FILE *fp;
+
+	blame_cache_name(sb->cache, &name, &origin->commit->object.oid,
+			 origin->path);
+	if (!oidset_contains(&sb->cache->entries, &name))
+		return -1;
+	blame_cache_path(sb->cache, &buf, &name);
+	fp = fopen(buf.buf, "r");
+	if (!fp) {
+		strbuf_release(&buf);
+		return -1;
+	}
+	if (strbuf_getline(&buf, fp) || strcmp(buf.buf, BLAME_CACHE_SIGNATURE))
+		goto corrupt;
+
+	while (!strbuf_getline(&buf, fp)) {
+		const char *p = buf.buf;
+		char *end;
+		struct cached_blame *e;
+
+		if (skip_prefix(p, "previous ", &p)) {
+			if (!nr || c[nr - 1].prev_commit ||
+			    parse_cached_commit_path(sb->repo, p,
+						     &c[nr - 1].prev_commit,
+						     &c[nr - 1].prev_path))
+				goto corrupt;
+			continue;
+		}
+
+		ALLOC_GROW(c, nr + 1, alloc);
+		e = &c[nr];
+		memset(e, 0, sizeof(*e));
+		e->lno = strtol(p, &end, 10);
+		if (*end != ' ' || e->lno != next_lno)
+			goto corrupt;
+		e->num_lines = strtol(end + 1, &end, 10);
+		if (*end != ' ' || e->num_lines <= 0)
+			goto corrupt;
+		e->s_lno = strtol(end + 1, &end, 10);
+		if (*end != ' ' || e->s_lno < 0)
+			goto corrupt;
+		e->flags = strtoul(end + 1, &end, 10);
+		if (*end != ' ' ||
+		    parse_cached_commit_path(sb->repo, end + 1,
+					     &e->commit, &e->path))
+			goto corrupt;
+		nr++;
+		next_lno += e->num_lines;
+	}
+	if (!nr)
+		goto corrupt;
+
+	fclose(fp);
+	strbuf_release(&buf);
+	*result = c;
+	return nr;
+
+corrupt:
+	fclose(fp);
+	strbuf_release(&buf);
+	free_cached_blame(c, nr);
+	return -1;
+}
+
+static struct blame_entry *add_cached_piece(struct blame_scoreboard *sb,
+					    struct blame_entry *e,
+					    struct cached_blame *c,
+					    int lno, int num_lines)
+{
+	struct blame_entry *n = xcalloc(1, sizeof(*n));
+	struct blame_origin *o = get_origin(c->commit, c->path);
+
+	if (!o->previous && c->prev_commit)
+		o->previous = get_origin(c->prev_commit, c->prev_path);
+	/* treat root commit as boundary */
+	if (!c->commit->parents && !sb->show_root)
+		c->commit->object.flags |= UNINTERESTING;
+	o->guilty = 1;
+
+	n->suspect = o;
+	n->lno = e->lno + (lno - e->s_lno);
+	n->num_lines = num_lines;
+	n->s_lno = c->s_lno + (lno - c->lno);
+	n->ignored = e->ignored || (c->flags & BLAME_CACHE_IGNORED);
+	n->unblamable = e->unblamable || (c->flags & BLAME_CACHE_UNBLAMABLE);
+
+	if (sb->found_guilty_entry)
+		sb->found_guilty_entry(n, sb->found_guilty_entry_data);
+	n->next = sb->ent;
+	sb->ent = n;
+	return n;
+}
+
+/*
+ * If the final blame of the whole blob of "origin" is in the cache,
+ * move all of its suspects to the scoreboard, split up according to
+ * the cached entries, and return 1.
+ */
+static int use_blame_cache(struct blame_scoreboard *sb,
+			   struct blame_origin *origin)
+{
+	struct cached_blame *c;
+	struct blame_entry *e;
+	int nr, num_lines;
+
+	nr = read_blame_cache(sb, origin, &c);
+	if (nr < 0)
+		return 0;
+
+	/* the cached entries cover every line of the blob */
+	num_lines = c[nr - 1].lno + c[nr - 1].num_lines;
+	for (e = origin->suspects; e; e = e->next)
+		if (e->s_lno < 0 || num_lines < e->s_lno + e->num_lines) {
+			free_cached_blame(c, nr);
+			return 0;
+		}
+
+	e = origin->suspects;
+	origin->suspects = NULL;
+	while (e) {
+		struct blame_entry *next = e->next;
+		int lno = e->s_lno, end = e->s_lno + e->num_lines;
+		int lo = 0, hi = nr;
+
+		/* the cached entry covering the first line of e */
+		while (hi - lo > 1) {
+			int mi = lo + (hi - lo) / 2;
+			if (c[mi].lno <= lno)
+				lo = mi;
+			else
+				hi = mi;
+		}
+		while (lno < end) {
+			int stop = c[lo].lno + c[lo].num_lines;
+			if (end < stop)
+				stop = end;
+			add_cached_piece(sb, e, &c[lo], lno, stop - lno);
+			lno = stop;
+			lo++;
+		}
+		blame_origin_decref(e->suspect);
+		free(e);
+		e = next;
+	}
+
+	free_cached_blame(c, nr);
+	sb->cache->hits++;
+	return 1;
+}
+
 /*
  * The main loop -- while we have blobs with lines whose true origin
  * is still unknown, pick one blob, and allow its lines to pass blames
@@ -2609,7 +3059,9 @@ void assign_blame(struct blame_scoreboard *sb, int opt)
 		 */
 		blame_origin_incref(suspect);
 		parse_commit(commit);
-		if (sb->reverse ||
+		if (sb->cache && use_blame_cache(sb, suspect))
+			; /* all suspects went to the scoreboard */
+		else if (sb->reverse ||
 		    (!(commit->object.flags & UNINTERESTING) &&
 		     !(revs->max_age != -1 && commit->date < revs->max_age)))
 			pass_blame(sb, suspect, opt);
@@ -2761,6 +3213,8 @@ void init_scoreboard(struct blame_scoreboard *sb)
 	memset(sb, 0, sizeof(struct blame_scoreboard));
 	sb->move_score = BLAME_DEFAULT_MOVE_SCORE;
 	sb->copy_score = BLAME_DEFAULT_COPY_SCORE;
+	sb->num_threads = 1;
+	xdiff_line_cache_init(&sb->line_cache, BLAME_LINE_CACHE_BUDGET);
 }
 
 void setup_scoreboard(struct blame_scoreboard *sb,
@@ -2914,8 +3368,133 @@ void setup_blame_bloom_data(struct blame_scoreboard *sb,
 	sb->bloom_data = bd;
 }
 
+static int add_ignored_rev(const struct object_id *oid, void *data)
+{
+	strbuf_addf(data, " %s", oid_to_hex(oid));
+	return 0;
+}
+
+static void list_blame_cache(struct blame_cache *cache)
+{
+	DIR *dir = opendir(cache->dir);
+	struct dirent *de;
+
+	oidset_init(&cache->entries, 0);
+	if (!dir)
+		return;
+	while ((de = readdir(dir)) != NULL) {
+		struct object_id oid;
+
+		if (!get_oid_hex(de->d_name, &oid) &&
+		    !de->d_name[the_hash_algo->hexsz])
+			oidset_insert(&cache->entries, &oid);
+	}
+	closedir(dir);
+}
+
+void setup_blame_cache(struct blame_scoreboard *sb)
+{
+	struct blame_cache *cache = xcalloc(1, sizeof(*cache));
+	struct strbuf key = STRBUF_INIT;
+	git_hash_ctx ctx;
+	unsigned char hash[GIT_MAX_RAWSZ];
+
+	cache->dir = repo_git_path(sb->repo, "blame-cache");
+	list_blame_cache(cache);
+
+	/* grafts, replace refs and shallow commits change who is to blame */
+	sb->repo->hash_algo->init_fn(&ctx);
+	hash_commit_parent_rewrites(sb->repo, &ctx);
+	sb->repo->hash_algo->final_fn(hash, &ctx);
+
+	strbuf_addf(&key, "xdl=%d first-parent=%d textconv=%d rename=%d history=%s",
+		    sb->xdl_opts, sb->revs->first_parent_only,
+		    sb->revs->diffopt.flags.allow_textconv,
+		    !sb->no_whole_file_rename, hash_to_hex(hash));
+	if (oidset_size(&sb->ignore_list)) {
+		struct oid_array revs = OID_ARRAY_INIT;
+		struct oidset_iter iter;
+		const struct object_id *oid;
+
+		oidset_iter_init(&sb->ignore_list, &iter);
+		while ((oid = oidset_iter_next(&iter)))
+			oid_array_append(&revs, oid);
+		strbuf_addstr(&key, " ignore");
+		oid_array_for_each_unique(&revs, add_ignored_rev, &key);
+		oid_array_clear(&revs);
+	}
+	cache->key = strbuf_detach(&key, NULL);
+
+	sb->cache = cache;
+}
+
+void write_blame_cache(struct blame_scoreboard *sb)
+{
+	struct commit *commit = sb->final;
+	struct lock_file lk = LOCK_INIT;
+	struct strbuf buf = STRBUF_INIT;
+	struct object_id name;
+	struct blame_entry *ent;
+	FILE *fp;
+
+	if (is_null_oid(&commit->object.oid)) {
+		struct object_id head_oid, oid;
+		unsigned short mode;
+
+		/*
+		 * The working tree file can stand in for its only
+		 * parent only when it is unchanged.
+		 */
+		if (!commit->parents || commit->parents->next)
+			return;
+		commit = commit->parents->item;
+		if (get_tree_entry(sb->repo, &commit->object.oid, sb->path,
+				   &head_oid, &mode))
+			return;
+		hash_object_file(the_hash_algo, sb->final_buf,
+				 sb->final_buf_size, blob_type, &oid);
+		if (!oideq(&oid, &head_oid))
+			return;
+	}
+
+	blame_cache_name(sb->cache, &name, &commit->object.oid, sb->path);
+	blame_cache_path(sb->cache, &buf, &name);
+	if (safe_create_leading_directories(buf.buf) ||
+	    hold_lock_file_for_update(&lk, buf.buf, 0) < 0) {
+		strbuf_release(&buf);
+		return;
+	}
+
+	fp = fdopen_lock_file(&lk, "w");
+	fprintf(fp, "%s\n", BLAME_CACHE_SIGNATURE);
+	for (ent = sb->ent; ent; ent = ent->next) {
+		struct blame_origin *suspect = ent->suspect;
+
+		fprintf(fp, "%d %d %d %u %s\t", ent->lno, ent->num_lines,
+			ent->s_lno,
+			(ent->ignored ? BLAME_CACHE_IGNORED : 0) |
+			(ent->unblamable ? BLAME_CACHE_UNBLAMABLE : 0),
+			oid_to_hex(&suspect->commit->object.oid));
+		quote_c_style(suspect->path, NULL, fp, 0);
+		fputc('\n', fp);
+		if (suspect->previous) {
+			fprintf(fp, "previous %s\t",
+				oid_to_hex(&suspect->previous->commit->object.oid));
+			quote_c_style(suspect->previous->path, NULL, fp, 0);
+			fputc('\n', fp);
+		}
+	}
+	if (commit_lock_file(&lk))
+		error_errno(_("unable to write blame cache %s"), buf.buf);
+	else
+		sb->cache->stores++;
+	strbuf_release(&buf);
+}
+
 void cleanup_scoreboard(struct blame_scoreboard *sb)
 {
+	xdiff_line_cache_clear(&sb->line_cache);
+
 	if (sb->bloom_data) {
 		int i;
 		for (i = 0; i < sb->bloom_data->nr; i++) {
@@ -2930,4 +3509,15 @@ void cleanup_scoreboard(struct blame_scoreboard *sb)
 		trace2_data_intmax("blame", sb->repo,
 				   "bloom/response-no", bloom_count_no);
 	}
+
+	if (sb->cache) {
+		trace2_data_intmax("blame", sb->repo,
+				   "cache/hits", sb->cache->hits);
+		trace2_data_intmax("blame", sb->repo,
+				   "cache/stores", sb->cache->stores);
+		free(sb->cache->dir);
+		free(sb->cache->key);
+		oidset_clear(&sb->cache->entries);
+		FREE_AND_NULL(sb->cache);
+	}
 }
@@ -16,6 +16,8 @@
 #define BLAME_DEFAULT_MOVE_SCORE	20
 #define BLAME_DEFAULT_COPY_SCORE	40
 
+#define BLAME_LINE_CACHE_BUDGET		(64 * 1024 * 1024)
+
 struct fingerprint;
 
 /*
@@ -57,6 +59,8 @@ struct blame_origin {
 	struct fingerprint *fingerprints;
 	struct object_id blob_oid;
 	unsigned short mode;
+	/* `file' holds the textconv output rather than the blob */
+	char file_textconv;
 	/* guilty gets set when shipping any suspects to the final
 	 * blame list instead of other commits
 	 */
@@ -101,6 +105,7 @@ struct blame_entry {
 };
 
 struct blame_bloom_data;
+struct blame_cache;
 
 /*
  * The current state of the blame assignment.
@@ -153,12 +158,21 @@ struct blame_scoreboard {
 	int no_whole_file_rename;
 	int debug;
 
+	/* worker threads for the diffs of copy and move detection */
+	int num_threads;
+
 	/* callbacks */
 	void(*on_sanity_fail)(struct blame_scoreboard *, int);
 	void(*found_guilty_entry)(struct blame_entry *, void *);
 
 	void *found_guilty_entry_data;
 	struct blame_bloom_data *bloom_data;
+
+	/* line hashes of the blobs diffed so far */
+	struct xdiff_line_cache line_cache;
+
+	/* final blame of whole files from earlier runs */
+	struct blame_cache *cache;
 };
 
 /*
@@ -185,6 +199,8 @@ void setup_scoreboard(struct blame_scoreboard *sb,
 		      struct blame_origin **orig);
 void setup_blame_bloom_data(struct blame_scoreboard *sb,
 			    const char *path);
+void setup_blame_cache(struct blame_scoreboard *sb);
+void write_blame_cache(struct blame_scoreboard *sb);
 void cleanup_scoreboard(struct blame_scoreboard *sb);
 
 struct blame_entry *blame_entry_prepend(struct blame_entry *head,
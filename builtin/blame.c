@@ -26,6 +26,7 @@
 #include "progress.h"
 #include "object-store.h"
 #include "blame.h"
+#include "thread-utils.h"
 #include "refs.h"
 #include "tag.h"
 
@@ -56,6 +57,8 @@ static int coloring_mode;
 static struct string_list ignore_revs_file_list = STRING_LIST_INIT_NODUP;
 static int mark_unblamable_lines;
 static int mark_ignored_lines;
+static int num_threads = 1;
+static int blame_cache;
 
 static struct date_mode blame_date_mode = { DATE_ISO8601 };
 static size_t blame_date_width;
@@ -725,6 +728,17 @@ static int git_blame_config(const char *var, const char *value, void *cb)
 		mark_ignored_lines = git_config_bool(var, value);
 		return 0;
 	}
+	if (!strcmp(var, "blame.threads")) {
+		num_threads = git_config_int(var, value);
+		if (num_threads < 0)
+			die(_("invalid number of threads specified (%d) for %s"),
+			    num_threads, var);
+		return 0;
+	}
+	if (!strcmp(var, "blame.cache")) {
+		blame_cache = git_config_bool(var, value);
+		return 0;
+	}
 	if (!strcmp(var, "color.blame.repeatedlines")) {
 		if (color_parse_mem(value, strlen(value), repeated_meta_color))
 			warning(_("invalid color '%s' in color.blame.repeatedLines"),
@@ -804,6 +818,16 @@ static int is_a_rev(const char *name)
 	return OBJ_NONE < oid_object_info(the_repository, &oid, NULL);
 }
 
+static int has_uninteresting_pending(struct rev_info *revs)
+{
+	int i;
+
+	for (i = 0; i < revs->pending.nr; i++)
+		if (revs->pending.objects[i].item->flags & UNINTERESTING)
+			return 1;
+	return 0;
+}
+
 static int peel_to_commit_oid(struct object_id *oid_ret, void *cbdata)
 {
 	struct repository *r = ((struct blame_scoreboard *)cbdata)->repo;
@@ -897,6 +921,7 @@ int cmd_blame(int argc, const char **argv, const char *prefix)
 	struct parse_opt_ctx_t ctx;
 	int cmd_is_annotate = !strcmp(argv[0], "annotate");
 	struct range_set ranges;
+	int whole_file;
 	unsigned int range_i;
 	long anchor;
 	const int hexsz = the_hash_algo->hexsz;
@@ -1080,6 +1105,10 @@ int cmd_blame(int argc, const char **argv, const char *prefix)
 	sb.contents_from = contents_from;
 	sb.reverse = reverse;
 	sb.repo = the_repository;
+	if (!HAVE_THREADS)
+		sb.num_threads = 1;
+	else
+		sb.num_threads = num_threads ? num_threads : online_cpus();
 	build_ignorelist(&sb, &ignore_revs_file_list, &ignore_rev_list);
 	string_list_clear(&ignore_revs_file_list, 0);
 	string_list_clear(&ignore_rev_list, 0);
@@ -1119,6 +1148,8 @@ int cmd_blame(int argc, const char **argv, const char *prefix)
 		anchor = top + 1;
 	}
 	sort_and_merge_range_set(&ranges);
+	whole_file = lno && ranges.nr == 1 &&
+		ranges.ranges[0].start == 0 && ranges.ranges[0].end == lno;
 
 	for (range_i = ranges.nr; range_i > 0; --range_i) {
 		const struct range *r = &ranges.ranges[range_i - 1];
@@ -1155,19 +1186,31 @@ int cmd_blame(int argc, const char **argv, const char *prefix)
 	if (show_progress)
 		pi.progress = start_delayed_progress(_("Blaming lines"), sb.num_lines);
 
+	/*
+	 * Move and copy detection depend on how the lines still to be
+	 * blamed are split up, so only plain blame can reuse the final
+	 * blame of a commit that an earlier run started from.
+	 */
+	if (blame_cache && !opt && !reverse && !revs_file &&
+	    revs.max_age == -1 && !has_uninteresting_pending(&revs))
+		setup_blame_cache(&sb);
+
 	assign_blame(&sb, opt);
 
 	stop_progress(&pi.progress);
 
+	if (!incremental || (sb.cache && whole_file)) {
+		blame_sort_final(&sb);
+		blame_coalesce(&sb);
+		if (sb.cache && whole_file)
+			write_blame_cache(&sb);
+	}
+
 	if (!incremental)
 		setup_pager();
 	else
 		return 0;
 
-	blame_sort_final(&sb);
-
-	blame_coalesce(&sb);
-
 	if (!(output_option & (OUTPUT_COLOR_LINE | OUTPUT_SHOW_AGE_WITH_COLOR)))
 		output_option |= coloring_mode;
 
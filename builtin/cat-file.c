@@ -488,6 +488,62 @@ static int batch_unordered_packed(const struct object_id *oid,
 	return batch_unordered_object(oid, data);
 }
 
+static void batch_one_line(char *line, struct strbuf *output,
+			   struct batch_options *opt, struct expand_data *data)
+{
+	if (data->split_on_whitespace) {
+		/*
+		 * Split at first whitespace, tying off the beginning
+		 * of the string and saving the remainder (or NULL) in
+		 * data->rest.
+		 */
+		char *p = strpbrk(line, " \t");
+		if (p) {
+			while (*p && strchr(" \t", *p))
+				*p++ = '\0';
+		}
+		data->rest = p;
+	}
+
+	batch_one_object(line, output, opt, data);
+}
+
+/*
+ * With --buffer, nobody waits for the answer to one line before sending
+ * the next, so lines can be read ahead in groups of this many. The type
+ * and size of the objects they name that are missing locally are then
+ * asked from the promisor remotes with a single request.
+ */
+#define OBJECT_INFO_BATCH 512
+
+static void batch_lines(struct string_list *lines, struct strbuf *output,
+			struct batch_options *opt, struct expand_data *data)
+{
+	struct oid_array missing = OID_ARRAY_INIT;
+	struct string_list_item *item;
+
+	for_each_string_list_item(item, lines) {
+		struct object_id oid;
+		const char *end;
+
+		if (parse_oid_hex(item->string, &oid, &end) ||
+		    (*end && !isspace(*end)))
+			continue;
+		if (oid_object_info_extended(the_repository, &oid, NULL,
+					     OBJECT_INFO_QUICK |
+					     OBJECT_INFO_SKIP_FETCH_OBJECT))
+			oid_array_append(&missing, &oid);
+	}
+	if (missing.nr)
+		promisor_remote_get_object_info_many(the_repository,
+						     missing.oid, missing.nr);
+	oid_array_clear(&missing);
+
+	for_each_string_list_item(item, lines)
+		batch_one_line(item->string, output, opt, data);
+	string_list_clear(lines, 0);
+}
+
 static int batch_objects(struct batch_options *opt)
 {
 	struct strbuf input = STRBUF_INIT;
@@ -570,22 +626,20 @@ static int batch_objects(struct batch_options *opt)
 	save_warning = warn_on_object_refname_ambiguity;
 	warn_on_object_refname_ambiguity = 0;
 
-	while (strbuf_getline(&input, stdin) != EOF) {
-		if (data.split_on_whitespace) {
-			/*
-			 * Split at first whitespace, tying off the beginning
-			 * of the string and saving the remainder (or NULL) in
-			 * data.rest.
-			 */
-			char *p = strpbrk(input.buf, " \t");
-			if (p) {
-				while (*p && strchr(" \t", *p))
-					*p++ = '\0';
-			}
-			data.rest = p;
-		}
+	if (opt->buffer_output && !opt->print_contents &&
+	    !data.info.disk_sizep && !data.info.delta_base_oid &&
+	    has_promisor_remote()) {
+		struct string_list lines = STRING_LIST_INIT_DUP;
 
-		batch_one_object(input.buf, &output, opt, &data);
+		while (strbuf_getline(&input, stdin) != EOF) {
+			string_list_append(&lines, input.buf);
+			if (lines.nr == OBJECT_INFO_BATCH)
+				batch_lines(&lines, &output, opt, &data);
+		}
+		batch_lines(&lines, &output, opt, &data);
+	} else {
+		while (strbuf_getline(&input, stdin) != EOF)
+			batch_one_line(input.buf, &output, opt, &data);
 	}
 
 	strbuf_release(&input);
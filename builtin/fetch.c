@@ -1284,6 +1284,39 @@ static void add_negotiation_tips(struct git_transport_options *smart_options)
 	smart_options->negotiation_tips = oids;
 }
 
+static int add_prefetched_ref(const char *refname, const struct object_id *oid,
+			      int flags, void *cb_data)
+{
+	struct ref ***tail = cb_data;
+	struct strbuf name = STRBUF_INIT;
+
+	/* the "prefetch" task maps refs/heads/<name> to refs/prefetch/<remote>/<name> */
+	strbuf_addf(&name, "refs/heads/%s", refname);
+	**tail = alloc_ref(name.buf);
+	oidcpy(&(**tail)->old_oid, oid);
+	*tail = &(**tail)->next;
+	strbuf_release(&name);
+	return 0;
+}
+
+/*
+ * The "prefetch" maintenance task stores the branches of each remote in
+ * "refs/prefetch/<remote>/". Those commits came from the remote we are
+ * about to fetch from, so they are good candidates for being common.
+ */
+static void add_prefetch_tips(struct git_transport_options *smart_options,
+			      struct remote *remote)
+{
+	struct ref *refs = NULL, **tail = &refs;
+	struct strbuf prefix = STRBUF_INIT;
+
+	strbuf_addf(&prefix, "refs/prefetch/%s/", remote->name);
+	for_each_ref_in(prefix.buf, add_prefetched_ref, &tail);
+	strbuf_release(&prefix);
+
+	smart_options->prefetched_refs = refs;
+}
+
 static struct transport *prepare_transport(struct remote *remote, int deepen)
 {
 	struct transport *transport;
@@ -1318,6 +1351,8 @@ static struct transport *prepare_transport(struct remote *remote, int deepen)
 		else
 			warning("Ignoring --negotiation-tip because the protocol does not support it.");
 	}
+	if (transport->smart_options && remote->name && !negotiation_tip.nr)
+		add_prefetch_tips(transport->smart_options, remote);
 	return transport;
 }
 
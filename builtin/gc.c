@@ -300,7 +300,7 @@ static uint64_t estimate_repack_memory(struct packed_git *pack)
 	 */
 	heap += sizeof(struct tree) * nr_objects / 2;
 	/* and then obj_hash[], underestimated in fact */
-	heap += sizeof(struct object *) * nr_objects;
+	heap += sizeof(struct obj_hash_entry) * nr_objects;
 	/* revindex is used also */
 	heap += sizeof(struct revindex_entry) * nr_objects;
 	/*
@@ -25,6 +25,7 @@
 #include "submodule-config.h"
 #include "object-store.h"
 #include "packfile.h"
+#include "oidset.h"
 
 static char const * const grep_usage[] = {
 	N_("git grep [<options>] [-e] <pattern> [<rev>...] [[--] <path>...]"),
@@ -91,6 +92,78 @@ static pthread_cond_t cond_result;
 
 static int skip_first_line;
 
+/*
+ * When grepping several trees, most blobs are seen under more than one
+ * of them.  Remember the blobs that had no hits, together with the
+ * userdiff driver they were searched with (which decides whether they
+ * are binary and how they are converted), so that other copies need
+ * not be read and searched again.  Protected by grep_mutex when
+ * threaded.
+ */
+static int skip_nohit_blobs;
+
+static struct nohit_blobs {
+	const struct userdiff_driver *driver;
+	struct oidset oids;
+} *nohit_blobs;
+static int nohit_blobs_nr, nohit_blobs_alloc;
+
+static struct oidset *nohit_set(const struct userdiff_driver *driver)
+{
+	int i;
+
+	for (i = 0; i < nohit_blobs_nr; i++)
+		if (nohit_blobs[i].driver == driver)
+			return &nohit_blobs[i].oids;
+	ALLOC_GROW(nohit_blobs, nohit_blobs_nr + 1, nohit_blobs_alloc);
+	nohit_blobs[nohit_blobs_nr].driver = driver;
+	oidset_init(&nohit_blobs[nohit_blobs_nr].oids, 0);
+	return &nohit_blobs[nohit_blobs_nr++].oids;
+}
+
+static int grep_source_once(struct grep_opt *opt, struct grep_source *gs)
+{
+	const struct userdiff_driver *driver = NULL;
+	int seen, hit;
+
+	if (!skip_nohit_blobs || gs->type != GREP_SOURCE_OID)
+		return grep_source(opt, gs);
+
+	if (opt->binary != GREP_BINARY_TEXT || opt->allow_textconv) {
+		grep_source_load_driver(gs, opt->repo->index);
+		driver = gs->driver;
+	}
+
+	if (num_threads > 1)
+		grep_lock();
+	seen = oidset_contains(nohit_set(driver), gs->identifier);
+	if (num_threads > 1)
+		grep_unlock();
+	if (seen)
+		return 0;
+
+	hit = grep_source(opt, gs);
+	if (hit)
+		return hit;
+
+	if (num_threads > 1)
+		grep_lock();
+	oidset_insert(nohit_set(driver), gs->identifier);
+	if (num_threads > 1)
+		grep_unlock();
+	return 0;
+}
+
+static void clear_nohit_blobs(void)
+{
+	int i;
+
+	for (i = 0; i < nohit_blobs_nr; i++)
+		oidset_clear(&nohit_blobs[i].oids);
+	FREE_AND_NULL(nohit_blobs);
+	nohit_blobs_nr = nohit_blobs_alloc = 0;
+}
+
 static void add_work(struct grep_opt *opt, struct grep_source *gs)
 {
 	if (opt->binary != GREP_BINARY_TEXT)
@@ -179,7 +252,7 @@ static void *run(void *arg)
 			break;
 
 		opt->output_priv = w;
-		hit |= grep_source(opt, &w->source);
+		hit |= grep_source_once(opt, &w->source);
 		grep_source_clear_data(&w->source);
 		work_done(w);
 	}
@@ -348,7 +421,7 @@ static int grep_oid(struct grep_opt *opt, const struct object_id *oid,
 	} else {
 		int hit;
 
-		hit = grep_source(opt, &gs);
+		hit = grep_source_once(opt, &gs);
 
 		grep_source_clear(&gs);
 		return hit;
@@ -662,6 +735,12 @@ static int grep_objects(struct grep_opt *opt, const struct pathspec *pathspec,
 	int hit = 0;
 	const unsigned int nr = list->nr;
 
+	/*
+	 * "-L" has to show the blobs without hits under every name, so it
+	 * cannot skip them.
+	 */
+	skip_nohit_blobs = nr > 1 && !opt->unmatch_name_only;
+
 	for (i = 0; i < nr; i++) {
 		struct object *real_obj;
 
@@ -1169,6 +1248,7 @@ int cmd_grep(int argc, const char **argv, const char *prefix)
 	if (hit && show_in_pager)
 		run_pager(&opt, prefix);
 	clear_pathspec(&pathspec);
+	clear_nohit_blobs();
 	free_grep_patterns(&opt);
 	grep_destroy();
 	return !hit;
@@ -56,6 +56,14 @@ struct base_data {
 	struct list_head list;
 	void *data;
 	unsigned long size;
+
+	/*
+	 * 1-based position in prune_heap, or 0 if this base is not a
+	 * candidate for pruning (no data, or data retained). in_done is set
+	 * once the base has moved to done_head.
+	 */
+	size_t heap_pos;
+	unsigned in_done : 1;
 };
 
 /*
@@ -85,6 +93,24 @@ static LIST_HEAD(done_head);
  */
 static size_t base_cache_used;
 static size_t base_cache_limit;
+static size_t base_cache_peak;
+
+/*
+ * Heap of the reconstructed bases that may be pruned, ordered so that the
+ * base to drop first is at the top: bases on done_head before those on
+ * work_head, and larger bases before smaller ones. It is updated as bases
+ * gain and lose their data, so that pruning never has to rescan the lists.
+ *
+ * Guarded by work_mutex.
+ */
+static struct base_data **prune_heap;
+static size_t prune_heap_nr, prune_heap_alloc;
+
+/*
+ * Overall memory budget for reconstructed bases, shared by all threads.
+ * When zero, delta_base_cache_limit is given to each thread.
+ */
+static unsigned long max_memory;
 
 struct thread_local {
 	pthread_t thread;
@@ -142,6 +168,7 @@ static const char *curr_pack;
 static struct thread_local *thread_data;
 static int nr_dispatched;
 static int threads_active;
+static int hash_threads_active;
 
 static pthread_mutex_t read_mutex;
 #define read_lock()		lock_mutex(&read_mutex)
@@ -400,42 +427,101 @@ static void set_thread_data(struct thread_local *data)
 		pthread_setspecific(key, data);
 }
 
-static void free_base_data(struct base_data *c)
+static int prune_before(const struct base_data *a, const struct base_data *b)
 {
-	if (c->data) {
-		FREE_AND_NULL(c->data);
-		base_cache_used -= c->size;
+	if (a->in_done != b->in_done)
+		return a->in_done;
+	return a->size > b->size;
+}
+
+static void prune_heap_set(size_t i, struct base_data *b)
+{
+	prune_heap[i] = b;
+	b->heap_pos = i + 1;
+}
+
+static void prune_heap_sift(size_t i)
+{
+	struct base_data *b = prune_heap[i];
+
+	while (i) {
+		size_t parent = (i - 1) / 2;
+		if (!prune_before(b, prune_heap[parent]))
+			break;
+		prune_heap_set(i, prune_heap[parent]);
+		i = parent;
+	}
+	for (;;) {
+		size_t child = 2 * i + 1;
+		if (child >= prune_heap_nr)
+			break;
+		if (child + 1 < prune_heap_nr &&
+		    prune_before(prune_heap[child + 1], prune_heap[child]))
+			child++;
+		if (!prune_before(prune_heap[child], b))
+			break;
+		prune_heap_set(i, prune_heap[child]);
+		i = child;
 	}
+	prune_heap_set(i, b);
 }
 
-static void prune_base_data(struct base_data *retain)
+static void prune_heap_add(struct base_data *b)
 {
-	struct list_head *pos;
+	if (b->heap_pos || !b->data || b->retain_data)
+		return;
+	ALLOC_GROW(prune_heap, prune_heap_nr + 1, prune_heap_alloc);
+	prune_heap_set(prune_heap_nr++, b);
+	prune_heap_sift(prune_heap_nr - 1);
+}
 
-	if (base_cache_used <= base_cache_limit)
+static void prune_heap_remove(struct base_data *b)
+{
+	size_t i = b->heap_pos;
+
+	if (!i--)
+		return;
+	b->heap_pos = 0;
+	if (i == --prune_heap_nr)
 		return;
+	prune_heap_set(i, prune_heap[prune_heap_nr]);
+	prune_heap_sift(i);
+}
 
-	list_for_each_prev(pos, &done_head) {
-		struct base_data *b = list_entry(pos, struct base_data, list);
-		if (b->retain_data || b == retain)
-			continue;
-		if (b->data) {
-			free_base_data(b);
-			if (base_cache_used <= base_cache_limit)
-				return;
-		}
+static void free_base_data(struct base_data *c)
+{
+	if (c->data) {
+		prune_heap_remove(c);
+		FREE_AND_NULL(c->data);
+		base_cache_used -= c->size;
 	}
+}
 
-	list_for_each_prev(pos, &work_head) {
-		struct base_data *b = list_entry(pos, struct base_data, list);
-		if (b->retain_data || b == retain)
-			continue;
-		if (b->data) {
-			free_base_data(b);
-			if (base_cache_used <= base_cache_limit)
-				return;
-		}
-	}
+/*
+ * Free reconstructed bases until we are within base_cache_limit again.
+ *
+ * Bases whose children have all been dispatched (done_head) go first,
+ * as they are only needed to rebuild data that was already pruned. Among
+ * those, the largest bases are dropped first, so that a single huge blob
+ * does not flush many small tree bases that are cheap to keep.
+ */
+static void prune_base_data(void)
+{
+	if (base_cache_peak < base_cache_used)
+		base_cache_peak = base_cache_used;
+	while (base_cache_used > base_cache_limit && prune_heap_nr)
+		free_base_data(prune_heap[0]);
+}
+
+/*
+ * Account for the data just reconstructed for "c" and make room for it
+ * within base_cache_limit. "c" itself is not pruned here.
+ */
+static void add_base_data(struct base_data *c)
+{
+	base_cache_used += c->size;
+	prune_base_data();
+	prune_heap_add(c);
 }
 
 static int is_delta_type(enum object_type type)
@@ -454,18 +540,24 @@ static void *unpack_entry_data(off_t offset, unsigned long size,
 	char hdr[32];
 	int hdrlen;
 
-	if (!is_delta_type(type)) {
-		hdrlen = xsnprintf(hdr, sizeof(hdr), "%s %"PRIuMAX,
-				   type_name(type),(uintmax_t)size) + 1;
-		the_hash_algo->init_fn(&c);
-		the_hash_algo->update_fn(&c, hdr, hdrlen);
-	} else
-		oid = NULL;
 	if (type == OBJ_BLOB && size > big_file_threshold)
 		buf = fixed_buf;
 	else
 		buf = xmallocz(size);
 
+	/*
+	 * Objects we keep in memory are hashed by the hash workers, if
+	 * there are any; see queue_hash_job().
+	 */
+	if (is_delta_type(type) || (buf != fixed_buf && hash_threads_active))
+		oid = NULL;
+	if (oid) {
+		hdrlen = xsnprintf(hdr, sizeof(hdr), "%s %"PRIuMAX,
+				   type_name(type),(uintmax_t)size) + 1;
+		the_hash_algo->init_fn(&c);
+		the_hash_algo->update_fn(&c, hdr, hdrlen);
+	}
+
 	memset(&stream, 0, sizeof(stream));
 	git_inflate_init(&stream);
 	stream.next_out = buf;
@@ -913,8 +1005,7 @@ static void *get_base_data(struct base_data *c)
 		if (!delta_nr) {
 			c->data = get_data_from_pack(obj);
 			c->size = obj->size;
-			base_cache_used += c->size;
-			prune_base_data(c);
+			add_base_data(c);
 		}
 		for (; delta_nr > 0; delta_nr--) {
 			void *base, *raw;
@@ -929,8 +1020,7 @@ static void *get_base_data(struct base_data *c)
 			free(raw);
 			if (!c->data)
 				bad_object(obj->idx.offset, _("failed to apply delta"));
-			base_cache_used += c->size;
-			prune_base_data(c);
+			add_base_data(c);
 		}
 		free(delta);
 	}
@@ -1067,6 +1157,9 @@ static void *threaded_second_pass(void *data)
 				 */
 				list_del(&parent->list);
 				list_add(&parent->list, &done_head);
+				parent->in_done = 1;
+				if (parent->heap_pos)
+					prune_heap_sift(parent->heap_pos - 1);
 			}
 
 			/*
@@ -1082,6 +1175,7 @@ static void *threaded_second_pass(void *data)
 			 */
 			get_base_data(parent);
 			parent->retain_data++;
+			prune_heap_remove(parent);
 		}
 		work_unlock();
 
@@ -1105,16 +1199,15 @@ static void *threaded_second_pass(void *data)
 		}
 
 		work_lock();
-		if (parent)
-			parent->retain_data--;
+		if (parent && !--parent->retain_data)
+			prune_heap_add(parent);
 		if (child->data) {
 			/*
 			 * This child has its own children, so add it to
 			 * work_head.
 			 */
 			list_add(&child->list, &work_head);
-			base_cache_used += child->size;
-			prune_base_data(NULL);
+			add_base_data(child);
 		} else {
 			/*
 			 * This child does not have its own children. It may be
@@ -1143,6 +1236,117 @@ static void *threaded_second_pass(void *data)
 	return NULL;
 }
 
+/*
+ * When threads are available, the first pass is pipelined: the main
+ * thread reads the stream and inflates each object (which is the only
+ * way to find where it ends), while worker threads compute the object
+ * names of the non-delta objects and run the usual collision and fsck
+ * checks on them. The queue between them is bounded both in the number
+ * of jobs and in the amount of inflated data it holds. The data is
+ * charged against base_cache_limit, the same memory budget that the
+ * reconstructed bases get in the second pass, which only starts once
+ * the queue is drained.
+ */
+struct hash_job {
+	struct object_entry *obj;
+	void *data;
+};
+
+static struct hash_job *hash_queue;
+static unsigned hash_queue_alloc, hash_queue_first, hash_queue_nr;
+static size_t hash_queue_bytes, hash_queue_peak;
+static int hash_queue_closed;
+static pthread_mutex_t hash_queue_mutex;
+static pthread_cond_t hash_queue_cond;
+static pthread_cond_t hash_queue_space_cond;
+
+static void *hash_worker(void *data)
+{
+	for (;;) {
+		struct hash_job job;
+
+		pthread_mutex_lock(&hash_queue_mutex);
+		while (!hash_queue_nr && !hash_queue_closed)
+			pthread_cond_wait(&hash_queue_cond, &hash_queue_mutex);
+		if (!hash_queue_nr) {
+			pthread_mutex_unlock(&hash_queue_mutex);
+			break;
+		}
+		job = hash_queue[hash_queue_first];
+		hash_queue_first = (hash_queue_first + 1) % hash_queue_alloc;
+		hash_queue_nr--;
+		hash_queue_bytes -= job.obj->size;
+		pthread_cond_signal(&hash_queue_space_cond);
+		pthread_mutex_unlock(&hash_queue_mutex);
+
+		hash_object_file(the_hash_algo, job.data, job.obj->size,
+				 type_name(job.obj->type), &job.obj->idx.oid);
+		sha1_object(job.data, NULL, job.obj->size, job.obj->type,
+			    &job.obj->idx.oid);
+		free(job.data);
+	}
+	return NULL;
+}
+
+static void start_hash_threads(void)
+{
+	int i;
+
+	init_thread();
+	pthread_mutex_init(&hash_queue_mutex, NULL);
+	pthread_cond_init(&hash_queue_cond, NULL);
+	pthread_cond_init(&hash_queue_space_cond, NULL);
+	hash_queue_alloc = 64 * nr_threads;
+	ALLOC_ARRAY(hash_queue, hash_queue_alloc);
+	hash_threads_active = 1;
+
+	for (i = 0; i < nr_threads; i++) {
+		int ret = pthread_create(&thread_data[i].thread, NULL,
+					 hash_worker, NULL);
+		if (ret)
+			die(_("unable to create thread: %s"), strerror(ret));
+	}
+}
+
+static void queue_hash_job(struct object_entry *obj, void *data)
+{
+	pthread_mutex_lock(&hash_queue_mutex);
+	while (hash_queue_nr == hash_queue_alloc ||
+	       (hash_queue_nr && hash_queue_bytes + obj->size > base_cache_limit))
+		pthread_cond_wait(&hash_queue_space_cond, &hash_queue_mutex);
+	hash_queue[(hash_queue_first + hash_queue_nr) % hash_queue_alloc].obj = obj;
+	hash_queue[(hash_queue_first + hash_queue_nr) % hash_queue_alloc].data = data;
+	hash_queue_nr++;
+	hash_queue_bytes += obj->size;
+	if (hash_queue_peak < hash_queue_bytes)
+		hash_queue_peak = hash_queue_bytes;
+	pthread_cond_signal(&hash_queue_cond);
+	pthread_mutex_unlock(&hash_queue_mutex);
+}
+
+static void finish_hash_threads(void)
+{
+	int i;
+
+	if (!hash_threads_active)
+		return;
+
+	pthread_mutex_lock(&hash_queue_mutex);
+	hash_queue_closed = 1;
+	pthread_cond_broadcast(&hash_queue_cond);
+	pthread_mutex_unlock(&hash_queue_mutex);
+
+	for (i = 0; i < nr_threads; i++)
+		pthread_join(thread_data[i].thread, NULL);
+
+	hash_threads_active = 0;
+	pthread_cond_destroy(&hash_queue_space_cond);
+	pthread_cond_destroy(&hash_queue_cond);
+	pthread_mutex_destroy(&hash_queue_mutex);
+	FREE_AND_NULL(hash_queue);
+	cleanup_thread();
+}
+
 /*
  * First pass:
  * - find locations of all objects;
@@ -1160,6 +1364,8 @@ static void parse_pack_objects(unsigned char *hash)
 		progress = start_progress(
 				from_stdin ? _("Receiving objects") : _("Indexing objects"),
 				nr_objects);
+	if (nr_threads > 1 || getenv("GIT_FORCE_THREADS"))
+		start_hash_threads();
 	for (i = 0; i < nr_objects; i++) {
 		struct object_entry *obj = &objects[i];
 		void *data = unpack_raw_entry(obj, &ofs_delta->offset,
@@ -1179,6 +1385,9 @@ static void parse_pack_objects(unsigned char *hash)
 			/* large blobs, check later */
 			obj->real_type = OBJ_BAD;
 			nr_delays++;
+		} else if (hash_threads_active) {
+			queue_hash_job(obj, data);
+			data = NULL;
 		} else
 			sha1_object(data, NULL, obj->size, obj->type,
 				    &obj->idx.oid);
@@ -1186,6 +1395,7 @@ static void parse_pack_objects(unsigned char *hash)
 		display_progress(progress, i+1);
 	}
 	objects[i].idx.offset = consumed_bytes;
+	finish_hash_threads();
 	stop_progress(&progress);
 
 	/* Check pack integrity */
@@ -1239,7 +1449,6 @@ static void resolve_deltas(void)
 					  nr_ref_deltas + nr_ofs_deltas);
 
 	nr_dispatched = 0;
-	base_cache_limit = delta_base_cache_limit * nr_threads;
 	if (nr_threads > 1 || getenv("GIT_FORCE_THREADS")) {
 		init_thread();
 		for (i = 0; i < nr_threads; i++) {
@@ -1578,6 +1787,10 @@ static int git_index_pack_config(const char *k, const char *v, void *cb)
 		}
 		return 0;
 	}
+	if (!strcmp(k, "pack.indexmaxmemory")) {
+		max_memory = git_config_ulong(k, v);
+		return 0;
+	}
 	return git_default_config(k, v, cb);
 }
 
@@ -1800,6 +2013,9 @@ int cmd_index_pack(int argc, const char **argv, const char *prefix)
 					die(_("bad %s"), arg);
 			} else if (skip_prefix(arg, "--max-input-size=", &arg)) {
 				max_input_size = strtoumax(arg, NULL, 10);
+			} else if (skip_prefix(arg, "--max-memory=", &arg)) {
+				if (!git_parse_ulong(arg, &max_memory))
+					die(_("bad %s"), argv[i]);
 			} else if (skip_prefix(arg, "--object-format=", &arg)) {
 				hash_algo = hash_algo_by_name(arg);
 				if (hash_algo == GIT_HASH_UNKNOWN)
@@ -1861,11 +2077,27 @@ int cmd_index_pack(int argc, const char **argv, const char *prefix)
 	if (show_stat)
 		obj_stat = xcalloc(st_add(nr_objects, 1), sizeof(struct object_stat));
 	ofs_deltas = xcalloc(nr_objects, sizeof(struct ofs_delta_entry));
+	if (max_memory)
+		base_cache_limit = max_memory;
+	else
+		base_cache_limit = delta_base_cache_limit * nr_threads;
+	trace2_region_enter("index-pack", "parse_pack_objects", the_repository);
 	parse_pack_objects(pack_hash);
+	trace2_data_intmax("index-pack", the_repository, "hash_queue_peak",
+			   hash_queue_peak);
+	trace2_region_leave("index-pack", "parse_pack_objects", the_repository);
 	if (report_end_of_input)
 		write_in_full(2, "\0", 1);
+	trace2_region_enter("index-pack", "resolve_deltas", the_repository);
 	resolve_deltas();
+	trace2_data_intmax("index-pack", the_repository, "base_cache_limit",
+			   base_cache_limit);
+	trace2_data_intmax("index-pack", the_repository, "base_cache_peak",
+			   base_cache_peak);
+	trace2_region_leave("index-pack", "resolve_deltas", the_repository);
+	trace2_region_enter("index-pack", "conclude_pack", the_repository);
 	conclude_pack(fix_thin_pack, curr_pack, pack_hash);
+	trace2_region_leave("index-pack", "conclude_pack", the_repository);
 	free(ofs_deltas);
 	free(ref_deltas);
 	if (strict)
@@ -1877,7 +2109,9 @@ int cmd_index_pack(int argc, const char **argv, const char *prefix)
 	ALLOC_ARRAY(idx_objects, nr_objects);
 	for (i = 0; i < nr_objects; i++)
 		idx_objects[i] = &objects[i].idx;
+	trace2_region_enter("index-pack", "write_idx", the_repository);
 	curr_index = write_idx_file(index_name, idx_objects, nr_objects, &opts, pack_hash);
+	trace2_region_leave("index-pack", "write_idx", the_repository);
 	free(idx_objects);
 
 	if (!verify)
@@ -8,6 +8,7 @@
 #include "revision.h"
 #include "tag.h"
 #include "commit-reach.h"
+#include "ewah/ewok.h"
 
 /* Remember to update object flag allocation in object.h */
 #define PARENT1		(1u<<16)
@@ -553,10 +554,29 @@ static enum contains_result contains_tag_algo(struct commit *candidate,
 	return contains_test(candidate, want, cache, cutoff);
 }
 
+static int have_generations(const struct commit_list *list)
+{
+	for (; list; list = list->next) {
+		uint32_t generation;
+
+		load_commit_graph_info(the_repository, list->item);
+		generation = commit_graph_generation(list->item);
+		if (generation == GENERATION_NUMBER_INFINITY ||
+		    generation == GENERATION_NUMBER_ZERO)
+			return 0;
+	}
+	return 1;
+}
+
 int commit_contains(struct ref_filter *filter, struct commit *commit,
 		    struct commit_list *list, struct contains_cache *cache)
 {
-	if (filter->with_commit_tag_algo)
+	/*
+	 * The tag algorithm remembers the answer for every commit it
+	 * visits, which pays off for many candidates; generation
+	 * numbers keep each of its walks above the wanted commits.
+	 */
+	if (filter->with_commit_tag_algo || have_generations(list))
 		return contains_tag_algo(commit, list, cache) == CONTAINS_YES;
 	return repo_is_descendant_of(the_repository, commit, list);
 }
@@ -802,3 +822,290 @@ struct commit_list *get_reachable_subset(struct commit **from, int nr_from,
 
 	return found_commits;
 }
+
+struct commit_and_index {
+	struct commit *commit;
+	size_t index;
+	uint32_t generation;
+};
+
+static int compare_commit_and_index_by_generation(const void *va, const void *vb)
+{
+	const struct commit_and_index *a = va, *b = vb;
+
+	if (a->generation > b->generation)
+		return 1;
+	if (a->generation < b->generation)
+		return -1;
+	return 0;
+}
+
+/* position of a tip in the sorted array, plus one */
+define_commit_slab(tip_positions, size_t);
+
+void tips_reachable_from_bases(struct repository *r,
+			       struct commit_list *bases,
+			       struct commit **tips, size_t tips_nr,
+			       int mark)
+{
+	struct commit_and_index *commits;
+	struct tip_positions positions;
+	size_t i, min_generation_index = 0;
+	uint32_t min_generation;
+	struct commit_list *stack = NULL;
+
+	if (!bases || !tips || !tips_nr)
+		return;
+
+	/*
+	 * Do a depth-first search starting at 'bases' to search for the
+	 * tips. Stop at the lowest generation number among the tips not
+	 * found yet, and raise it whenever that tip is found.
+	 */
+	ALLOC_ARRAY(commits, tips_nr);
+	for (i = 0; i < tips_nr; i++) {
+		repo_parse_commit(r, tips[i]);
+		commits[i].commit = tips[i];
+		commits[i].index = i;
+		commits[i].generation = commit_graph_generation(tips[i]);
+	}
+	QSORT(commits, tips_nr, compare_commit_and_index_by_generation);
+	min_generation = commits[0].generation;
+
+	init_tip_positions(&positions);
+	for (i = 0; i < tips_nr; i++) {
+		size_t *pos = tip_positions_at(&positions, commits[i].commit);
+		/* for a tip listed twice, remember the lowest position */
+		if (!*pos)
+			*pos = i + 1;
+	}
+
+	for (; bases; bases = bases->next) {
+		repo_parse_commit(r, bases->item);
+		if (!(bases->item->object.flags & PARENT2)) {
+			bases->item->object.flags |= PARENT2;
+			commit_list_insert(bases->item, &stack);
+		}
+	}
+
+	while (stack) {
+		int explored_all_parents = 1;
+		struct commit_list *p;
+		struct commit *c = stack->item;
+		size_t pos = *tip_positions_at(&positions, c);
+
+		if (pos && !(c->object.flags & mark)) {
+			c->object.flags |= mark;
+
+			while (min_generation_index < tips_nr &&
+			       (commits[min_generation_index].commit->object.flags & mark))
+				min_generation_index++;
+
+			/* Terminate early if all found. */
+			if (min_generation_index >= tips_nr)
+				break;
+			min_generation = commits[min_generation_index].generation;
+		}
+
+		for (p = c->parents; p; p = p->next) {
+			repo_parse_commit(r, p->item);
+
+			/* Have we already explored this parent? */
+			if (p->item->object.flags & PARENT2)
+				continue;
+
+			/* Is it below the current minimum generation? */
+			if (commit_graph_generation(p->item) < min_generation)
+				continue;
+
+			/* Ok, we will explore from here on. */
+			p->item->object.flags |= PARENT2;
+			explored_all_parents = 0;
+			commit_list_insert(p->item, &stack);
+			break;
+		}
+
+		if (explored_all_parents)
+			pop_commit(&stack);
+	}
+
+	free_commit_list(stack);
+	free(commits);
+	clear_tip_positions(&positions);
+	clear_commit_marks_all(PARENT2);
+}
+
+define_commit_slab(bit_arrays, struct bitmap *);
+static struct bit_arrays bit_arrays;
+
+define_commit_slab(walk_generations, uint32_t);
+
+/*
+ * The walk in ahead_behind() must visit each commit after all of its
+ * descendants, which commit dates cannot promise. Use the generation
+ * numbers of the commit-graph and compute them for the commits that
+ * are not in it.
+ */
+static uint32_t walk_generation(struct repository *r,
+				struct walk_generations *slab,
+				struct commit *c)
+{
+	struct commit_list *stack = NULL;
+	uint32_t *gen = walk_generations_at(slab, c);
+
+	if (*gen)
+		return *gen;
+
+	commit_list_insert(c, &stack);
+	while (stack) {
+		struct commit *current = stack->item;
+		struct commit_list *parent;
+		uint32_t generation, max_generation = 0;
+		int all_parents_computed = 1;
+
+		repo_parse_commit(r, current);
+		generation = commit_graph_generation(current);
+		if (generation != GENERATION_NUMBER_INFINITY &&
+		    generation != GENERATION_NUMBER_ZERO) {
+			*walk_generations_at(slab, current) = generation;
+			pop_commit(&stack);
+			continue;
+		}
+
+		for (parent = current->parents; parent; parent = parent->next) {
+			generation = *walk_generations_at(slab, parent->item);
+			if (!generation) {
+				all_parents_computed = 0;
+				commit_list_insert(parent->item, &stack);
+				break;
+			}
+			if (generation > max_generation)
+				max_generation = generation;
+		}
+
+		if (all_parents_computed) {
+			*walk_generations_at(slab, current) = max_generation + 1;
+			pop_commit(&stack);
+		}
+	}
+	return *gen;
+}
+
+static int compare_commits_by_walk_generation(const void *a_, const void *b_,
+					      void *slab)
+{
+	const struct commit *a = a_, *b = b_;
+	uint32_t generation_a = *walk_generations_at(slab, a);
+	uint32_t generation_b = *walk_generations_at(slab, b);
+
+	/* newer commits first */
+	if (generation_a < generation_b)
+		return 1;
+	if (generation_a > generation_b)
+		return -1;
+	if (a->date < b->date)
+		return 1;
+	if (a->date > b->date)
+		return -1;
+	return 0;
+}
+
+static void insert_no_dup(struct prio_queue *queue, struct commit *c)
+{
+	if (c->object.flags & PARENT2)
+		return;
+	prio_queue_put(queue, c);
+	c->object.flags |= PARENT2;
+}
+
+static struct bitmap *get_bit_array(struct commit *c, size_t width)
+{
+	struct bitmap **bitmap = bit_arrays_at(&bit_arrays, c);
+	if (!*bitmap)
+		*bitmap = bitmap_word_alloc(width);
+	return *bitmap;
+}
+
+static void free_bit_array(struct commit *c)
+{
+	struct bitmap **bitmap = bit_arrays_at(&bit_arrays, c);
+	if (!*bitmap)
+		return;
+	bitmap_free(*bitmap);
+	*bitmap = NULL;
+}
+
+void ahead_behind(struct repository *r,
+		  struct commit **commits, size_t commits_nr,
+		  struct ahead_behind_count *counts, size_t counts_nr)
+{
+	struct walk_generations generations;
+	struct prio_queue queue = { compare_commits_by_walk_generation, 0, &generations };
+	size_t width = DIV_ROUND_UP(commits_nr, BITS_IN_EWORD);
+	size_t i;
+
+	for (i = 0; i < counts_nr; i++) {
+		counts[i].ahead = 0;
+		counts[i].behind = 0;
+	}
+
+	if (!commits_nr || !counts_nr)
+		return;
+
+	init_bit_arrays(&bit_arrays);
+	init_walk_generations(&generations);
+
+	for (i = 0; i < commits_nr; i++) {
+		struct commit *c = commits[i];
+
+		walk_generation(r, &generations, c);
+		bitmap_set(get_bit_array(c, width), i);
+		insert_no_dup(&queue, c);
+	}
+
+	while (queue_has_nonstale(&queue)) {
+		struct commit *c = prio_queue_get(&queue);
+		struct commit_list *p;
+		struct bitmap *bitmap_c = get_bit_array(c, width);
+
+		for (i = 0; i < counts_nr; i++) {
+			int from_tip = bitmap_get(bitmap_c, counts[i].tip_index);
+			int from_base = bitmap_get(bitmap_c, counts[i].base_index);
+
+			if (from_tip && !from_base)
+				counts[i].ahead++;
+			else if (from_base && !from_tip)
+				counts[i].behind++;
+		}
+
+		for (p = c->parents; p; p = p->next) {
+			struct bitmap *bitmap_p;
+
+			walk_generation(r, &generations, p->item);
+
+			bitmap_p = get_bit_array(p->item, width);
+			bitmap_or(bitmap_p, bitmap_c);
+
+			/*
+			 * A parent reachable from every starting commit
+			 * cannot add to any count, and neither can its
+			 * ancestors: mark it STALE, so that the walk
+			 * stops once only such commits are left.
+			 */
+			if (bitmap_popcount(bitmap_p) == commits_nr)
+				p->item->object.flags |= STALE;
+
+			insert_no_dup(&queue, p->item);
+		}
+
+		free_bit_array(c);
+	}
+
+	/* STALE is used here, PARENT2 is used by insert_no_dup(). */
+	clear_commit_marks_all(PARENT2 | STALE);
+	while (queue.nr)
+		free_bit_array(prio_queue_get(&queue));
+	clear_bit_arrays(&bit_arrays);
+	clear_walk_generations(&generations);
+	clear_prio_queue(&queue);
+}
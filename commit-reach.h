@@ -104,4 +104,49 @@ struct commit_list *get_reachable_subset(struct commit **from, int nr_from,
 					 struct commit **to, int nr_to,
 					 unsigned int reachable_flag);
 
+/*
+ * Set 'mark' on each of the 'tips' that is reachable from at least
+ * one of the 'bases'. The walk does not go below the lowest generation
+ * number among the tips not found yet, and stops once all of them are
+ * found.
+ *
+ * This method uses the PARENT2 flag during its operation, so be sure
+ * it is not set before calling the method.
+ */
+void tips_reachable_from_bases(struct repository *r,
+			       struct commit_list *bases,
+			       struct commit **tips, size_t tips_nr,
+			       int mark);
+
+struct ahead_behind_count {
+	/*
+	 * As input, the *_index members indicate which positions in
+	 * the 'commits' array correspond to the tip and base of this
+	 * comparison.
+	 */
+	size_t tip_index;
+	size_t base_index;
+
+	/*
+	 * As output, 'ahead' is the number of commits reachable from
+	 * the tip and not from the base, and 'behind' the number of
+	 * commits reachable from the base and not from the tip.
+	 */
+	unsigned int ahead;
+	unsigned int behind;
+};
+
+/*
+ * Compute the ahead/behind counts of all the given pairs of commits
+ * with a single walk. Each commit in the walk carries a bit per entry
+ * of 'commits' that can reach it, and the walk stops as soon as every
+ * remaining commit is reachable from all of them.
+ *
+ * This method uses the PARENT2 and STALE flags during its operation,
+ * so be sure these flags are not set before calling the method.
+ */
+void ahead_behind(struct repository *r,
+		  struct commit **commits, size_t commits_nr,
+		  struct ahead_behind_count *counts, size_t counts_nr);
+
 #endif
@@ -21,6 +21,7 @@
 #include "commit-reach.h"
 #include "run-command.h"
 #include "shallow.h"
+#include "replace-object.h"
 
 static struct commit_extra_header *read_commit_extra_header_lines(const char *buf, size_t len, const char **);
 
@@ -246,6 +247,57 @@ int for_each_commit_graft(each_commit_graft_fn fn, void *cb_data)
 	return ret;
 }
 
+static int compare_replace_objects(const void *a_, const void *b_)
+{
+	const struct replace_object *a = *(const struct replace_object **)a_;
+	const struct replace_object *b = *(const struct replace_object **)b_;
+
+	return oidcmp(&a->original.oid, &b->original.oid);
+}
+
+void hash_commit_parent_rewrites(struct repository *r, git_hash_ctx *ctx)
+{
+	size_t i;
+
+	if (read_replace_refs) {
+		struct replace_object **replace;
+		struct replace_object *entry;
+		struct oidmap_iter iter;
+		size_t nr = 0;
+
+		prepare_replace_object(r);
+		ALLOC_ARRAY(replace, hashmap_get_size(&r->objects->replace_map->map));
+		oidmap_iter_init(r->objects->replace_map, &iter);
+		while ((entry = oidmap_iter_next(&iter)))
+			replace[nr++] = entry;
+		QSORT(replace, nr, compare_replace_objects);
+		for (i = 0; i < nr; i++) {
+			r->hash_algo->update_fn(ctx, "replace", 7);
+			r->hash_algo->update_fn(ctx, replace[i]->original.oid.hash,
+						r->hash_algo->rawsz);
+			r->hash_algo->update_fn(ctx, replace[i]->replacement.hash,
+						r->hash_algo->rawsz);
+		}
+		free(replace);
+	}
+
+	/* this includes the shallow file, as grafts without parents */
+	prepare_commit_graft(r);
+	for (i = 0; i < r->parsed_objects->grafts_nr; i++) {
+		const struct commit_graft *graft = r->parsed_objects->grafts[i];
+		uint32_t nr_parent = htonl(graft->nr_parent);
+		int j;
+
+		r->hash_algo->update_fn(ctx, "graft", 5);
+		r->hash_algo->update_fn(ctx, graft->oid.hash,
+					r->hash_algo->rawsz);
+		r->hash_algo->update_fn(ctx, &nr_parent, sizeof(nr_parent));
+		for (j = 0; j < graft->nr_parent; j++)
+			r->hash_algo->update_fn(ctx, graft->parent[j].hash,
+						r->hash_algo->rawsz);
+	}
+}
+
 struct commit_buffer {
 	void *buffer;
 	unsigned long size;
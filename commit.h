@@ -239,6 +239,13 @@ int register_commit_graft(struct repository *r, struct commit_graft *, int);
 void prepare_commit_graft(struct repository *r);
 struct commit_graft *lookup_commit_graft(struct repository *r, const struct object_id *oid);
 
+/*
+ * Feed everything that can change the parents of a commit (the replace
+ * refs in use, the grafts and the shallow file) to "ctx", so that data
+ * cached about the history can tell whether it still applies.
+ */
+void hash_commit_parent_rewrites(struct repository *r, git_hash_ctx *ctx);
+
 struct commit *get_fork_point(const char *refname, struct commit *commit);
 
 /* largest positive number a signed 32-bit integer can contain */
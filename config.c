@@ -22,6 +22,7 @@
 #include "refs.h"
 #include "gvfs.h"
 #include "transport.h"
+#include "version.h"
 
 struct config_source {
 	struct config_source *prev;
@@ -129,6 +130,45 @@ static const char include_depth_advice[] = N_(
 "from\n"
 "	%s\n"
 "This might be due to circular includes.");
+/*
+ * While configuration files are read to fill a config cache (see
+ * read_config_cache()), this records every file that was read or looked
+ * for, so that the cache can later be checked against them.
+ */
+struct config_cache_file {
+	enum config_scope scope;
+	int exists;
+	struct stat_data sd;
+};
+struct config_cache_files {
+	struct string_list paths; /* util is a struct config_cache_file */
+	int uncacheable;
+	int uses_git_dir;
+};
+static struct config_cache_files *config_cache_files;
+
+static int config_access_or_die(const char *path, int mode, unsigned flag)
+{
+	int ret = access_or_die(path, mode, flag);
+	int saved_errno = errno;
+
+	if (config_cache_files) {
+		struct config_cache_file *file = xcalloc(1, sizeof(*file));
+		struct stat st;
+
+		file->scope = current_parsing_scope;
+		string_list_append(&config_cache_files->paths, path)->util = file;
+		if (!ret && !stat(path, &st)) {
+			file->exists = 1;
+			fill_stat_data(&file->sd, &st);
+		} else if (!ret || (saved_errno != ENOENT && saved_errno != ENOTDIR)) {
+			config_cache_files->uncacheable = 1;
+		}
+	}
+	errno = saved_errno;
+	return ret;
+}
+
 static int handle_path_include(const char *path, struct config_include_data *inc)
 {
 	int ret = 0;
@@ -160,7 +200,7 @@ static int handle_path_include(const char *path, struct config_include_data *inc
 		path = buf.buf;
 	}
 
-	if (!access_or_die(path, R_OK, 0)) {
+	if (!config_access_or_die(path, R_OK, 0)) {
 		if (++inc->depth > MAX_INCLUDE_DEPTH)
 			die(_(include_depth_advice), MAX_INCLUDE_DEPTH, path,
 			    !cf ? "<unknown>" :
@@ -224,6 +264,10 @@ static int include_by_gitdir(const struct config_options *opts,
 	const char *git_dir;
 	int already_tried_absolute = 0;
 
+	/* the result depends on the repository; see read_config_cache() */
+	if (config_cache_files)
+		config_cache_files->uses_git_dir = 1;
+
 	if (opts->git_dir)
 		git_dir = opts->git_dir;
 	else
@@ -282,6 +326,10 @@ static int include_by_branch(const char *cond, size_t cond_len)
 		NULL : resolve_ref_unsafe("HEAD", 0, NULL, &flags);
 	const char *shortname;
 
+	/* the result depends on HEAD, which the config cache cannot check */
+	if (config_cache_files)
+		config_cache_files->uncacheable = 1;
+
 	if (!refname || !(flags & REF_ISSYMREF)	||
 			!skip_prefix(refname, "refs/heads/", &shortname))
 		return 0;
@@ -1766,57 +1814,81 @@ int git_config_system(void)
 	return !git_env_bool("GIT_CONFIG_NOSYSTEM", 0);
 }
 
-static int do_git_config_sequence(const struct config_options *opts,
-				  config_fn_t fn, void *data)
+/*
+ * Read the system and global configuration files, i.e. the ones that
+ * whoever can write to the repository does not control.
+ */
+static int do_protected_config_sequence(const struct config_options *opts,
+					config_fn_t fn, void *data)
 {
 	int ret = 0;
 	char *xdg_config = xdg_config_home("config");
 	char *user_config = expand_user_path("~/.gitconfig", 0);
-	char *repo_config;
-	enum config_scope prev_parsing_scope = current_parsing_scope;
-
-	if (opts->commondir)
-		repo_config = mkpathdup("%s/config", opts->commondir);
-	else if (opts->git_dir)
-		BUG("git_dir without commondir");
-	else
-		repo_config = NULL;
 
 	current_parsing_scope = CONFIG_SCOPE_SYSTEM;
-	if (git_config_system() && !access_or_die(git_etc_gitconfig(), R_OK,
-						  opts->system_gently ?
-						  ACCESS_EACCES_OK : 0))
+	if (git_config_system() && !config_access_or_die(git_etc_gitconfig(), R_OK,
+							 opts->system_gently ?
+							 ACCESS_EACCES_OK : 0))
 		ret += git_config_from_file(fn, git_etc_gitconfig(),
 					    data);
 
 	current_parsing_scope = CONFIG_SCOPE_GLOBAL;
-	if (xdg_config && !access_or_die(xdg_config, R_OK, ACCESS_EACCES_OK))
+	if (xdg_config && !config_access_or_die(xdg_config, R_OK, ACCESS_EACCES_OK))
 		ret += git_config_from_file(fn, xdg_config, data);
 
-	if (user_config && !access_or_die(user_config, R_OK, ACCESS_EACCES_OK))
+	if (user_config && !config_access_or_die(user_config, R_OK, ACCESS_EACCES_OK))
 		ret += git_config_from_file(fn, user_config, data);
 
+	free(xdg_config);
+	free(user_config);
+	return ret;
+}
+
+/* Read the configuration files of the repository and the worktree. */
+static int do_repo_config_sequence(const struct config_options *opts,
+				   config_fn_t fn, void *data)
+{
+	int ret = 0;
+	char *repo_config;
+
+	if (opts->commondir)
+		repo_config = mkpathdup("%s/config", opts->commondir);
+	else if (opts->git_dir)
+		BUG("git_dir without commondir");
+	else
+		repo_config = NULL;
+
 	current_parsing_scope = CONFIG_SCOPE_LOCAL;
 	if (!opts->ignore_repo && repo_config &&
-	    !access_or_die(repo_config, R_OK, 0))
+	    !config_access_or_die(repo_config, R_OK, 0))
 		ret += git_config_from_file(fn, repo_config, data);
 
 	current_parsing_scope = CONFIG_SCOPE_WORKTREE;
 	if (!opts->ignore_worktree && repository_format_worktree_config) {
 		char *path = git_pathdup("config.worktree");
-		if (!access_or_die(path, R_OK, 0))
+		if (!config_access_or_die(path, R_OK, 0))
 			ret += git_config_from_file(fn, path, data);
 		free(path);
 	}
 
+	free(repo_config);
+	return ret;
+}
+
+static int do_git_config_sequence(const struct config_options *opts,
+				  config_fn_t fn, void *data)
+{
+	int ret = 0;
+	enum config_scope prev_parsing_scope = current_parsing_scope;
+
+	ret += do_protected_config_sequence(opts, fn, data);
+	ret += do_repo_config_sequence(opts, fn, data);
+
 	current_parsing_scope = CONFIG_SCOPE_COMMAND;
 	if (!opts->ignore_cmdline && git_config_from_parameters(fn, data) < 0)
 		die(_("unable to parse command-line config"));
 
 	current_parsing_scope = prev_parsing_scope;
-	free(xdg_config);
-	free(user_config);
-	free(repo_config);
 	return ret;
 }
 
@@ -1940,12 +2012,13 @@ static struct config_set_element *configset_find_element(struct config_set *cs,
 	return found_entry;
 }
 
-static int configset_add_value(struct config_set *cs, const char *key, const char *value)
+static void configset_add_value_kvi(struct config_set *cs, const char *key,
+				    const char *value,
+				    struct key_value_info *kv_info)
 {
 	struct config_set_element *e;
 	struct string_list_item *si;
 	struct configset_list_item *l_item;
-	struct key_value_info *kv_info = xmalloc(sizeof(*kv_info));
 
 	e = configset_find_element(cs, key);
 	/*
@@ -1965,6 +2038,12 @@ static int configset_add_value(struct config_set *cs, const char *key, const cha
 	l_item = &cs->list.items[cs->list.nr++];
 	l_item->e = e;
 	l_item->value_index = e->value_list.nr - 1;
+	si->util = kv_info;
+}
+
+static int configset_add_value(struct config_set *cs, const char *key, const char *value)
+{
+	struct key_value_info *kv_info = xmalloc(sizeof(*kv_info));
 
 	if (!cf)
 		BUG("configset_add_value has no source");
@@ -1979,7 +2058,7 @@ static int configset_add_value(struct config_set *cs, const char *key, const cha
 		kv_info->origin_type = CONFIG_ORIGIN_CMDLINE;
 	}
 	kv_info->scope = current_parsing_scope;
-	si->util = kv_info;
+	configset_add_value_kvi(cs, key, value, kv_info);
 
 	return 0;
 }
@@ -2147,9 +2226,489 @@ int git_configset_get_pathname(struct config_set *cs, const char *key, const cha
 }
 
 /* Functions use to read configuration from a repository */
+/*
+ * The config cache.
+ *
+ * With core.configCache set in the system or global configuration, the
+ * values read from the configuration files are stored in two caches,
+ * together with the stat data of every file that was read or looked
+ * for:
+ *
+ *  - the values of the system and global files (and the files they
+ *    include) in $XDG_CACHE_HOME/git/config-cache, or
+ *    $HOME/.cache/git/config-cache, which is shared by all
+ *    repositories of the user;
+ *
+ *  - the values of the repository's config and config.worktree (and
+ *    the files they include) in $GIT_DIR/config-cache.
+ *
+ * Later processes load the values from there instead of parsing the
+ * files again, as long as none of these files has changed.  Anything
+ * that does not check out makes us parse the files as usual.
+ *
+ * Whoever can write to a repository can write its config-cache, so
+ * nothing in it may claim more than the repository's own config
+ * could: its values may only have the local or worktree scope, and it
+ * is only read once core.configCache has been found in the system and
+ * global values, which come from a place the user controls.  The user
+ * cache is only used if its own values turn core.configCache on.
+ *
+ * The result of an include can depend on more than the files: "~" in
+ * include.path and in "gitdir:" conditions is $HOME, and "gitdir:"
+ * conditions depend on the repository.  $HOME is part of the
+ * fingerprint of both caches, and a cache whose files have a "gitdir:"
+ * condition records the repository it was built for, and is stale in
+ * any other one.  "onbranch:" conditions depend on HEAD, which cannot
+ * be checked cheaply; files using them are not cached at all.
+ *
+ * The file is a sequence of 32-bit network order integers and strings
+ * (a length followed by the bytes):
+ *
+ *   "CFGC", version, fingerprint (see config_cache_fingerprint()),
+ *   whether a "gitdir:" condition was evaluated, and if so the real
+ *     path of the git directory it was evaluated for,
+ *   number of files, then for each: path, scope, whether it exists,
+ *     and if so its stat data (ctime sec/nsec, mtime sec/nsec, dev,
+ *     ino, uid, gid, size),
+ *   number of values, then for each: key, whether it has a value,
+ *     the value, the position of its file and its line number.
+ */
+#define CONFIG_CACHE_SIGNATURE 0x43464743 /* "CFGC" */
+#define CONFIG_CACHE_VERSION 3
+
+/*
+ * The same repository may be reached as "." (e.g. by upload-pack) or as
+ * ".git", or through a symbolic link, so the cache refers to directories
+ * and files by their real paths only.
+ */
+static void config_cache_real_path(struct strbuf *sb, const char *path)
+{
+	strbuf_reset(sb);
+	if (!path)
+		return;
+	if (!strbuf_realpath(sb, path, 0)) {
+		strbuf_reset(sb);
+		strbuf_add_absolute_path(sb, path);
+	}
+}
+
+/*
+ * What decides which files are read, and what "~" expands to in them:
+ * the locations of the system and global files for the user cache, the
+ * repository for $GIT_DIR/config-cache.
+ */
+static void config_cache_fingerprint(struct strbuf *sb,
+				     const struct config_options *opts,
+				     int global)
+{
+	const char *home = getenv("HOME");
+
+	strbuf_addf(sb, "%s\n%s\n", git_version_string, home ? home : "");
+	if (global) {
+		char *xdg_config = xdg_config_home("config");
+		char *user_config = expand_user_path("~/.gitconfig", 0);
+
+		strbuf_addf(sb, "%s\n%s\n%s\n",
+			    git_config_system() ? git_etc_gitconfig() : "",
+			    xdg_config ? xdg_config : "",
+			    user_config ? user_config : "");
+		free(xdg_config);
+		free(user_config);
+	} else {
+		struct strbuf commondir = STRBUF_INIT, git_dir = STRBUF_INIT;
+
+		config_cache_real_path(&commondir, opts->commondir);
+		config_cache_real_path(&git_dir, opts->git_dir);
+		strbuf_addf(sb, "%s\n%s\n%d\n", commondir.buf, git_dir.buf,
+			    repository_format_worktree_config);
+		strbuf_release(&commondir);
+		strbuf_release(&git_dir);
+	}
+}
+
+static void put_cache_u32(struct strbuf *sb, uint32_t v)
+{
+	unsigned char buf[4];
+
+	put_be32(buf, v);
+	strbuf_add(sb, buf, sizeof(buf));
+}
+
+static void put_cache_str(struct strbuf *sb, const char *str)
+{
+	size_t len = strlen(str);
+
+	put_cache_u32(sb, len);
+	strbuf_add(sb, str, len);
+}
+
+struct config_cache_reader {
+	const unsigned char *p, *end;
+	int bad;
+};
+
+static uint32_t get_cache_u32(struct config_cache_reader *r)
+{
+	uint32_t v;
+
+	if (r->bad || r->end - r->p < 4) {
+		r->bad = 1;
+		return 0;
+	}
+	v = get_be32(r->p);
+	r->p += 4;
+	return v;
+}
+
+static const char *get_cache_str(struct config_cache_reader *r,
+				 struct strbuf *sb)
+{
+	uint32_t len = get_cache_u32(r);
+
+	strbuf_reset(sb);
+	if (r->bad || r->end - r->p < len) {
+		r->bad = 1;
+		return "";
+	}
+	strbuf_add(sb, r->p, len);
+	r->p += len;
+	return sb->buf;
+}
+
+static int config_cache_file_changed(struct config_cache_reader *r,
+				     struct strbuf *path)
+{
+	struct stat st;
+	int exists;
+	int i;
+
+	exists = get_cache_u32(r);
+	if (exists) {
+		struct stat_data sd;
+		unsigned int *fields[] = {
+			&sd.sd_ctime.sec, &sd.sd_ctime.nsec,
+			&sd.sd_mtime.sec, &sd.sd_mtime.nsec,
+			&sd.sd_dev, &sd.sd_ino, &sd.sd_uid, &sd.sd_gid,
+			&sd.sd_size,
+		};
+
+		for (i = 0; i < ARRAY_SIZE(fields); i++)
+			*fields[i] = get_cache_u32(r);
+		if (r->bad)
+			return 1;
+		return stat(path->buf, &st) || match_stat_data(&sd, &st);
+	}
+	if (r->bad)
+		return 1;
+	return !stat(path->buf, &st) || (errno != ENOENT && errno != ENOTDIR);
+}
+
+static int config_cache_scope_ok(enum config_scope scope, int global)
+{
+	if (global)
+		return scope == CONFIG_SCOPE_SYSTEM ||
+		       scope == CONFIG_SCOPE_GLOBAL;
+	return scope == CONFIG_SCOPE_LOCAL || scope == CONFIG_SCOPE_WORKTREE;
+}
+
+/*
+ * Add the values in the config cache at "path" to "cs"; "global" tells
+ * the user cache from $GIT_DIR/config-cache.  Returns 0 on success, 1
+ * if there is no cache and -1 if it cannot be used; "cs" is left alone
+ * in both cases.
+ */
+static int read_config_cache(struct config_set *cs, const char *path,
+			     const struct config_options *opts, int global)
+{
+	struct config_cache_reader r = { NULL };
+	struct strbuf fingerprint = STRBUF_INIT;
+	struct strbuf key = STRBUF_INIT, value = STRBUF_INIT;
+	struct strbuf filename = STRBUF_INIT;
+	const char **filenames = NULL;
+	enum config_scope *scopes = NULL;
+	struct stat st;
+	void *map;
+	const unsigned char *values;
+	size_t size;
+	uint32_t i, nr, nr_files;
+	int fd, ret = -1, use_cache = 0;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return errno == ENOENT ? 1 : -1;
+	if (fstat(fd, &st) || !st.st_size) {
+		close(fd);
+		return -1;
+	}
+	size = xsize_t(st.st_size);
+	map = xmmap_gently(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return -1;
+	r.p = map;
+	r.end = r.p + size;
+
+	if (get_cache_u32(&r) != CONFIG_CACHE_SIGNATURE ||
+	    get_cache_u32(&r) != CONFIG_CACHE_VERSION)
+		goto out;
+	config_cache_fingerprint(&fingerprint, opts, global);
+	if (strcmp(get_cache_str(&r, &value), fingerprint.buf))
+		goto out;
+	if (get_cache_u32(&r)) {
+		config_cache_real_path(&fingerprint, opts->git_dir);
+		if (strcmp(get_cache_str(&r, &value), fingerprint.buf))
+			goto out;
+	}
+
+	nr_files = get_cache_u32(&r);
+	if (r.bad || nr_files > r.end - r.p)
+		goto out;
+	ALLOC_ARRAY(filenames, nr_files);
+	ALLOC_ARRAY(scopes, nr_files);
+	for (i = 0; i < nr_files; i++) {
+		get_cache_str(&r, &filename);
+		scopes[i] = get_cache_u32(&r);
+		if (!config_cache_scope_ok(scopes[i], global) ||
+		    config_cache_file_changed(&r, &filename))
+			goto out;
+		filenames[i] = strintern(filename.buf);
+	}
+
+	/*
+	 * Check all values before adding any, so that "cs" is left alone
+	 * if the cache turns out to be unusable.
+	 */
+	nr = get_cache_u32(&r);
+	values = r.p;
+	for (i = 0; i < nr && !r.bad; i++) {
+		int has_value;
+
+		get_cache_str(&r, &key);
+		has_value = get_cache_u32(&r);
+		get_cache_str(&r, &value);
+		if (!strcmp(key.buf, "core.configcache"))
+			use_cache = !has_value ||
+				    git_parse_maybe_bool(value.buf) > 0;
+		if (get_cache_u32(&r) >= nr_files)
+			r.bad = 1;
+		get_cache_u32(&r);
+	}
+	if (r.bad || r.p != r.end)
+		goto out;
+	/* the user cache is only there while its files turn it on */
+	if (global && !use_cache)
+		goto out;
+
+	r.p = values;
+	for (i = 0; i < nr; i++) {
+		struct key_value_info *kv_info = xmalloc(sizeof(*kv_info));
+		uint32_t file;
+		int has_value;
+
+		get_cache_str(&r, &key);
+		has_value = get_cache_u32(&r);
+		get_cache_str(&r, &value);
+		file = get_cache_u32(&r);
+		kv_info->filename = filenames[file];
+		kv_info->linenr = (int)get_cache_u32(&r);
+		kv_info->origin_type = CONFIG_ORIGIN_FILE;
+		kv_info->scope = scopes[file];
+		configset_add_value_kvi(cs, key.buf,
+					has_value ? value.buf : NULL, kv_info);
+	}
+	ret = 0;
+
+out:
+	munmap(map, size);
+	free(filenames);
+	free(scopes);
+	strbuf_release(&fingerprint);
+	strbuf_release(&key);
+	strbuf_release(&value);
+	strbuf_release(&filename);
+	return ret;
+}
+
+/*
+ * Create the directories leading to "path", accessible to the user
+ * only.  safe_create_leading_directories() would look at
+ * core.sharedRepository, which is being read.
+ */
+static int config_cache_mkdirs(const char *path)
+{
+	struct strbuf dir = STRBUF_INIT;
+	const char *slash = path;
+	int ret = 0;
+
+	while (!ret && (slash = strchr(slash + 1, '/'))) {
+		strbuf_reset(&dir);
+		strbuf_add(&dir, path, slash - path);
+		if (mkdir(dir.buf, 0700) && errno != EEXIST)
+			ret = -1;
+	}
+	strbuf_release(&dir);
+	return ret;
+}
+
+/*
+ * Write the values of "cs" from the "first" one on, which must have been
+ * read from "files", to the config cache at "path".
+ */
+static void write_config_cache(struct config_set *cs, int first,
+			       const char *path,
+			       struct config_cache_files *files,
+			       const struct config_options *opts, int global)
+{
+	struct lock_file lk = LOCK_INIT;
+	struct strbuf sb = STRBUF_INIT, real = STRBUF_INIT;
+	time_t now = time(NULL);
+	int i;
+
+	put_cache_u32(&sb, CONFIG_CACHE_SIGNATURE);
+	put_cache_u32(&sb, CONFIG_CACHE_VERSION);
+	config_cache_fingerprint(&real, opts, global);
+	put_cache_str(&sb, real.buf);
+	put_cache_u32(&sb, files->uses_git_dir);
+	if (files->uses_git_dir) {
+		config_cache_real_path(&real, opts->git_dir);
+		put_cache_str(&sb, real.buf);
+	}
+
+	put_cache_u32(&sb, files->paths.nr);
+	for (i = 0; i < files->paths.nr; i++) {
+		struct config_cache_file *file = files->paths.items[i].util;
+		struct stat_data *sd = &file->sd;
+
+		config_cache_real_path(&real, files->paths.items[i].string);
+		put_cache_str(&sb, real.buf);
+		put_cache_u32(&sb, file->scope);
+		put_cache_u32(&sb, file->exists);
+		if (!file->exists)
+			continue;
+		/*
+		 * A file modified again within the same second might
+		 * not show up in its stat data; do not cache it yet.
+		 */
+		if (sd->sd_mtime.sec >= now)
+			goto out;
+		put_cache_u32(&sb, sd->sd_ctime.sec);
+		put_cache_u32(&sb, sd->sd_ctime.nsec);
+		put_cache_u32(&sb, sd->sd_mtime.sec);
+		put_cache_u32(&sb, sd->sd_mtime.nsec);
+		put_cache_u32(&sb, sd->sd_dev);
+		put_cache_u32(&sb, sd->sd_ino);
+		put_cache_u32(&sb, sd->sd_uid);
+		put_cache_u32(&sb, sd->sd_gid);
+		put_cache_u32(&sb, sd->sd_size);
+	}
+
+	put_cache_u32(&sb, cs->list.nr - first);
+	for (i = first; i < cs->list.nr; i++) {
+		struct config_set_element *e = cs->list.items[i].e;
+		struct string_list_item *si =
+			&e->value_list.items[cs->list.items[i].value_index];
+		const struct key_value_info *kv_info = si->util;
+		int file;
+
+		for (file = 0; file < files->paths.nr; file++)
+			if (kv_info->filename &&
+			    !strcmp(kv_info->filename,
+				    files->paths.items[file].string))
+				break;
+		if (file == files->paths.nr)
+			goto out; /* not from a file we can check */
+
+		put_cache_str(&sb, e->key);
+		put_cache_u32(&sb, !!si->string);
+		put_cache_str(&sb, si->string ? si->string : "");
+		put_cache_u32(&sb, file);
+		put_cache_u32(&sb, kv_info->linenr);
+	}
+
+	/* a place we cannot write to simply goes without a cache */
+	if (global && config_cache_mkdirs(path))
+		goto out;
+	if (hold_lock_file_for_update(&lk, path, 0) < 0)
+		goto out;
+	if (write_in_full(get_lock_file_fd(&lk), sb.buf, sb.len) < 0 ||
+	    commit_lock_file(&lk) < 0)
+		rollback_lock_file(&lk);
+
+out:
+	strbuf_release(&sb);
+	strbuf_release(&real);
+}
+
+/*
+ * Read the files of one config cache (the system and global ones if
+ * "global", the repository's otherwise) into the configuration of
+ * "repo", or load their values from the cache at "cache_path" if it is
+ * up to date.  "cache_path" is
+ * NULL if the cache is not to be used.
+ */
+static void read_cached_config_sequence(struct repository *repo,
+					const char *cache_path,
+					struct config_include_data *inc,
+					int global)
+{
+	struct config_set *cs = repo->config;
+	struct config_cache_files files = { STRING_LIST_INIT_DUP };
+	int first = cs->list.nr;
+	int cache_state = 1;
+	int use_cache = 1;
+	int ret;
+
+	if (cache_path) {
+		cache_state = read_config_cache(cs, cache_path, inc->opts,
+						global);
+		trace2_data_string("config", repo,
+				   global ? "global-cache" : "cache",
+				   !cache_state ? "hit" :
+				   cache_state > 0 ? "none" : "stale");
+	}
+	if (!cache_state)
+		return;
+
+	if (cache_path)
+		config_cache_files = &files;
+	/*
+	 * config_with_options() normally returns only zero, as most
+	 * errors are fatal, and non-fatal potential errors are guarded by
+	 * "if" statements that are entered only when no error is possible.
+	 *
+	 * If we ever encounter a non-fatal error, it means something went
+	 * really wrong and we should stop immediately.
+	 */
+	if (global)
+		ret = do_protected_config_sequence(inc->opts,
+						   git_config_include, inc);
+	else
+		ret = do_repo_config_sequence(inc->opts,
+					      git_config_include, inc);
+	if (ret < 0)
+		die(_("unknown error occurred while reading the configuration files"));
+	config_cache_files = NULL;
+
+	/* drop a stale cache even if it cannot be replaced below */
+	if (cache_state < 0)
+		unlink(cache_path);
+	if (global &&
+	    (git_configset_get_bool(cs, "core.configcache", &use_cache) ||
+	     !use_cache))
+		cache_path = NULL;
+	if (cache_path && !files.uncacheable)
+		write_config_cache(cs, first, cache_path, &files, inc->opts,
+				   global);
+	string_list_clear(&files.paths, 1);
+}
+
 static void repo_read_config(struct repository *repo)
 {
 	struct config_options opts = { 0 };
+	struct config_include_data inc = CONFIG_INCLUDE_INIT;
+	enum config_scope prev_parsing_scope = current_parsing_scope;
+	char *cache_path;
+	int use_cache = 0;
 
 	opts.respect_includes = 1;
 	opts.commondir = repo->commondir;
@@ -2162,19 +2721,27 @@ static void repo_read_config(struct repository *repo)
 
 	git_configset_init(repo->config);
 
-	if (config_with_options(config_set_callback, repo->config, NULL, &opts) < 0)
-		/*
-		 * config_with_options() normally returns only
-		 * zero, as most errors are fatal, and
-		 * non-fatal potential errors are guarded by "if"
-		 * statements that are entered only when no error is
-		 * possible.
-		 *
-		 * If we ever encounter a non-fatal error, it means
-		 * something went really wrong and we should stop
-		 * immediately.
-		 */
-		die(_("unknown error occurred while reading the configuration files"));
+	inc.fn = config_set_callback;
+	inc.data = repo->config;
+	inc.opts = &opts;
+
+	cache_path = xdg_cache_home("config-cache");
+	read_cached_config_sequence(repo, cache_path, &inc, 1);
+	free(cache_path);
+
+	/* only the system and global files may turn the cache on */
+	cache_path = NULL;
+	if (repo->gitdir && repo->commondir &&
+	    !git_configset_get_bool(repo->config, "core.configcache",
+				    &use_cache) && use_cache)
+		cache_path = mkpathdup("%s/config-cache", repo->gitdir);
+	read_cached_config_sequence(repo, cache_path, &inc, 0);
+	free(cache_path);
+
+	current_parsing_scope = CONFIG_SCOPE_COMMAND;
+	if (git_config_from_parameters(git_config_include, &inc) < 0)
+		die(_("unable to parse command-line config"));
+	current_parsing_scope = prev_parsing_scope;
 }
 
 static void git_config_check_init(struct repository *repo)
@@ -0,0 +1,5 @@
+NO_GETTEXT=1
+NO_TCLTK=1
+DEVELOPER=1
+DEVOPTS=no-error
+CURL_CONFIG=/usr/bin/curl-config
@@ -10,6 +10,7 @@
 #include "url.h"
 #include "string-list.h"
 #include "oid-array.h"
+#include "object.h"
 #include "transport.h"
 #include "strbuf.h"
 #include "version.h"
@@ -509,6 +510,81 @@ struct ref **get_remote_refs(int fd_out, struct packet_reader *reader,
 	return list;
 }
 
+/*
+ * Parse one "<oid> <size> <type>" line of an object-info response. An
+ * empty size or type means the server does not have the object.
+ */
+static int process_object_info_line(const char *line,
+				    const struct object_id *oid,
+				    unsigned long *size,
+				    enum object_type *type)
+{
+	struct object_id got;
+	const char *p;
+	char *end;
+
+	*type = OBJ_BAD;
+	if (parse_oid_hex(line, &got, &p) || !oideq(&got, oid) || *p++ != ' ')
+		return 0;
+	if (*p == ' ')
+		return !strcmp(p, " ");
+	*size = strtoul(p, &end, 10);
+	if (end == p || *end++ != ' ')
+		return 0;
+	*type = type_from_string_gently(end, -1, 1);
+	return *type > 0;
+}
+
+int get_remote_object_info(int fd_out, struct packet_reader *reader,
+			   const struct oid_array *oids,
+			   unsigned long *sizes, enum object_type *types,
+			   const struct string_list *server_options,
+			   int stateless_rpc)
+{
+	int i;
+
+	if (!server_supports_v2("object-info", 0))
+		return -1;
+	if (!oids->nr)
+		return 0;
+
+	packet_write_fmt(fd_out, "command=object-info\n");
+	if (server_supports_v2("agent", 0))
+		packet_write_fmt(fd_out, "agent=%s", git_user_agent_sanitized());
+	if (server_options && server_options->nr &&
+	    server_supports_v2("server-option", 1))
+		for (i = 0; i < server_options->nr; i++)
+			packet_write_fmt(fd_out, "server-option=%s",
+					 server_options->items[i].string);
+	packet_delim(fd_out);
+	packet_write_fmt(fd_out, "size\n");
+	packet_write_fmt(fd_out, "type\n");
+	for (i = 0; i < oids->nr; i++)
+		packet_write_fmt(fd_out, "oid %s\n", oid_to_hex(&oids->oid[i]));
+	packet_flush(fd_out);
+
+	/* Process response from server */
+	if (packet_reader_read(reader) != PACKET_READ_NORMAL ||
+	    strcmp(reader->line, "attrs size type"))
+		die(_("invalid object-info response: %s"),
+		    reader->status == PACKET_READ_NORMAL ? reader->line : "");
+	for (i = 0; i < oids->nr; i++) {
+		if (packet_reader_read(reader) != PACKET_READ_NORMAL ||
+		    !process_object_info_line(reader->line, &oids->oid[i],
+					      &sizes[i], &types[i]))
+			die(_("invalid object-info response: %s"),
+			    reader->status == PACKET_READ_NORMAL ?
+			    reader->line : "");
+	}
+	if (packet_reader_read(reader) != PACKET_READ_FLUSH)
+		die(_("expected flush after object-info response"));
+
+	check_stateless_delimiter(stateless_rpc, reader,
+				  _("expected response end packet after object-info"));
+
+	return 0;
+}
+
 const char *parse_feature_value(const char *feature_list, const char *feature, int *lenp, int *offset)
 {
 	int len;
@@ -0,0 +1,275 @@
+#include "cache.h"
+#include "commit.h"
+#include "commit-slab.h"
+#include "csum-file.h"
+#include "lockfile.h"
+#include "object-store.h"
+#include "repository.h"
+#include "sha1-lookup.h"
+#include "depth-cache.h"
+
+#define DEPTH_CACHE_SIGNATURE 0x44505448 /* "DPTH" */
+#define DEPTH_CACHE_VERSION 1
+#define DEPTH_CACHE_FANOUT_SIZE (4 * 256)
+
+/*
+ * Depths that depend on a commit that could not be parsed are used for
+ * this walk, but never stored.
+ */
+#define DEPTH_UNSTORED (1U << 31)
+#define DEPTH_MASK (DEPTH_UNSTORED - 1)
+
+define_commit_slab(depth_slab, uint32_t);
+
+struct depth_cache {
+	struct repository *r;
+	char *path;
+	struct object_id key;
+
+	/* The mapped file, if it was computed with the same parents. */
+	const unsigned char *data;
+	size_t data_len;
+	const uint32_t *fanout;
+	const unsigned char *table;
+	size_t stride;
+	uint32_t nr;
+
+	struct depth_slab depths;
+	struct commit **computed;
+	size_t computed_nr, computed_alloc;
+	intmax_t computed_total;
+};
+
+int depth_cache_enabled(struct repository *r)
+{
+	if (!r->gitdir)
+		return 0;
+	prepare_repo_settings(r);
+	return r->settings.core_depth_cache > 0;
+}
+
+/*
+ * Hash everything that can change the parents of a commit, so that the
+ * depths are only reused with the same history.
+ */
+static void compute_key(struct repository *r, struct object_id *key)
+{
+	git_hash_ctx ctx;
+
+	r->hash_algo->init_fn(&ctx);
+	hash_commit_parent_rewrites(r, &ctx);
+	r->hash_algo->final_fn(key->hash, &ctx);
+}
+
+static void load_depth_cache(struct depth_cache *dc)
+{
+	const size_t hashsz = dc->r->hash_algo->rawsz;
+	const size_t header_size = 12 + hashsz + 4;
+	const unsigned char *data;
+	struct stat st;
+	size_t size;
+	int fd;
+
+	fd = git_open(dc->path);
+	if (fd < 0)
+		return;
+	if (fstat(fd, &st)) {
+		close(fd);
+		return;
+	}
+	size = xsize_t(st.st_size);
+	if (size < header_size + DEPTH_CACHE_FANOUT_SIZE + hashsz) {
+		close(fd);
+		return;
+	}
+	data = xmmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	dc->stride = hashsz + 4;
+	dc->nr = get_be32(data + 12 + hashsz);
+	dc->fanout = (const uint32_t *)(data + header_size);
+	dc->table = data + header_size + DEPTH_CACHE_FANOUT_SIZE;
+
+	if (get_be32(data) != DEPTH_CACHE_SIGNATURE ||
+	    get_be32(data + 4) != DEPTH_CACHE_VERSION ||
+	    get_be32(data + 8) != dc->r->hash_algo->format_id ||
+	    memcmp(data + 12, dc->key.hash, hashsz) ||
+	    (size - header_size - DEPTH_CACHE_FANOUT_SIZE - hashsz) / dc->stride != dc->nr ||
+	    ntohl(dc->fanout[255]) != dc->nr) {
+		munmap((void *)data, size);
+		dc->nr = 0;
+		return;
+	}
+
+	dc->data = data;
+	dc->data_len = size;
+}
+
+struct depth_cache *depth_cache_open(struct repository *r)
+{
+	struct depth_cache *dc;
+
+	if (!depth_cache_enabled(r))
+		return NULL;
+
+	dc = xcalloc(1, sizeof(*dc));
+	dc->r = r;
+	dc->path = xstrfmt("%s/info/depth-cache", r->objects->odb->path);
+	compute_key(r, &dc->key);
+	init_depth_slab(&dc->depths);
+	load_depth_cache(dc);
+	return dc;
+}
+
+static uint32_t stored_depth(struct depth_cache *dc, const struct object_id *oid)
+{
+	uint32_t pos;
+
+	if (!dc->data ||
+	    !bsearch_hash(oid->hash, dc->fanout, dc->table, dc->stride, &pos))
+		return 0;
+	return get_be32(dc->table + pos * dc->stride + dc->r->hash_algo->rawsz);
+}
+
+uint32_t depth_cache_get(struct depth_cache *dc, struct commit *c)
+{
+	struct commit_list *stack = NULL;
+	uint32_t *slot = depth_slab_at(&dc->depths, c);
+
+	if (*slot)
+		return *slot & DEPTH_MASK;
+
+	commit_list_insert(c, &stack);
+	while (stack) {
+		struct commit *current = stack->item;
+		struct commit_list *p;
+		uint32_t max = 0, unstored = 0;
+		int all_known = 1;
+
+		slot = depth_slab_at(&dc->depths, current);
+		if (*slot) {
+			pop_commit(&stack);
+			continue;
+		}
+		if ((*slot = stored_depth(dc, &current->object.oid))) {
+			pop_commit(&stack);
+			continue;
+		}
+		if (repo_parse_commit_gently(dc->r, current, 1) < 0) {
+			*slot = 1 | DEPTH_UNSTORED;
+			pop_commit(&stack);
+			continue;
+		}
+
+		for (p = current->parents; p; p = p->next) {
+			uint32_t depth = *depth_slab_at(&dc->depths, p->item);
+
+			if (!depth) {
+				all_known = 0;
+				commit_list_insert(p->item, &stack);
+			} else {
+				unstored |= depth & DEPTH_UNSTORED;
+				if ((depth & DEPTH_MASK) > max)
+					max = depth & DEPTH_MASK;
+			}
+		}
+		if (!all_known)
+			continue;
+
+		/* depth_slab_at() may have moved the slot */
+		slot = depth_slab_at(&dc->depths, current);
+		*slot = (max + 1) | unstored;
+		if (!unstored) {
+			ALLOC_GROW(dc->computed, dc->computed_nr + 1,
+				   dc->computed_alloc);
+			dc->computed[dc->computed_nr++] = current;
+		}
+		dc->computed_total++;
+		pop_commit(&stack);
+	}
+
+	return *depth_slab_at(&dc->depths, c) & DEPTH_MASK;
+}
+
+struct depth_entry {
+	const unsigned char *hash;
+	uint32_t depth;
+};
+
+static int compare_commits_by_oid(const void *a_, const void *b_)
+{
+	const struct commit *a = *(const struct commit **)a_;
+	const struct commit *b = *(const struct commit **)b_;
+
+	return oidcmp(&a->object.oid, &b->object.oid);
+}
+
+void depth_cache_write(struct depth_cache *dc)
+{
+	const size_t hashsz = dc->r->hash_algo->rawsz;
+	struct lock_file lk = LOCK_INIT;
+	struct depth_entry *entries;
+	struct hashfile *f;
+	size_t nr = 0, i = 0, j = 0;
+	int b;
+
+	trace2_data_intmax("revision", dc->r, "depth-cache/computed",
+			   dc->computed_total);
+	if (!dc->computed_nr)
+		return;
+	if (safe_create_leading_directories_const(dc->path) ||
+	    hold_lock_file_for_update(&lk, dc->path, 0) < 0)
+		goto out;
+
+	QSORT(dc->computed, dc->computed_nr, compare_commits_by_oid);
+	ALLOC_ARRAY(entries, dc->nr + dc->computed_nr);
+	while (i < dc->nr || j < dc->computed_nr) {
+		const unsigned char *old = i < dc->nr ?
+			dc->table + i * dc->stride : NULL;
+		struct commit *new = j < dc->computed_nr ? dc->computed[j] : NULL;
+
+		if (old && (!new || hashcmp(old, new->object.oid.hash) < 0)) {
+			entries[nr].hash = old;
+			entries[nr++].depth = get_be32(old + hashsz);
+			i++;
+		} else {
+			entries[nr].hash = new->object.oid.hash;
+			entries[nr++].depth = *depth_slab_at(&dc->depths, new);
+			j++;
+		}
+	}
+
+	f = hashfd(get_lock_file_fd(&lk), get_lock_file_path(&lk));
+	hashwrite_be32(f, DEPTH_CACHE_SIGNATURE);
+	hashwrite_be32(f, DEPTH_CACHE_VERSION);
+	hashwrite_be32(f, dc->r->hash_algo->format_id);
+	hashwrite(f, dc->key.hash, hashsz);
+	hashwrite_be32(f, nr);
+	for (i = 0, b = 0; b < 256; b++) {
+		while (i < nr && entries[i].hash[0] <= b)
+			i++;
+		hashwrite_be32(f, i);
+	}
+	for (i = 0; i < nr; i++) {
+		hashwrite(f, entries[i].hash, hashsz);
+		hashwrite_be32(f, entries[i].depth);
+	}
+	finalize_hashfile(f, NULL, CSUM_HASH_IN_STREAM);
+	commit_lock_file(&lk);
+	free(entries);
+
+out:
+	dc->computed_nr = 0;
+}
+
+void depth_cache_free(struct depth_cache *dc)
+{
+	if (!dc)
+		return;
+	if (dc->data)
+		munmap((void *)dc->data, dc->data_len);
+	clear_depth_slab(&dc->depths);
+	free(dc->computed);
+	free(dc->path);
+	free(dc);
+}
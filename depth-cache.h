@@ -0,0 +1,48 @@
+#ifndef DEPTH_CACHE_H
+#define DEPTH_CACHE_H
+
+#define GIT_TEST_DEPTH_CACHE "GIT_TEST_DEPTH_CACHE"
+
+struct commit;
+struct repository;
+struct depth_cache;
+
+/*
+ * The depth cache stores, for each commit, one more than the largest
+ * depth of its parents (1 for root commits). Like the generation numbers
+ * of the commit-graph, a commit's depth is always larger than that of
+ * its parents, which is all the incremental "--topo-order" walk needs.
+ *
+ * The cache is a side file in the object directory. Unlike the
+ * commit-graph, it is usable when grafts, replace refs or a shallow
+ * clone change the parents of commits: the file records which of them
+ * it was computed with, and is ignored when they differ.
+ */
+
+/*
+ * Return 1 if "core.depthCache" is set, so that the "--topo-order" walk
+ * can stream without generation numbers from the commit-graph.
+ */
+int depth_cache_enabled(struct repository *r);
+
+/*
+ * Open the depth cache of `r`, or return NULL if it is disabled.
+ */
+struct depth_cache *depth_cache_open(struct repository *r);
+
+/*
+ * Return the depth of `c`, computing and remembering the depths of any
+ * of its ancestors that are not in the cache yet.
+ */
+uint32_t depth_cache_get(struct depth_cache *dc, struct commit *c);
+
+/*
+ * Store the depths computed since the cache was opened or last written.
+ * Failing to take the lock is not an error; the depths are then simply
+ * computed again next time.
+ */
+void depth_cache_write(struct depth_cache *dc);
+
+void depth_cache_free(struct depth_cache *dc);
+
+#endif
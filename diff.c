@@ -206,6 +206,8 @@ long parse_algorithm_value(const char *value)
 		return XDF_PATIENCE_DIFF;
 	else if (!strcasecmp(value, "histogram"))
 		return XDF_HISTOGRAM_DIFF;
+	else if (!strcasecmp(value, "chunked"))
+		return XDF_CHUNKED_DIFF;
 	/*
 	 * Please update $__git_diff_algorithms in git-completion.bash
 	 * when you add new algorithms.
@@ -5053,7 +5055,8 @@ static int diff_opt_diff_algorithm(const struct option *opt,
 	BUG_ON_OPT_NEG(unset);
 	if (value < 0)
 		return error(_("option diff-algorithm accepts \"myers\", "
-			       "\"minimal\", \"patience\" and \"histogram\""));
+			       "\"minimal\", \"patience\", \"histogram\" "
+			       "and \"chunked\""));
 
 	/* clear out previous settings */
 	DIFF_XDL_CLR(options, NEED_MINIMAL);
@@ -19,6 +19,7 @@
 #include "fsmonitor.h"
 #include "submodule-config.h"
 #include "virtualfilesystem.h"
+#include "thread-utils.h"
 
 /*
  * Tells read_directory_recursive how a file or directory should be treated.
@@ -38,6 +39,9 @@ enum path_treatment {
  */
 struct cached_dir {
 	DIR *fdir;
+	struct dir_listing *listing;
+	size_t listing_nr;
+	size_t listing_off;
 	struct untracked_cache_dir *untracked;
 	int nr_files;
 	int nr_dirs;
@@ -865,6 +869,170 @@ int hashmap_contains_parent(struct hashmap *map,
 	return 0;
 }
 
+/*
+ * Long pattern lists (e.g. generated .gitignore files) are mostly made
+ * of literal names, "*.ext" suffixes and literal paths.  Those are put
+ * in hashmaps keyed on the text they must match, so that only the
+ * remaining glob patterns need to be tried one by one.  Every hashed
+ * pattern remembers its position in the list, which is what lets the
+ * lookup preserve "the last matching pattern wins".
+ */
+#define PATTERN_MATCHER_MIN 32
+
+struct literal_pattern {
+	struct hashmap_entry ent;
+	const char *key;
+	int keylen;
+	int nr, alloc;
+	int *pos;	/* ascending positions in pattern_list.patterns */
+};
+
+struct pattern_matcher {
+	struct hashmap basenames;	/* "name" */
+	struct hashmap suffixes;	/* "*.ext" */
+	struct hashmap pathnames;	/* "dir/name", relative to the top */
+	int *suffix_lens;
+	int suffix_lens_nr, suffix_lens_alloc;
+	int *globs;			/* everything else, ascending */
+	int globs_nr, globs_alloc;
+	struct strbuf keys;
+};
+
+static unsigned int literal_hash(const char *key, int len)
+{
+	return ignore_case ? memihash(key, len) : memhash(key, len);
+}
+
+static int literal_pattern_cmp(const void *unused_cmp_data,
+			       const struct hashmap_entry *eptr,
+			       const struct hashmap_entry *entry_or_key,
+			       const void *keydata)
+{
+	const struct literal_pattern *a, *b;
+
+	a = container_of(eptr, const struct literal_pattern, ent);
+	b = container_of(entry_or_key, const struct literal_pattern, ent);
+
+	return a->keylen != b->keylen || fspathncmp(a->key, b->key, a->keylen);
+}
+
+static struct literal_pattern *find_literal(struct hashmap *map,
+					    const char *key, int keylen)
+{
+	struct literal_pattern k;
+
+	hashmap_entry_init(&k.ent, literal_hash(key, keylen));
+	k.key = key;
+	k.keylen = keylen;
+	return hashmap_get_entry(map, &k, ent, NULL);
+}
+
+static void add_literal(struct hashmap *map, const char *key, int keylen,
+			int pos)
+{
+	struct literal_pattern *l = find_literal(map, key, keylen);
+
+	if (!l) {
+		CALLOC_ARRAY(l, 1);
+		hashmap_entry_init(&l->ent, literal_hash(key, keylen));
+		l->key = key;
+		l->keylen = keylen;
+		hashmap_add(map, &l->ent);
+	}
+	ALLOC_GROW(l->pos, l->nr + 1, l->alloc);
+	l->pos[l->nr++] = pos;
+}
+
+static void free_literals(struct hashmap *map)
+{
+	struct hashmap_iter iter;
+	struct literal_pattern *l;
+
+	hashmap_for_each_entry(map, &iter, l, ent)
+		free(l->pos);
+	hashmap_free_entries(map, struct literal_pattern, ent);
+}
+
+static void free_pattern_matcher(struct pattern_matcher *m)
+{
+	if (!m)
+		return;
+	free_literals(&m->basenames);
+	free_literals(&m->suffixes);
+	free_literals(&m->pathnames);
+	free(m->suffix_lens);
+	free(m->globs);
+	strbuf_release(&m->keys);
+	free(m);
+}
+
+static struct pattern_matcher *build_pattern_matcher(struct pattern_list *pl)
+{
+	struct pattern_matcher *m;
+	int i, j;
+
+	CALLOC_ARRAY(m, 1);
+	hashmap_init(&m->basenames, literal_pattern_cmp, NULL, 0);
+	hashmap_init(&m->suffixes, literal_pattern_cmp, NULL, 0);
+	hashmap_init(&m->pathnames, literal_pattern_cmp, NULL, 0);
+
+	/*
+	 * Literal paths are keyed on base + pattern; build those keys
+	 * first so that m->keys is not reallocated under the maps.
+	 */
+	strbuf_init(&m->keys, 0);
+	for (i = 0; i < pl->nr; i++) {
+		struct path_pattern *p = pl->patterns[i];
+		const char *name = p->pattern;
+		int len = p->patternlen;
+
+		if ((p->flags & PATTERN_FLAG_NODIR) ||
+		    p->nowildcardlen != p->patternlen)
+			continue;
+		if (*name == '/') {
+			name++;
+			len--;
+		}
+		strbuf_add(&m->keys, p->base, p->baselen);
+		strbuf_add(&m->keys, name, len);
+		strbuf_addch(&m->keys, '\0');
+	}
+
+	for (i = 0, j = 0; i < pl->nr; i++) {
+		struct path_pattern *p = pl->patterns[i];
+
+		if (!(p->flags & PATTERN_FLAG_NODIR)) {
+			if (p->nowildcardlen == p->patternlen) {
+				const char *key = m->keys.buf + j;
+				int keylen = strlen(key);
+
+				add_literal(&m->pathnames, key, keylen, i);
+				j += keylen + 1;
+				continue;
+			}
+		} else if (p->nowildcardlen == p->patternlen) {
+			add_literal(&m->basenames, p->pattern, p->patternlen, i);
+			continue;
+		} else if (p->flags & PATTERN_FLAG_ENDSWITH) {
+			int k, len = p->patternlen - 1;
+
+			add_literal(&m->suffixes, p->pattern + 1, len, i);
+			for (k = 0; k < m->suffix_lens_nr; k++)
+				if (m->suffix_lens[k] == len)
+					break;
+			if (k == m->suffix_lens_nr) {
+				ALLOC_GROW(m->suffix_lens, m->suffix_lens_nr + 1,
+					   m->suffix_lens_alloc);
+				m->suffix_lens[m->suffix_lens_nr++] = len;
+			}
+			continue;
+		}
+		ALLOC_GROW(m->globs, m->globs_nr + 1, m->globs_alloc);
+		m->globs[m->globs_nr++] = i;
+	}
+	return m;
+}
+
 void add_pattern(const char *string, const char *base,
 		 int baselen, struct pattern_list *pl, int srcpos)
 {
@@ -889,6 +1057,10 @@ void add_pattern(const char *string, const char *base,
 	ALLOC_GROW(pl->patterns, pl->nr + 1, pl->alloc);
 	pl->patterns[pl->nr++] = pattern;
 	pattern->pl = pl;
+	if (pl->matcher) {
+		free_pattern_matcher(pl->matcher);
+		pl->matcher = NULL;
+	}
 
 	add_pattern_to_hashsets(pl, pattern);
 }
@@ -924,6 +1096,7 @@ void clear_pattern_list(struct pattern_list *pl)
 	free(pl->filebuf);
 	hashmap_free_entries(&pl->recursive_hashmap, struct pattern_entry, ent);
 	hashmap_free_entries(&pl->parent_hashmap, struct pattern_entry, ent);
+	free_pattern_matcher(pl->matcher);
 
 	memset(pl, 0, sizeof(*pl));
 }
@@ -1331,6 +1504,100 @@ int match_pathname(const char *pathname, int pathlen,
 				 WM_PATHNAME) == 0;
 }
 
+static int path_pattern_matches(struct path_pattern *pattern,
+				const char *pathname, int pathlen,
+				const char *basename, int *dtype,
+				struct index_state *istate)
+{
+	const char *exclude = pattern->pattern;
+	int prefix = pattern->nowildcardlen;
+
+	if (pattern->flags & PATTERN_FLAG_MUSTBEDIR) {
+		*dtype = resolve_dtype(*dtype, istate, pathname, pathlen);
+		if (*dtype != DT_DIR)
+			return 0;
+	}
+
+	if (pattern->flags & PATTERN_FLAG_NODIR)
+		return match_basename(basename,
+				      pathlen - (basename - pathname),
+				      exclude, prefix, pattern->patternlen,
+				      pattern->flags);
+
+	assert(pattern->baselen == 0 ||
+	       pattern->base[pattern->baselen - 1] == '/');
+	return match_pathname(pathname, pathlen,
+			      pattern->base,
+			      pattern->baselen ? pattern->baselen - 1 : 0,
+			      exclude, prefix, pattern->patternlen,
+			      pattern->flags);
+}
+
+/*
+ * Return the position of the last pattern in "l" that matches and comes
+ * after "best" in the list, or "best" if there is none.
+ */
+static int last_matching_literal(struct literal_pattern *l, int best,
+				 const char *pathname, int pathlen,
+				 const char *basename, int *dtype,
+				 struct pattern_list *pl,
+				 struct index_state *istate)
+{
+	int i;
+
+	if (!l)
+		return best;
+	for (i = l->nr - 1; 0 <= i && best < l->pos[i]; i--)
+		if (path_pattern_matches(pl->patterns[l->pos[i]],
+					 pathname, pathlen, basename,
+					 dtype, istate))
+			return l->pos[i];
+	return best;
+}
+
+static struct path_pattern *last_matching_pattern_from_matcher(const char *pathname,
+							       int pathlen,
+							       const char *basename,
+							       int *dtype,
+							       struct pattern_list *pl,
+							       struct index_state *istate)
+{
+	struct pattern_matcher *m = pl->matcher;
+	int basenamelen = pathlen - (basename - pathname);
+	int best = -1;
+	int i;
+
+	best = last_matching_literal(find_literal(&m->basenames, basename,
+						  basenamelen),
+				     best, pathname, pathlen, basename,
+				     dtype, pl, istate);
+	for (i = 0; i < m->suffix_lens_nr; i++) {
+		int len = m->suffix_lens[i];
+
+		if (basenamelen < len)
+			continue;
+		best = last_matching_literal(find_literal(&m->suffixes,
+							  basename + basenamelen - len,
+							  len),
+					     best, pathname, pathlen, basename,
+					     dtype, pl, istate);
+	}
+	best = last_matching_literal(find_literal(&m->pathnames, pathname,
+						  pathlen),
+				     best, pathname, pathlen, basename,
+				     dtype, pl, istate);
+
+	for (i = m->globs_nr - 1; 0 <= i && best < m->globs[i]; i--)
+		if (path_pattern_matches(pl->patterns[m->globs[i]],
+					 pathname, pathlen, basename,
+					 dtype, istate)) {
+			best = m->globs[i];
+			break;
+		}
+
+	return best < 0 ? NULL : pl->patterns[best];
+}
+
 /*
  * Scan the given exclude list in reverse to see whether pathname
  * should be ignored.  The first match (i.e. the last on the list), if
@@ -1344,46 +1611,26 @@ static struct path_pattern *last_matching_pattern_from_list(const char *pathname
 						       struct pattern_list *pl,
 						       struct index_state *istate)
 {
-	struct path_pattern *res = NULL; /* undecided */
 	int i;
 
 	if (!pl->nr)
 		return NULL;	/* undefined */
 
+	if (!pl->matcher && pl->nr >= PATTERN_MATCHER_MIN)
+		pl->matcher = build_pattern_matcher(pl);
+	if (pl->matcher)
+		return last_matching_pattern_from_matcher(pathname, pathlen,
+							  basename, dtype,
+							  pl, istate);
+
 	for (i = pl->nr - 1; 0 <= i; i--) {
 		struct path_pattern *pattern = pl->patterns[i];
-		const char *exclude = pattern->pattern;
-		int prefix = pattern->nowildcardlen;
-
-		if (pattern->flags & PATTERN_FLAG_MUSTBEDIR) {
-			*dtype = resolve_dtype(*dtype, istate, pathname, pathlen);
-			if (*dtype != DT_DIR)
-				continue;
-		}
-
-		if (pattern->flags & PATTERN_FLAG_NODIR) {
-			if (match_basename(basename,
-					   pathlen - (basename - pathname),
-					   exclude, prefix, pattern->patternlen,
-					   pattern->flags)) {
-				res = pattern;
-				break;
-			}
-			continue;
-		}
 
-		assert(pattern->baselen == 0 ||
-		       pattern->base[pattern->baselen - 1] == '/');
-		if (match_pathname(pathname, pathlen,
-				   pattern->base,
-				   pattern->baselen ? pattern->baselen - 1 : 0,
-				   exclude, prefix, pattern->patternlen,
-				   pattern->flags)) {
-			res = pattern;
-			break;
-		}
+		if (path_pattern_matches(pattern, pathname, pathlen,
+					 basename, dtype, istate))
+			return pattern;
 	}
-	return res;
+	return NULL;
 }
 
 /*
@@ -2355,6 +2602,302 @@ static int valid_cached_dir(struct dir_struct *dir,
 	return untracked->valid;
 }
 
+/*
+ * Directory listing prefetch.
+ *
+ * read_directory_recursive() descends into every directory that holds
+ * tracked files, so when core.readDirectoryThreads asks for it, worker
+ * threads read the listings of those directories ahead of the walk.
+ * The walk itself, and everything that depends on its order (the
+ * exclude stack, the untracked cache), stays on the main thread; it
+ * merely takes a listing from memory instead of calling opendir() and
+ * readdir() when one is ready.
+ */
+
+/*
+ * How far ahead of the walk, in index order, the workers may read.
+ * Listings the walk never asks for (e.g. because the untracked cache
+ * is still valid for them, or they are ignored) are left behind once
+ * the walk moves past them, and do not hold the workers back.
+ */
+#define PREFETCH_MAX_AHEAD 1024
+
+enum listing_state {
+	LISTING_PENDING = 0,
+	LISTING_READING,
+	LISTING_READY,
+	LISTING_TAKEN
+};
+
+struct dir_listing {
+	struct hashmap_entry ent;
+	enum listing_state state;
+	unsigned failed : 1;
+	size_t pos;		/* position in dir_prefetch.list */
+	size_t len;
+
+	/* NUL-separated entry names, and one d_type per entry */
+	struct strbuf names;
+	unsigned char *types;
+	size_t nr, alloc;
+
+	char path[FLEX_ARRAY];	/* no trailing slash */
+};
+
+struct dir_prefetch {
+	struct hashmap map;
+	struct dir_listing **list;
+	size_t nr, alloc;
+	size_t next;		/* first listing a worker may pick up */
+	size_t walk;		/* just after the listing last taken */
+
+	pthread_t *threads;
+	int nr_threads;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	int stop;
+};
+
+struct dir_listing_key {
+	const char *path;
+	size_t len;
+};
+
+static int dir_listing_cmp(const void *unused_cmp_data,
+			   const struct hashmap_entry *eptr,
+			   const struct hashmap_entry *unused_entry_or_key,
+			   const void *keydata)
+{
+	const struct dir_listing *a;
+	const struct dir_listing_key *key = keydata;
+
+	a = container_of(eptr, const struct dir_listing, ent);
+
+	return a->len != key->len || memcmp(a->path, key->path, key->len);
+}
+
+static struct dir_listing *find_listing(struct dir_prefetch *p,
+					const char *path, size_t len)
+{
+	struct dir_listing_key key = { path, len };
+
+	return hashmap_get_entry_from_hash(&p->map, memhash(path, len), &key,
+					   struct dir_listing, ent);
+}
+
+static void read_listing(struct dir_listing *l)
+{
+	DIR *fdir = opendir(l->path);
+	struct dirent *de;
+
+	if (!fdir) {
+		/* leave it to the walk to complain */
+		l->failed = 1;
+		return;
+	}
+	while ((de = readdir(fdir)) != NULL) {
+		ALLOC_GROW(l->types, l->nr + 1, l->alloc);
+		l->types[l->nr++] = DTYPE(de);
+		strbuf_add(&l->names, de->d_name, strlen(de->d_name) + 1);
+	}
+	closedir(fdir);
+}
+
+static void *prefetch_worker(void *data)
+{
+	struct dir_prefetch *p = data;
+
+	pthread_mutex_lock(&p->mutex);
+	for (;;) {
+		struct dir_listing *l;
+
+		while (!p->stop && p->next < p->nr &&
+		       p->next >= p->walk + PREFETCH_MAX_AHEAD)
+			pthread_cond_wait(&p->cond, &p->mutex);
+		if (p->stop || p->next >= p->nr)
+			break;
+		l = p->list[p->next++];
+		if (l->state != LISTING_PENDING)
+			continue;
+		l->state = LISTING_READING;
+		pthread_mutex_unlock(&p->mutex);
+
+		read_listing(l);
+
+		pthread_mutex_lock(&p->mutex);
+		l->state = LISTING_READY;
+		pthread_cond_broadcast(&p->cond);
+	}
+	pthread_mutex_unlock(&p->mutex);
+	return NULL;
+}
+
+static void add_prefetch_dir(struct dir_prefetch *p, const char *path, size_t len)
+{
+	struct dir_listing *l;
+
+	if (find_listing(p, path, len))
+		return;
+	FLEX_ALLOC_MEM(l, path, path, len);
+	hashmap_entry_init(&l->ent, memhash(path, len));
+	l->len = len;
+	strbuf_init(&l->names, 0);
+	hashmap_add(&p->map, &l->ent);
+	l->pos = p->nr;
+	ALLOC_GROW(p->list, p->nr + 1, p->alloc);
+	p->list[p->nr++] = l;
+}
+
+static int get_read_directory_threads(void)
+{
+	int nr = 1;
+
+	if (!HAVE_THREADS)
+		return 1;
+	git_config_get_int("core.readdirectorythreads", &nr);
+	if (nr < 0)
+		nr = 1;
+	else if (!nr)
+		nr = online_cpus();
+	return nr;
+}
+
+/*
+ * Start reading, in index order, the directories below "base" that
+ * contain tracked files.  Returns NULL when prefetching is disabled or
+ * there is nothing worth reading ahead.
+ */
+static struct dir_prefetch *start_dir_prefetch(struct index_state *istate,
+					       const char *base, int baselen)
+{
+	struct dir_prefetch *p;
+	struct strbuf last = STRBUF_INIT;
+	int nr_threads = get_read_directory_threads();
+	int i;
+
+	if (nr_threads <= 1)
+		return NULL;
+
+	CALLOC_ARRAY(p, 1);
+	hashmap_init(&p->map, dir_listing_cmp, NULL, 0);
+	for (i = 0; i < istate->cache_nr; i++) {
+		const struct cache_entry *ce = istate->cache[i];
+		const char *name = ce->name, *slash;
+
+		if (ce_skip_worktree(ce) || strncmp(name, base, baselen))
+			continue;
+		/*
+		 * The index is sorted, so all entries below a directory
+		 * are adjacent; only add the leading directories that
+		 * differ from the previous entry's.
+		 */
+		for (slash = strchr(name + baselen, '/'); slash;
+		     slash = strchr(slash + 1, '/')) {
+			size_t len = slash - name;
+
+			if (len <= last.len && !strncmp(last.buf, name, len) &&
+			    (len == last.len || last.buf[len] == '/'))
+				continue;
+			add_prefetch_dir(p, name, len);
+		}
+		slash = strrchr(name, '/');
+		strbuf_reset(&last);
+		if (slash)
+			strbuf_add(&last, name, slash - name);
+	}
+	strbuf_release(&last);
+
+	if (p->nr < 2) {
+		hashmap_free_entries(&p->map, struct dir_listing, ent);
+		free(p->list);
+		free(p);
+		return NULL;
+	}
+
+	trace2_data_intmax("dir", the_repository, "prefetch/dirs", p->nr);
+	pthread_mutex_init(&p->mutex, NULL);
+	pthread_cond_init(&p->cond, NULL);
+	p->nr_threads = nr_threads;
+	CALLOC_ARRAY(p->threads, nr_threads);
+	for (i = 0; i < nr_threads; i++) {
+		int err = pthread_create(&p->threads[i], NULL,
+					 prefetch_worker, p);
+		if (err)
+			die(_("unable to create threaded readdir (%s)"),
+			    strerror(err));
+	}
+	return p;
+}
+
+static void stop_dir_prefetch(struct dir_prefetch *p)
+{
+	struct hashmap_iter iter;
+	struct dir_listing *l;
+	int i;
+
+	if (!p)
+		return;
+
+	pthread_mutex_lock(&p->mutex);
+	p->stop = 1;
+	pthread_cond_broadcast(&p->cond);
+	pthread_mutex_unlock(&p->mutex);
+	for (i = 0; i < p->nr_threads; i++)
+		pthread_join(p->threads[i], NULL);
+
+	hashmap_for_each_entry(&p->map, &iter, l, ent) {
+		strbuf_release(&l->names);
+		free(l->types);
+	}
+	hashmap_free_entries(&p->map, struct dir_listing, ent);
+	pthread_cond_destroy(&p->cond);
+	pthread_mutex_destroy(&p->mutex);
+	free(p->threads);
+	free(p->list);
+	free(p);
+}
+
+/*
+ * Hand the walk the prefetched listing of "path", waiting for it if a
+ * worker is reading it right now.  Returns NULL if the caller should
+ * read the directory itself.
+ */
+static struct dir_listing *take_prefetched_dir(struct dir_prefetch *p,
+					       const struct strbuf *path)
+{
+	struct dir_listing *l;
+	enum listing_state state;
+	size_t len = path->len;
+
+	if (!p)
+		return NULL;
+	while (len && path->buf[len - 1] == '/')
+		len--;
+	/* the map is not modified once the workers run */
+	l = len ? find_listing(p, path->buf, len) : NULL;
+	if (!l)
+		return NULL;
+
+	pthread_mutex_lock(&p->mutex);
+	/*
+	 * The walk is depth-first, and so is the index order, so the
+	 * directories it will want next follow this one in the list.
+	 */
+	p->walk = p->next = l->pos + 1;
+	pthread_cond_broadcast(&p->cond);
+	while (l->state == LISTING_READING)
+		pthread_cond_wait(&p->cond, &p->mutex);
+	state = l->state;
+	if (state == LISTING_TAKEN)
+		BUG("directory '%s' listed twice", l->path);
+	l->state = LISTING_TAKEN;
+	pthread_mutex_unlock(&p->mutex);
+
+	if (state == LISTING_PENDING || l->failed)
+		return NULL;
+	return l;
+}
+
 static int open_cached_dir(struct cached_dir *cdir,
 			   struct dir_struct *dir,
 			   struct untracked_cache_dir *untracked,
@@ -2369,14 +2912,17 @@ static int open_cached_dir(struct cached_dir *cdir,
 	if (valid_cached_dir(dir, untracked, istate, path, check_only))
 		return 0;
 	c_path = path->len ? path->buf : ".";
-	cdir->fdir = opendir(c_path);
-	if (!cdir->fdir)
-		warning_errno(_("could not open directory '%s'"), c_path);
+	cdir->listing = take_prefetched_dir(dir->prefetch, path);
+	if (!cdir->listing) {
+		cdir->fdir = opendir(c_path);
+		if (!cdir->fdir)
+			warning_errno(_("could not open directory '%s'"), c_path);
+	}
 	if (dir->untracked) {
 		invalidate_directory(dir->untracked, untracked);
 		dir->untracked->dir_opened++;
 	}
-	if (!cdir->fdir)
+	if (!cdir->fdir && !cdir->listing)
 		return -1;
 	return 0;
 }
@@ -2385,6 +2931,19 @@ static int read_cached_dir(struct cached_dir *cdir)
 {
 	struct dirent *de;
 
+	if (cdir->listing) {
+		struct dir_listing *l = cdir->listing;
+
+		if (cdir->listing_nr >= l->nr) {
+			cdir->d_name = NULL;
+			cdir->d_type = DT_UNKNOWN;
+			return -1;
+		}
+		cdir->d_name = l->names.buf + cdir->listing_off;
+		cdir->d_type = l->types[cdir->listing_nr++];
+		cdir->listing_off += strlen(cdir->d_name) + 1;
+		return 0;
+	}
 	if (cdir->fdir) {
 		de = readdir(cdir->fdir);
 		if (!de) {
@@ -2419,6 +2978,10 @@ static void close_cached_dir(struct cached_dir *cdir)
 {
 	if (cdir->fdir)
 		closedir(cdir->fdir);
+	if (cdir->listing) {
+		strbuf_release(&cdir->listing->names);
+		FREE_AND_NULL(cdir->listing->types);
+	}
 	/*
 	 * We have gone through this directory and found no untracked
 	 * entries. Mark it valid.
@@ -2456,7 +3019,7 @@ static void add_path_to_appropriate_result_list(struct dir_struct *dir,
 		if (dir->flags & DIR_SHOW_IGNORED)
 			break;
 		dir_add_name(dir, istate, path->buf, path->len);
-		if (cdir->fdir)
+		if (cdir->fdir || cdir->listing)
 			add_untracked(untracked, path->buf + baselen);
 		break;
 
@@ -2559,7 +3122,7 @@ static enum path_treatment read_directory_recursive(struct dir_struct *dir,
 
 			/* abort early if maximum state has been reached */
 			if (dir_state == path_untracked) {
-				if (cdir.fdir)
+				if (cdir.fdir || cdir.listing)
 					add_untracked(untracked, path.buf + baselen);
 				break;
 			}
@@ -2844,8 +3407,18 @@ int read_directory(struct dir_struct *dir, struct index_state *istate,
 		 * e.g. prep_exclude()
 		 */
 		dir->untracked = NULL;
-	if (!len || treat_leading_path(dir, istate, path, len, pathspec))
+	if (!len || treat_leading_path(dir, istate, path, len, pathspec)) {
+		/*
+		 * With a valid untracked cache most directories are
+		 * never opened, so only read ahead when it is missing
+		 * or has been invalidated at the top.
+		 */
+		if (!untracked || !untracked->valid)
+			dir->prefetch = start_dir_prefetch(istate, path, len);
 		read_directory_recursive(dir, istate, path, len, untracked, 0, 0, pathspec);
+		stop_dir_prefetch(dir->prefetch);
+		dir->prefetch = NULL;
+	}
 	QSORT(dir->entries, dir->nr, cmp_dir_entry);
 	QSORT(dir->ignored, dir->ignored_nr, cmp_dir_entry);
 
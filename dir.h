@@ -115,6 +115,12 @@ struct pattern_list {
 	 * Used to check single-level parents of blobs.
 	 */
 	struct hashmap parent_hashmap;
+
+	/*
+	 * Hashes of the literal patterns of a long list, built on first
+	 * use; see last_matching_pattern_from_list().
+	 */
+	struct pattern_matcher *matcher;
 };
 
 /*
@@ -333,6 +339,9 @@ struct dir_struct {
 
 	/* Enable untracked file cache if set */
 	struct untracked_cache *untracked;
+
+	/* Directory listings read ahead by worker threads, if any */
+	struct dir_prefetch *prefetch;
 	struct oid_stat ss_info_exclude;
 	struct oid_stat ss_excludes_file;
 	unsigned unmanaged_exclude_files;
@@ -142,6 +142,22 @@ void bitmap_or_ewah(struct bitmap *self, struct ewah_bitmap *other)
 		self->words[i++] |= word;
 }
 
+void bitmap_or(struct bitmap *self, const struct bitmap *other)
+{
+	size_t original_size = self->word_alloc;
+	size_t i;
+
+	if (self->word_alloc < other->word_alloc) {
+		self->word_alloc = other->word_alloc;
+		REALLOC_ARRAY(self->words, self->word_alloc);
+		memset(self->words + original_size, 0x0,
+			(self->word_alloc - original_size) * sizeof(eword_t));
+	}
+
+	for (i = 0; i < other->word_alloc; i++)
+		self->words[i] |= other->words[i];
+}
+
 size_t bitmap_popcount(struct bitmap *self)
 {
 	size_t i, count = 0;
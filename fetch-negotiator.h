@@ -9,7 +9,7 @@ struct repository;
  * the to-be-sent packfile during a fetch.
  *
  * To set up the negotiator, call fetch_negotiator_init(), then known_common()
- * (0 or more times), then add_tip() (0 or more times).
+ * and likely_common() (0 or more times), then add_tip() (0 or more times).
  *
  * Then, when "have" lines are required, call next(). Call ack() to report what
  * the server tells us.
@@ -25,8 +25,17 @@ struct fetch_negotiator {
 	void (*known_common)(struct fetch_negotiator *, struct commit *);
 
 	/*
-	 * Once this function is invoked, known_common() cannot be invoked any
-	 * more.
+	 * Before negotiation starts, indicate that the server probably has
+	 * this commit, although it did not advertise it (e.g., because it
+	 * was fetched from the server earlier). The commit is sent as a
+	 * "have" line before the others, but neither it nor its ancestors
+	 * are treated as common until the server acknowledges it.
+	 */
+	void (*likely_common)(struct fetch_negotiator *, struct commit *);
+
+	/*
+	 * Once this function is invoked, known_common() and likely_common()
+	 * cannot be invoked any more.
 	 *
 	 * Indicate that this commit and all its ancestors are to be checked
 	 * for commonality with the server.
@@ -34,8 +43,8 @@ struct fetch_negotiator {
 	void (*add_tip)(struct fetch_negotiator *, struct commit *);
 
 	/*
-	 * Once this function is invoked, known_common() and add_tip() cannot
-	 * be invoked any more.
+	 * Once this function is invoked, known_common(), likely_common() and
+	 * add_tip() cannot be invoked any more.
 	 *
 	 * Return the next commit that the client should send as a "have" line.
 	 */
@@ -669,6 +669,7 @@ static void mark_complete_and_common_ref(struct fetch_negotiator *negotiator,
 					 struct ref **refs)
 {
 	struct ref *ref;
+	const struct ref *tip;
 	int old_save_commit_buffer = save_commit_buffer;
 	timestamp_t cutoff = 0;
 
@@ -728,6 +729,26 @@ static void mark_complete_and_common_ref(struct fetch_negotiator *negotiator,
 
 		negotiator->known_common(negotiator, c);
 	}
+
+	/*
+	 * A prefetched commit is only worth sending first if its ref is
+	 * still advertised. It may have been rewound since, so it is not
+	 * taken as common until the server acknowledges it.
+	 */
+	for (tip = args->prefetched_refs; tip; tip = tip->next) {
+		const struct ref *advertised = find_ref_by_name(*refs, tip->name);
+		struct commit *c;
+
+		/* an unchanged ref was passed to known_common() above */
+		if (!advertised || oideq(&advertised->old_oid, &tip->old_oid))
+			continue;
+
+		c = deref_without_lazy_fetch(&tip->old_oid, 0);
+		if (!c || !(c->object.flags & COMPLETE))
+			continue;
+
+		negotiator->likely_common(negotiator, c);
+	}
 	trace2_region_leave("fetch-pack", "mark_common_remote_refs", NULL);
 
 	save_commit_buffer = old_save_commit_buffer;
@@ -23,6 +23,13 @@ struct fetch_pack_args {
 	 */
 	const struct oid_array *negotiation_tips;
 
+	/*
+	 * If not NULL, refs of the server as they were when they were
+	 * prefetched from it earlier. Those whose ref is still advertised
+	 * are sent as "have" lines before anything else.
+	 */
+	const struct ref *prefetched_refs;
+
 	unsigned deepen_relative:1;
 	unsigned quiet:1;
 	unsigned keep_pack:1;
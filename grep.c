@@ -1100,13 +1100,23 @@ void free_grep_patterns(struct grep_opt *opt)
 
 static char *end_of_line(char *cp, unsigned long *left)
 {
-	unsigned long l = *left;
-	while (l && *cp != '\n') {
-		l--;
+	char *eol = memchr(cp, '\n', *left);
+
+	if (!eol)
+		eol = cp + *left;
+	*left -= eol - cp;
+	return eol;
+}
+
+static unsigned count_newlines(const char *cp, const char *end)
+{
+	unsigned nr = 0;
+
+	while ((cp = memchr(cp, '\n', end - cp))) {
+		nr++;
 		cp++;
 	}
-	*left = l;
-	return cp;
+	return nr;
 }
 
 static int word_char(char ch)
@@ -1697,10 +1707,7 @@ static int look_ahead(struct grep_opt *opt,
 		; /* find the beginning of the line */
 	last_bol = sp;
 
-	for (sp = bol; sp < last_bol; sp++) {
-		if (*sp == '\n')
-			lno++;
-	}
+	lno += count_newlines(bol, last_bol);
 	*left_p -= last_bol - bol;
 	*bol_p = last_bol;
 	*lno_p = lno;
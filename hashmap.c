@@ -73,13 +73,119 @@ unsigned int memihash_cont(unsigned int hash_seed, const void *buf, size_t len)
 /* load factor in percent */
 #define HASHMAP_LOAD_FACTOR 80
 
+/*
+ * Open-addressing maps are split into groups of HASHMAP_GROUP_SLOTS
+ * slots (see struct hashmap_group). The control byte of a slot is
+ * CTRL_EMPTY, CTRL_DELETED or, if it holds an entry, the 7 bits of its
+ * hash code computed by ctrl_hash(). A lookup loads the control bytes
+ * of a whole group into one word and compares them all at once, and
+ * stops at the first group with an empty slot.
+ *
+ * Slots are numbered `group * 8 + position`, so that `tablesize` is a
+ * power of 2 like for chained maps, but the last of every 8 numbers is
+ * not used.
+ */
+#define GROUP_WIDTH 8
+#define CTRL_EMPTY 0x80
+#define CTRL_DELETED 0xfe
+#define GROUP_LSBS 0x0101010101010101ULL
+/* the high bit of the control bytes of the HASHMAP_GROUP_SLOTS slots */
+#define GROUP_MSBS 0x0080808080808080ULL
+
+/*
+ * Hash codes like those of strhash() differ mostly in their low bits
+ * for similar keys. Mix the bits before choosing a group, so that
+ * similar keys do not fill neighbouring groups.
+ */
+static inline unsigned int mix_hash(unsigned int hash)
+{
+	return hash * 0x9e3779b1U;
+}
+
+static inline unsigned char ctrl_hash(unsigned int hash)
+{
+	return mix_hash(hash) & 0x7f;
+}
+
+static inline unsigned int home_group(const struct hashmap *map,
+				      unsigned int hash)
+{
+	return (mix_hash(hash) >> 7) & (map->tablesize / GROUP_WIDTH - 1);
+}
+
+static inline uint64_t load_group(const struct hashmap_group *g)
+{
+	uint64_t group;
+
+	memcpy(&group, g->ctrl, sizeof(group));
+	/* the first control byte goes into the lowest bits */
+	if (htonl(1) == 1)
+		group = default_bswap64(group);
+	return group;
+}
+
+/*
+ * The following return a mask with the high bit set in the bytes of
+ * `group` that match. group_match() may have false positives, which is
+ * fine as the caller compares the entries anyway.
+ */
+static inline uint64_t group_match(uint64_t group, unsigned char h)
+{
+	uint64_t x = group ^ (GROUP_LSBS * h);
+	return (x - GROUP_LSBS) & ~x & GROUP_MSBS;
+}
+
+static inline uint64_t group_match_empty(uint64_t group)
+{
+	return group & (~group << 6) & GROUP_MSBS;
+}
+
+static inline uint64_t group_match_free(uint64_t group)
+{
+	return group & GROUP_MSBS;
+}
+
+/* Returns the position in its group of the first byte set in `mask`. */
+static inline unsigned int group_first(uint64_t mask)
+{
+#if defined(__GNUC__)
+	return __builtin_ctzll(mask) / 8;
+#else
+	unsigned int i = 0;
+	while (!(mask & 0x80)) {
+		mask >>= 8;
+		i++;
+	}
+	return i;
+#endif
+}
+
+#define open_slot(map, i) \
+	((map)->groups[(i) / GROUP_WIDTH].slot[(i) % GROUP_WIDTH])
+#define open_ctrl(map, i) \
+	((map)->groups[(i) / GROUP_WIDTH].ctrl[(i) % GROUP_WIDTH])
+
 static void alloc_table(struct hashmap *map, unsigned int size)
 {
+	unsigned int slots = size;
+
 	map->tablesize = size;
-	map->table = xcalloc(size, sizeof(struct hashmap_entry *));
+	if (map->open_addressing) {
+		unsigned int i, nr = size / GROUP_WIDTH;
+
+		ALLOC_ARRAY(map->groups, nr);
+		for (i = 0; i < nr; i++) {
+			memset(map->groups[i].ctrl, CTRL_EMPTY, GROUP_WIDTH);
+			memset(map->groups[i].slot, 0, sizeof(map->groups[i].slot));
+		}
+		map->deleted = 0;
+		slots = nr * HASHMAP_GROUP_SLOTS;
+	} else {
+		map->table = xcalloc(size, sizeof(struct hashmap_entry *));
+	}
 
 	/* calculate resize thresholds for new size */
-	map->grow_at = (unsigned int) ((uint64_t) size * HASHMAP_LOAD_FACTOR / 100);
+	map->grow_at = (unsigned int) ((uint64_t) slots * HASHMAP_LOAD_FACTOR / 100);
 	if (size <= HASHMAP_INITIAL_SIZE)
 		map->shrink_at = 0;
 	else
@@ -111,11 +217,28 @@ int hashmap_bucket(const struct hashmap *map, unsigned int hash)
 	return hash & (map->tablesize - 1);
 }
 
+static void open_insert(struct hashmap *map, struct hashmap_entry *entry);
+
 static void rehash(struct hashmap *map, unsigned int newsize)
 {
 	unsigned int i, oldsize = map->tablesize;
 	struct hashmap_entry **oldtable = map->table;
 
+	if (map->open_addressing) {
+		struct hashmap_group *oldgroups = map->groups;
+
+		alloc_table(map, newsize);
+		for (i = 0; i < oldsize / GROUP_WIDTH; i++) {
+			int j;
+
+			for (j = 0; j < HASHMAP_GROUP_SLOTS; j++)
+				if (oldgroups[i].slot[j])
+					open_insert(map, oldgroups[i].slot[j]);
+		}
+		free(oldgroups);
+		return;
+	}
+
 	alloc_table(map, newsize);
 	for (i = 0; i < oldsize; i++) {
 		struct hashmap_entry *e = oldtable[i];
@@ -139,6 +262,104 @@ static inline struct hashmap_entry **find_entry_ptr(const struct hashmap *map,
 	return e;
 }
 
+/*
+ * Returns the slot of the first entry equal to `key` in the probe
+ * sequence of its hash code, or -1. If `after` is given, only entries
+ * that come after it are considered.
+ */
+static inline int open_find_slot(const struct hashmap *map,
+				 const struct hashmap_entry *key,
+				 const void *keydata,
+				 const struct hashmap_entry *after)
+{
+	unsigned int mask = map->tablesize / GROUP_WIDTH - 1;
+	unsigned int g = home_group(map, key->hash), step = 0;
+	unsigned char h = ctrl_hash(key->hash);
+
+	for (;;) {
+		uint64_t group = load_group(&map->groups[g]);
+		uint64_t match = group_match(group, h);
+
+		for (; match; match &= match - 1) {
+			unsigned int pos = group_first(match);
+			struct hashmap_entry *e = map->groups[g].slot[pos];
+
+			if (after) {
+				if (e == after)
+					after = NULL;
+				continue;
+			}
+			if (entry_equals(map, e, key, keydata))
+				return g * GROUP_WIDTH + pos;
+		}
+		if (group_match_empty(group))
+			return -1;
+		/* triangular probing visits every group of a 2^n table */
+		g = (g + ++step) & mask;
+	}
+}
+
+/* Stores `entry` in the first free slot of its probe sequence. */
+static void open_insert(struct hashmap *map, struct hashmap_entry *entry)
+{
+	unsigned int mask = map->tablesize / GROUP_WIDTH - 1;
+	unsigned int g = home_group(map, entry->hash), step = 0, slot;
+	uint64_t free_slots;
+
+	while (!(free_slots = group_match_free(load_group(&map->groups[g]))))
+		g = (g + ++step) & mask;
+
+	slot = g * GROUP_WIDTH + group_first(free_slots);
+	if (open_ctrl(map, slot) == CTRL_DELETED)
+		map->deleted--;
+	open_ctrl(map, slot) = ctrl_hash(entry->hash);
+	open_slot(map, slot) = entry;
+	entry->next = NULL;
+}
+
+static void open_add(struct hashmap *map, struct hashmap_entry *entry)
+{
+	if (map->private_size + map->deleted >= map->grow_at) {
+		if (map->private_size >= map->grow_at)
+			rehash(map, map->tablesize << HASHMAP_RESIZE_BITS);
+		else
+			/* only get rid of the deleted slots */
+			rehash(map, map->tablesize);
+	}
+	open_insert(map, entry);
+	map->private_size++;
+}
+
+static struct hashmap_entry *open_remove(struct hashmap *map,
+					 const struct hashmap_entry *key,
+					 const void *keydata)
+{
+	struct hashmap_entry *old;
+	int slot = open_find_slot(map, key, keydata, NULL);
+
+	if (slot < 0)
+		return NULL;
+	old = open_slot(map, slot);
+	open_slot(map, slot) = NULL;
+
+	/*
+	 * A lookup stops at a group with an empty slot, so if this group
+	 * has one, no probe sequence continues past it and the slot can
+	 * become empty again.
+	 */
+	if (group_match_empty(load_group(&map->groups[slot / GROUP_WIDTH]))) {
+		open_ctrl(map, slot) = CTRL_EMPTY;
+	} else {
+		open_ctrl(map, slot) = CTRL_DELETED;
+		map->deleted++;
+	}
+
+	map->private_size--;
+	if (map->private_size < map->shrink_at)
+		rehash(map, map->tablesize >> HASHMAP_RESIZE_BITS);
+	return old;
+}
+
 static int always_equal(const void *unused_cmp_data,
 			const struct hashmap_entry *unused1,
 			const struct hashmap_entry *unused2,
@@ -147,12 +368,14 @@ static int always_equal(const void *unused_cmp_data,
 	return 0;
 }
 
-void hashmap_init(struct hashmap *map, hashmap_cmp_fn equals_function,
-		const void *cmpfn_data, size_t initial_size)
+static void init_map(struct hashmap *map, hashmap_cmp_fn equals_function,
+		     const void *cmpfn_data, size_t initial_size,
+		     int open_addressing)
 {
 	unsigned int size = HASHMAP_INITIAL_SIZE;
 
 	memset(map, 0, sizeof(*map));
+	map->open_addressing = open_addressing;
 
 	map->cmpfn = equals_function ? equals_function : always_equal;
 	map->cmpfn_data = cmpfn_data;
@@ -171,9 +394,21 @@ void hashmap_init(struct hashmap *map, hashmap_cmp_fn equals_function,
 	map->do_count_items = 1;
 }
 
+void hashmap_init(struct hashmap *map, hashmap_cmp_fn equals_function,
+		const void *cmpfn_data, size_t initial_size)
+{
+	init_map(map, equals_function, cmpfn_data, initial_size, 0);
+}
+
+void hashmap_init_open(struct hashmap *map, hashmap_cmp_fn equals_function,
+		       const void *cmpfn_data, size_t initial_size)
+{
+	init_map(map, equals_function, cmpfn_data, initial_size, 1);
+}
+
 void hashmap_free_(struct hashmap *map, ssize_t entry_offset)
 {
-	if (!map || !map->table)
+	if (!map || (!map->table && !map->groups))
 		return;
 	if (entry_offset >= 0) { /* called by hashmap_free_entries */
 		struct hashmap_iter iter;
@@ -188,6 +423,7 @@ void hashmap_free_(struct hashmap *map, ssize_t entry_offset)
 			free((char *)e - entry_offset);
 	}
 	free(map->table);
+	free(map->groups);
 	memset(map, 0, sizeof(*map));
 }
 
@@ -195,6 +431,10 @@ struct hashmap_entry *hashmap_get(const struct hashmap *map,
 				const struct hashmap_entry *key,
 				const void *keydata)
 {
+	if (map->open_addressing) {
+		int slot = open_find_slot(map, key, keydata, NULL);
+		return slot < 0 ? NULL : open_slot(map, slot);
+	}
 	return *find_entry_ptr(map, key, keydata);
 }
 
@@ -202,6 +442,11 @@ struct hashmap_entry *hashmap_get_next(const struct hashmap *map,
 			const struct hashmap_entry *entry)
 {
 	struct hashmap_entry *e = entry->next;
+
+	if (map->open_addressing) {
+		int slot = open_find_slot(map, entry, NULL, entry);
+		return slot < 0 ? NULL : open_slot(map, slot);
+	}
 	for (; e; e = e->next)
 		if (entry_equals(map, entry, e, NULL))
 			return e;
@@ -210,8 +455,14 @@ struct hashmap_entry *hashmap_get_next(const struct hashmap *map,
 
 void hashmap_add(struct hashmap *map, struct hashmap_entry *entry)
 {
-	unsigned int b = bucket(map, entry);
+	unsigned int b;
 
+	if (map->open_addressing) {
+		open_add(map, entry);
+		return;
+	}
+
+	b = bucket(map, entry);
 	/* add entry */
 	entry->next = map->table[b];
 	map->table[b] = entry;
@@ -229,7 +480,12 @@ struct hashmap_entry *hashmap_remove(struct hashmap *map,
 					const void *keydata)
 {
 	struct hashmap_entry *old;
-	struct hashmap_entry **e = find_entry_ptr(map, key, keydata);
+	struct hashmap_entry **e;
+
+	if (map->open_addressing)
+		return open_remove(map, key, keydata);
+
+	e = find_entry_ptr(map, key, keydata);
 	if (!*e)
 		return NULL;
 
@@ -275,6 +531,13 @@ struct hashmap_entry *hashmap_iter_next(struct hashmap_iter *iter)
 		if (iter->tablepos >= iter->map->tablesize)
 			return NULL;
 
+		if (iter->map->open_addressing) {
+			unsigned int i = iter->tablepos++;
+
+			if (i % GROUP_WIDTH < HASHMAP_GROUP_SLOTS)
+				current = open_slot(iter->map, i);
+			continue;
+		}
 		current = iter->map->table[iter->tablepos++];
 	}
 }
@@ -180,6 +180,17 @@ typedef int (*hashmap_cmp_fn)(const void *hashmap_cmp_fn_data,
 			      const struct hashmap_entry *entry_or_key,
 			      const void *keydata);
 
+/*
+ * A group of slots of a map initialized with `hashmap_init_open()`. The
+ * control bytes of all slots of a group share a single cache line with
+ * the slots themselves on 64-bit platforms.
+ */
+#define HASHMAP_GROUP_SLOTS 7
+struct hashmap_group {
+	unsigned char ctrl[8];
+	struct hashmap_entry *slot[HASHMAP_GROUP_SLOTS];
+};
+
 /*
  * struct hashmap is the hash table structure. Members can be used as follows,
  * but should not be modified directly.
@@ -205,7 +216,16 @@ struct hashmap {
 	unsigned int grow_at;
 	unsigned int shrink_at;
 
+	/*
+	 * Maps initialized with `hashmap_init_open()` keep their entries in
+	 * `groups` instead of `table`, and count the slots of removed
+	 * entries in `deleted`.
+	 */
+	struct hashmap_group *groups;
+	unsigned int deleted;
+
 	unsigned int do_count_items : 1;
+	unsigned int open_addressing : 1;
 };
 
 /* hashmap functions */
@@ -232,6 +252,29 @@ void hashmap_init(struct hashmap *map,
 			 const void *equals_function_data,
 			 size_t initial_size);
 
+/*
+ * Initializes a hashmap structure that uses open addressing instead of
+ * chaining. Arguments are the same as for `hashmap_init()`.
+ *
+ * Entries are stored directly in the table, next to a control byte that
+ * holds 7 bits of their hash code. Lookups compare the control bytes of
+ * a group of `HASHMAP_GROUP_SLOTS` (7) slots at once, and only call
+ * `equals_function` on the entries whose control byte matches, which
+ * avoids following a chain of pointers for every lookup.
+ *
+ * The API is the same for both kinds of maps, with these exceptions:
+ *
+ * - duplicate entries (see `hashmap_add`) are returned by `hashmap_get`
+ *   and `hashmap_get_next` in no particular order;
+ *
+ * - item counting cannot be disabled, so the map cannot be modified by
+ *   several threads at once even with one lock per `hashmap_bucket`.
+ */
+void hashmap_init_open(struct hashmap *map,
+		       hashmap_cmp_fn equals_function,
+		       const void *equals_function_data,
+		       size_t initial_size);
+
 /* internal function for freeing hashmap */
 void hashmap_free_(struct hashmap *map, ssize_t offset);
 
@@ -499,6 +542,8 @@ static inline struct hashmap_entry *hashmap_iter_first(struct hashmap *map,
  */
 static inline void hashmap_disable_item_counting(struct hashmap *map)
 {
+	if (map->open_addressing)
+		BUG("cannot disable item counting of an open-addressing hashmap");
 	map->do_count_items = 0;
 }
 
@@ -326,7 +326,29 @@ static int collect_diff_cb(long start_a, long count_a,
 	return 0;
 }
 
-static int collect_diff(mmfile_t *parent, mmfile_t *target, struct diff_ranges *out)
+/*
+ * Most blobs are diffed twice while following a range through history,
+ * once against the previous version and once against the next one.
+ */
+#define LINE_LOG_CACHE_BUDGET (16 * 1024 * 1024)
+
+static xdlinehash_t *blob_line_hash(struct diff_filespec *spec)
+{
+	static struct xdiff_line_cache cache;
+	static int initialized;
+
+	if (!spec->oid_valid)
+		return NULL;
+	if (!initialized) {
+		xdiff_line_cache_init(&cache, LINE_LOG_CACHE_BUDGET);
+		initialized = 1;
+	}
+	return xdiff_line_cache_get(&cache, &spec->oid);
+}
+
+static int collect_diff(mmfile_t *parent, mmfile_t *target,
+			xdlinehash_t *parent_hash, xdlinehash_t *target_hash,
+			struct diff_ranges *out)
 {
 	struct collect_diff_cbdata cbdata = {NULL};
 	xpparam_t xpp;
@@ -334,6 +356,8 @@ static int collect_diff(mmfile_t *parent, mmfile_t *target, struct diff_ranges *
 	xdemitcb_t ecb;
 
 	memset(&xpp, 0, sizeof(xpp));
+	xpp.line_hash1 = parent_hash;
+	xpp.line_hash2 = target_hash;
 	memset(&xecfg, 0, sizeof(xecfg));
 	xecfg.ctxlen = xecfg.interhunkctxlen = 0;
 
@@ -1060,7 +1084,9 @@ static int process_diff_filepair(struct rev_info *rev,
 	}
 
 	diff_ranges_init(&diff);
-	if (collect_diff(&file_parent, &file_target, &diff))
+	if (collect_diff(&file_parent, &file_target,
+			 blob_line_hash(pair->one), blob_line_hash(pair->two),
+			 &diff))
 		die("unable to generate diff for %s", pair->one->path);
 
 	/* NEEDSWORK should apply some heuristics to prevent mismatches */
@@ -11,6 +11,7 @@
 #define COMMON_REF	(1U << 3)
 #define SEEN		(1U << 4)
 #define POPPED		(1U << 5)
+#define PREFETCHED	(1U << 6)
 
 static int marked;
 
@@ -19,6 +20,23 @@ struct negotiation_state {
 	int non_common_revs;
 };
 
+/*
+ * Commits passed to likely_common() are sent first, so that the server
+ * can find a common base (and be "ready") in the very first round.
+ * Otherwise, newer commits come before older ones.
+ */
+static int compare(const void *a_, const void *b_, void *unused)
+{
+	const struct commit *a = a_;
+	const struct commit *b = b_;
+	int a_prefetched = !!(a->object.flags & PREFETCHED);
+	int b_prefetched = !!(b->object.flags & PREFETCHED);
+
+	if (a_prefetched != b_prefetched)
+		return b_prefetched - a_prefetched;
+	return compare_commits_by_commit_date(a_, b_, unused);
+}
+
 static void rev_list_push(struct negotiation_state *ns,
 			  struct commit *commit, int mark)
 {
@@ -42,7 +60,7 @@ static int clear_marks(const char *refname, const struct object_id *oid,
 
 	if (o && o->type == OBJ_COMMIT)
 		clear_commit_marks((struct commit *)o,
-				   COMMON | COMMON_REF | SEEN | POPPED);
+				   COMMON | COMMON_REF | SEEN | POPPED | PREFETCHED);
 	return 0;
 }
 
@@ -133,15 +151,22 @@ static void known_common(struct fetch_negotiator *n, struct commit *c)
 	}
 }
 
+static void likely_common(struct fetch_negotiator *n, struct commit *c)
+{
+	rev_list_push(n->data, c, PREFETCHED | SEEN);
+}
+
 static void add_tip(struct fetch_negotiator *n, struct commit *c)
 {
 	n->known_common = NULL;
+	n->likely_common = NULL;
 	rev_list_push(n->data, c, SEEN);
 }
 
 static const struct object_id *next(struct fetch_negotiator *n)
 {
 	n->known_common = NULL;
+	n->likely_common = NULL;
 	n->add_tip = NULL;
 	return get_rev(n->data);
 }
@@ -163,12 +188,13 @@ void default_negotiator_init(struct fetch_negotiator *negotiator)
 {
 	struct negotiation_state *ns;
 	negotiator->known_common = known_common;
+	negotiator->likely_common = likely_common;
 	negotiator->add_tip = add_tip;
 	negotiator->next = next;
 	negotiator->ack = ack;
 	negotiator->release = release;
 	negotiator->data = ns = xcalloc(1, sizeof(*ns));
-	ns->rev_list.compare = compare_commits_by_commit_date;
+	ns->rev_list.compare = compare;
 
 	if (marked)
 		for_each_ref(clear_marks, NULL);
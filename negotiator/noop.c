@@ -8,6 +8,11 @@ static void known_common(struct fetch_negotiator *n, struct commit *c)
 	/* do nothing */
 }
 
+static void likely_common(struct fetch_negotiator *n, struct commit *c)
+{
+	/* do nothing */
+}
+
 static void add_tip(struct fetch_negotiator *n, struct commit *c)
 {
 	/* do nothing */
@@ -36,6 +41,7 @@ static void release(struct fetch_negotiator *n)
 void noop_negotiator_init(struct fetch_negotiator *negotiator)
 {
 	negotiator->known_common = known_common;
+	negotiator->likely_common = likely_common;
 	negotiator->add_tip = add_tip;
 	negotiator->next = next;
 	negotiator->ack = ack;
@@ -25,6 +25,10 @@
  * This commit has left the priority queue.
  */
 #define POPPED		(1U << 5)
+/*
+ * This commit was passed to likely_common(), and is sent before the others.
+ */
+#define PREFETCHED	(1U << 6)
 
 static int marked;
 
@@ -50,10 +54,20 @@ struct data {
 	int non_common_revs;
 };
 
+/*
+ * Commits passed to likely_common() are sent first, so that the server
+ * can find a common base (and be "ready") in the very first round.
+ * Otherwise, newer commits come before older ones.
+ */
 static int compare(const void *a_, const void *b_, void *unused)
 {
 	const struct entry *a = a_;
 	const struct entry *b = b_;
+	int a_prefetched = !!(a->commit->object.flags & PREFETCHED);
+	int b_prefetched = !!(b->commit->object.flags & PREFETCHED);
+
+	if (a_prefetched != b_prefetched)
+		return b_prefetched - a_prefetched;
 	return compare_commits_by_commit_date(a->commit, b->commit, NULL);
 }
 
@@ -78,7 +92,7 @@ static int clear_marks(const char *refname, const struct object_id *oid,
 
 	if (o && o->type == OBJ_COMMIT)
 		clear_commit_marks((struct commit *)o,
-				   COMMON | ADVERTISED | SEEN | POPPED);
+				   COMMON | ADVERTISED | SEEN | POPPED | PREFETCHED);
 	return 0;
 }
 
@@ -120,8 +134,8 @@ static int push_parent(struct data *data, struct entry *entry,
 		if (to_push->object.flags & POPPED)
 			/*
 			 * The entry for this commit has already been popped,
-			 * due to clock skew. Pretend that this parent does not
-			 * exist.
+			 * due to clock skew or because it was prefetched and
+			 * sent first. Pretend that this parent does not exist.
 			 */
 			return 0;
 		/*
@@ -202,9 +216,17 @@ static void known_common(struct fetch_negotiator *n, struct commit *c)
 	rev_list_push(n->data, c, ADVERTISED);
 }
 
+static void likely_common(struct fetch_negotiator *n, struct commit *c)
+{
+	if (c->object.flags & SEEN)
+		return;
+	rev_list_push(n->data, c, PREFETCHED);
+}
+
 static void add_tip(struct fetch_negotiator *n, struct commit *c)
 {
 	n->known_common = NULL;
+	n->likely_common = NULL;
 	if (c->object.flags & SEEN)
 		return;
 	rev_list_push(n->data, c, 0);
@@ -213,6 +235,7 @@ static void add_tip(struct fetch_negotiator *n, struct commit *c)
 static const struct object_id *next(struct fetch_negotiator *n)
 {
 	n->known_common = NULL;
+	n->likely_common = NULL;
 	n->add_tip = NULL;
 	return get_rev(n->data);
 }
@@ -237,6 +260,7 @@ void skipping_negotiator_init(struct fetch_negotiator *negotiator)
 {
 	struct data *data;
 	negotiator->known_common = known_common;
+	negotiator->likely_common = likely_common;
 	negotiator->add_tip = add_tip;
 	negotiator->next = next;
 	negotiator->ack = ack;
@@ -12,12 +12,24 @@
 
 unsigned int get_max_object_index(void)
 {
+	if (the_repository->parsed_objects->obj_hash_shards)
+		BUG("object hash is split while threads are enabled");
 	return the_repository->parsed_objects->obj_hash_size;
 }
 
+static struct object *obj_hash_object(struct parsed_object_pool *pool,
+				      const struct obj_hash_entry *entry)
+{
+	if (!entry->pos)
+		return NULL;
+	return alloc_indexed_node(pool, entry->pos - 1);
+}
+
 struct object *get_indexed_object(unsigned int idx)
 {
-	return the_repository->parsed_objects->obj_hash[idx];
+	struct parsed_object_pool *pool = the_repository->parsed_objects;
+
+	return obj_hash_object(pool, &pool->obj_hash[idx]);
 }
 
 static const char *object_type_strings[] = {
@@ -54,50 +66,72 @@ int type_from_string_gently(const char *str, ssize_t len, int gentle)
 }
 
 /*
- * Return a numerical hash value between 0 and n-1 for the object with
- * the specified sha1.  n must be a power of 2.  Please note that the
- * return value is *not* consistent across computer architectures.
- */
-static unsigned int hash_obj(const struct object_id *oid, unsigned int n)
-{
-	return oidhash(oid) & (n - 1);
-}
-
-/*
- * Insert obj into the hash table hash, which has length size (which
+ * Insert entry into the hash table hash, which has length size (which
  * must be a power of 2).  On collisions, simply overflow to the next
  * empty bucket.
  */
-static void insert_obj_hash(struct object *obj, struct object **hash, unsigned int size)
+static void insert_obj_hash(const struct obj_hash_entry *entry,
+			    struct obj_hash_entry *hash, unsigned int size)
 {
-	unsigned int j = hash_obj(&obj->oid, size);
+	unsigned int j = entry->hash & (size - 1);
 
-	while (hash[j]) {
+	while (hash[j].pos) {
 		j++;
 		if (j >= size)
 			j = 0;
 	}
-	hash[j] = obj;
+	hash[j] = *entry;
 }
 
 /*
- * Look up the record for the given sha1 in the hash map stored in
- * obj_hash.  Return NULL if it was not found.
+ * While threads are enabled, the object hash is split by the top bits
+ * of the hash into shards, each with its own mutex and table.
  */
-struct object *lookup_object(struct repository *r, const struct object_id *oid)
+#define OBJ_HASH_SHARD_BITS 6
+#define OBJ_HASH_SHARDS (1 << OBJ_HASH_SHARD_BITS)
+
+struct obj_hash_shard {
+	pthread_mutex_t mutex;
+	struct obj_hash_entry *hash;
+	int nr, size;
+};
+
+static struct obj_hash_shard *obj_hash_shard(struct parsed_object_pool *pool,
+					     unsigned int hash)
+{
+	return &pool->obj_hash_shards[hash >> (32 - OBJ_HASH_SHARD_BITS)];
+}
+
+/*
+ * Look up the record for the given sha1 in the hash table `table` of
+ * `size` buckets.  Return NULL if it was not found.
+ *
+ * The table keeps the hash of each object next to its index, so that
+ * probing only needs to look at the object itself when the hashes
+ * match.
+ */
+static struct object *find_obj_hash(struct parsed_object_pool *pool,
+				    struct obj_hash_entry *table, int size,
+				    const struct object_id *oid,
+				    unsigned int hash)
 {
 	unsigned int i, first;
-	struct object *obj;
+	struct obj_hash_entry *entry;
+	struct object *obj = NULL;
 
-	if (!r->parsed_objects->obj_hash)
+	if (!table)
 		return NULL;
 
-	first = i = hash_obj(oid, r->parsed_objects->obj_hash_size);
-	while ((obj = r->parsed_objects->obj_hash[i]) != NULL) {
-		if (oideq(oid, &obj->oid))
-			break;
+	first = i = hash & (size - 1);
+	while ((entry = &table[i])->pos) {
+		if (entry->hash == hash) {
+			obj = alloc_indexed_node(pool, entry->pos - 1);
+			if (oideq(oid, &obj->oid))
+				break;
+			obj = NULL;
+		}
 		i++;
-		if (i == r->parsed_objects->obj_hash_size)
+		if (i == size)
 			i = 0;
 	}
 	if (obj && i != first) {
@@ -106,57 +140,161 @@ struct object *lookup_object(struct repository *r, const struct object_id *oid)
 		 * that we do not need to walk the hash table the next
 		 * time we look for it.
 		 */
-		SWAP(r->parsed_objects->obj_hash[i],
-		     r->parsed_objects->obj_hash[first]);
+		SWAP(table[i], table[first]);
 	}
 	return obj;
 }
 
+struct object *lookup_object(struct repository *r, const struct object_id *oid)
+{
+	struct parsed_object_pool *pool = r->parsed_objects;
+	unsigned int hash = oidhash(oid);
+	struct obj_hash_shard *shard;
+	struct object *obj;
+
+	if (!pool->obj_hash_shards)
+		return find_obj_hash(pool, pool->obj_hash, pool->obj_hash_size,
+				     oid, hash);
+
+	shard = obj_hash_shard(pool, hash);
+	pthread_mutex_lock(&shard->mutex);
+	obj = find_obj_hash(pool, shard->hash, shard->size, oid, hash);
+	pthread_mutex_unlock(&shard->mutex);
+	return obj;
+}
+
 /*
- * Increase the size of the hash map stored in obj_hash to the next
- * power of 2 (but at least 32).  Copy the existing values to the new
- * hash map.
+ * Increase the size of the hash table `*table` to the next power of 2
+ * (but at least 32).  Copy the existing values to the new table.
  */
-static void grow_object_hash(struct repository *r)
+static void grow_obj_hash(struct obj_hash_entry **table, int *size)
 {
 	int i;
 	/*
-	 * Note that this size must always be power-of-2 to match hash_obj
-	 * above.
+	 * Note that this size must always be power-of-2 to match the
+	 * masking in find_obj_hash().
 	 */
-	int new_hash_size = r->parsed_objects->obj_hash_size < 32 ? 32 : 2 * r->parsed_objects->obj_hash_size;
-	struct object **new_hash;
+	int new_hash_size = *size < 32 ? 32 : 2 * *size;
+	struct obj_hash_entry *new_hash;
 
-	new_hash = xcalloc(new_hash_size, sizeof(struct object *));
-	for (i = 0; i < r->parsed_objects->obj_hash_size; i++) {
-		struct object *obj = r->parsed_objects->obj_hash[i];
+	new_hash = xcalloc(new_hash_size, sizeof(*new_hash));
+	for (i = 0; i < *size; i++) {
+		const struct obj_hash_entry *entry = &(*table)[i];
 
-		if (!obj)
+		if (!entry->pos)
 			continue;
-		insert_obj_hash(obj, new_hash, new_hash_size);
+		insert_obj_hash(entry, new_hash, new_hash_size);
 	}
-	free(r->parsed_objects->obj_hash);
-	r->parsed_objects->obj_hash = new_hash;
-	r->parsed_objects->obj_hash_size = new_hash_size;
+	free(*table);
+	*table = new_hash;
+	*size = new_hash_size;
+}
+
+/*
+ * Add `entry` to the table, growing it first if needed. Probing rarely
+ * needs to look at the objects themselves, so the table can be kept
+ * 3/4 full rather than half full.
+ */
+static void add_obj_hash(const struct obj_hash_entry *entry,
+			 struct obj_hash_entry **table, int *nr, int *size)
+{
+	if (*nr >= *size / 4 * 3)
+		grow_obj_hash(table, size);
+	insert_obj_hash(entry, *table, *size);
+	(*nr)++;
 }
 
 void *create_object(struct repository *r, const struct object_id *oid, void *o)
 {
-	struct object *obj = o;
+	struct parsed_object_pool *pool = r->parsed_objects;
+	struct object *obj = o, *existing;
+	struct obj_hash_shard *shard;
+	struct obj_hash_entry entry;
 
 	obj->parsed = 0;
 	obj->flags = 0;
 	oidcpy(&obj->oid, oid);
 
-	if (r->parsed_objects->obj_hash_size - 1 <= r->parsed_objects->nr_objs * 2)
-		grow_object_hash(r);
+	entry.hash = oidhash(oid);
+	entry.pos = alloc_node_index(pool, obj) + 1;
 
-	insert_obj_hash(obj, r->parsed_objects->obj_hash,
-			r->parsed_objects->obj_hash_size);
-	r->parsed_objects->nr_objs++;
+	if (!pool->obj_hash_shards) {
+		add_obj_hash(&entry, &pool->obj_hash,
+			     &pool->nr_objs, &pool->obj_hash_size);
+		return obj;
+	}
+
+	shard = obj_hash_shard(pool, entry.hash);
+	pthread_mutex_lock(&shard->mutex);
+	existing = find_obj_hash(pool, shard->hash, shard->size, oid, entry.hash);
+	if (!existing)
+		add_obj_hash(&entry, &shard->hash, &shard->nr, &shard->size);
+	else if (obj->type == OBJ_NONE)
+		obj = existing;
+	else
+		/* another thread created it after our caller looked */
+		obj = object_as_type(existing, obj->type, 0);
+	pthread_mutex_unlock(&shard->mutex);
 	return obj;
 }
 
+void parsed_object_pool_enable_threads(struct parsed_object_pool *o)
+{
+	int i;
+
+	if (!HAVE_THREADS)
+		return;
+	if (o->obj_hash_shards)
+		BUG("threads are already enabled for this pool");
+
+	CALLOC_ARRAY(o->obj_hash_shards, OBJ_HASH_SHARDS);
+	for (i = 0; i < OBJ_HASH_SHARDS; i++)
+		pthread_mutex_init(&o->obj_hash_shards[i].mutex, NULL);
+	for (i = 0; i < o->obj_hash_size; i++) {
+		struct obj_hash_shard *shard;
+
+		if (!o->obj_hash[i].pos)
+			continue;
+		shard = obj_hash_shard(o, o->obj_hash[i].hash);
+		add_obj_hash(&o->obj_hash[i], &shard->hash,
+			     &shard->nr, &shard->size);
+	}
+	FREE_AND_NULL(o->obj_hash);
+	o->nr_objs = o->obj_hash_size = 0;
+
+	alloc_enable_threads(o);
+}
+
+void parsed_object_pool_disable_threads(struct parsed_object_pool *o)
+{
+	int i, j, nr = 0, size = 32;
+
+	if (!o->obj_hash_shards)
+		return;
+
+	alloc_disable_threads(o);
+
+	for (i = 0; i < OBJ_HASH_SHARDS; i++)
+		nr += o->obj_hash_shards[i].nr;
+	while (nr >= size / 4 * 3)
+		size *= 2;
+	o->obj_hash = xcalloc(size, sizeof(*o->obj_hash));
+	o->obj_hash_size = size;
+	o->nr_objs = nr;
+
+	for (i = 0; i < OBJ_HASH_SHARDS; i++) {
+		struct obj_hash_shard *shard = &o->obj_hash_shards[i];
+
+		for (j = 0; j < shard->size; j++)
+			if (shard->hash[j].pos)
+				insert_obj_hash(&shard->hash[j], o->obj_hash,
+						o->obj_hash_size);
+		free(shard->hash);
+		pthread_mutex_destroy(&shard->mutex);
+	}
+	FREE_AND_NULL(o->obj_hash_shards);
+}
+
 void *object_as_type(struct object *obj, enum object_type type, int quiet)
 {
 	if (obj->type == type)
@@ -447,7 +585,7 @@ void clear_object_flags(unsigned flags)
 	int i;
 
 	for (i=0; i < the_repository->parsed_objects->obj_hash_size; i++) {
-		struct object *obj = the_repository->parsed_objects->obj_hash[i];
+		struct object *obj = get_indexed_object(i);
 		if (obj)
 			obj->flags &= ~flags;
 	}
@@ -458,7 +596,7 @@ void clear_commit_marks_all(unsigned int flags)
 	int i;
 
 	for (i = 0; i < the_repository->parsed_objects->obj_hash_size; i++) {
-		struct object *obj = the_repository->parsed_objects->obj_hash[i];
+		struct object *obj = get_indexed_object(i);
 		if (obj && obj->type == OBJ_COMMIT)
 			obj->flags &= ~flags;
 	}
@@ -469,11 +607,7 @@ struct parsed_object_pool *parsed_object_pool_new(void)
 	struct parsed_object_pool *o = xmalloc(sizeof(*o));
 	memset(o, 0, sizeof(*o));
 
-	o->blob_state = allocate_alloc_state();
-	o->tree_state = allocate_alloc_state();
-	o->commit_state = allocate_alloc_state();
-	o->tag_state = allocate_alloc_state();
-	o->object_state = allocate_alloc_state();
+	o->alloc_arena = allocate_alloc_arena();
 
 	o->is_shallow = -1;
 	o->shallow_stat = xcalloc(1, sizeof(*o->shallow_stat));
@@ -546,8 +680,10 @@ void parsed_object_pool_clear(struct parsed_object_pool *o)
 	 */
 	unsigned i;
 
+	parsed_object_pool_disable_threads(o);
+
 	for (i = 0; i < o->obj_hash_size; i++) {
-		struct object *obj = o->obj_hash[i];
+		struct object *obj = obj_hash_object(o, &o->obj_hash[i]);
 
 		if (!obj)
 			continue;
@@ -566,16 +702,8 @@ void parsed_object_pool_clear(struct parsed_object_pool *o)
 	free_commit_buffer_slab(o->buffer_slab);
 	o->buffer_slab = NULL;
 
-	clear_alloc_state(o->blob_state);
-	clear_alloc_state(o->tree_state);
-	clear_alloc_state(o->commit_state);
-	clear_alloc_state(o->tag_state);
-	clear_alloc_state(o->object_state);
+	clear_alloc_slabs(o);
 	stat_validity_clear(o->shallow_stat);
-	FREE_AND_NULL(o->blob_state);
-	FREE_AND_NULL(o->tree_state);
-	FREE_AND_NULL(o->commit_state);
-	FREE_AND_NULL(o->tag_state);
-	FREE_AND_NULL(o->object_state);
+	FREE_AND_NULL(o->alloc_arena);
 	FREE_AND_NULL(o->shallow_stat);
 }
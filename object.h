@@ -2,19 +2,41 @@
 #define OBJECT_H
 
 #include "cache.h"
+#include "thread-utils.h"
 
 struct buffer_slab;
+struct obj_hash_shard;
+
+struct obj_hash_entry {
+	uint32_t hash;	/* oidhash() of the object */
+	uint32_t pos;	/* alloc_node_index() + 1, or 0 if unused */
+};
+
+struct alloc_slab {
+	const char *base;
+	size_t node_size;
+};
 
 struct parsed_object_pool {
-	struct object **obj_hash;
+	struct obj_hash_entry *obj_hash;
 	int nr_objs, obj_hash_size;
 
-	/* TODO: migrate alloc_states to mem-pool? */
-	struct alloc_state *blob_state;
-	struct alloc_state *tree_state;
-	struct alloc_state *commit_state;
-	struct alloc_state *tag_state;
-	struct alloc_state *object_state;
+	/* Replaces obj_hash while threads are enabled */
+	struct obj_hash_shard *obj_hash_shards;
+
+	/* All slabs of the alloc_arenas, see alloc_node_index() */
+	struct alloc_slab **alloc_slab_dir;
+	uint32_t alloc_slab_nr;
+
+	/* TODO: migrate alloc_arenas to mem-pool? */
+	struct alloc_arena *alloc_arena;
+
+	/* Per-thread arenas, see alloc_enable_threads() */
+	int threads;
+	pthread_key_t arena_key;
+	pthread_mutex_t alloc_mutex;
+	struct alloc_arena **thread_arenas;
+	int thread_arenas_nr, thread_arenas_alloc;
 
 	/* parent substitutions from .git/info/grafts and .git/shallow */
 	struct commit_graft **grafts;
@@ -33,6 +55,22 @@ struct parsed_object_pool {
 struct parsed_object_pool *parsed_object_pool_new(void);
 void parsed_object_pool_clear(struct parsed_object_pool *o);
 
+/*
+ * Allow lookup_object(), create_object(), the lookup_<type>() functions
+ * and the alloc_<type>_node() functions to be called from several threads
+ * at once. Each thread allocates from its own arena (see alloc.h), and
+ * the object hash is split into shards that each have their own mutex.
+ * If two threads create the same object, both get the one that was
+ * inserted first.
+ *
+ * Anything else about the objects, like parsing them or setting their
+ * flags, is still up to the caller to serialize. get_indexed_object()
+ * and get_max_object_index() cannot be used until the threads are
+ * disabled again, which puts all objects back in a single hash table.
+ */
+void parsed_object_pool_enable_threads(struct parsed_object_pool *o);
+void parsed_object_pool_disable_threads(struct parsed_object_pool *o);
+
 struct object_list {
 	struct object *item;
 	struct object_list *next;
@@ -61,7 +99,7 @@ struct object_array {
  * object flag allocation:
  * revision.h:               0---------10         15             23------26
  * fetch-pack.c:             01
- * negotiator/default.c:       2--5
+ * negotiator/default.c:       2---6
  * walker.c:                 0-2
  * upload-pack.c:                4       11-----14  16-----19
  * builtin/blame.c:                        12-13
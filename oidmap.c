@@ -21,6 +21,11 @@ void oidmap_init(struct oidmap *map, size_t initial_size)
 	hashmap_init(&map->map, oidmap_neq, NULL, initial_size);
 }
 
+void oidmap_init_open(struct oidmap *map, size_t initial_size)
+{
+	hashmap_init_open(&map->map, oidmap_neq, NULL, initial_size);
+}
+
 void oidmap_free(struct oidmap *map, int free_entries)
 {
 	if (!map)
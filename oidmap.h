@@ -35,6 +35,14 @@ struct oidmap {
  */
 void oidmap_init(struct oidmap *map, size_t initial_size);
 
+/*
+ * Initializes an oidmap structure that uses an open-addressing hashmap
+ * (see `hashmap_init_open()`). Inserting and looking up oids that are not
+ * in the map is faster than with `oidmap_init()`, but finding oids that
+ * are is a bit slower.
+ */
+void oidmap_init_open(struct oidmap *map, size_t initial_size);
+
 /*
  * Frees an oidmap structure and allocated memory.
  *
@@ -663,6 +663,7 @@ unsigned char *use_pack(struct packed_git *p,
 				&& !p->do_not_close)
 				close_pack_fd(p);
 			pack_mmap_calls++;
+			trace2_counter_add(TRACE2_COUNTER_ID_PACK_WINDOW_MAPS, 1);
 			pack_open_windows++;
 			if (pack_mapped > peak_pack_mapped)
 				peak_pack_mapped = pack_mapped;
@@ -1360,10 +1361,33 @@ static enum object_type packed_to_object_type(struct repository *r,
 	goto out;
 }
 
+/*
+ * The delta base cache keeps the bases that unpack_entry() reconstructed
+ * on its way to an object, so that objects sharing a base do not have to
+ * reconstruct it again. Like the rest of the object reading code, it is
+ * protected by obj_read_lock() when several threads read objects.
+ *
+ * The clock counts the accesses to the cache. An entry's priority is the
+ * clock at its last use, plus a bonus for what it costs to reconstruct per
+ * byte it occupies, and the entry with the lowest priority is evicted
+ * first. Eviction is therefore mostly least-recently-used, but a large
+ * base near the top of its delta chain goes before the small, deep tree
+ * bases that would be expensive to rebuild. The entry being added is
+ * never evicted to make room for itself.
+ */
+
+/*
+ * Reconstructing a base means inflating and applying each delta of its
+ * chain, which costs about its size plus this fixed overhead per step.
+ */
+#define DELTA_BASE_STEP_OVERHEAD 4096
+
+/* Clock ticks that one step of reconstructing a large base is worth. */
+#define DELTA_BASE_COST_WEIGHT 4
+
 static struct hashmap delta_base_cache;
 static size_t delta_base_cached;
-
-static LIST_HEAD(delta_base_cache_lru);
+static uint64_t delta_base_clock;
 
 struct delta_base_cache_key {
 	struct packed_git *p;
@@ -1373,12 +1397,18 @@ struct delta_base_cache_key {
 struct delta_base_cache_entry {
 	struct hashmap_entry ent;
 	struct delta_base_cache_key key;
-	struct list_head lru;
+	uint64_t priority;
+	unsigned int heap_pos;
+	unsigned int depth;	/* number of deltas applied to get "data" */
 	void *data;
 	unsigned long size;
 	enum object_type type;
 };
 
+/* min-heap of the cached entries by priority */
+static struct delta_base_cache_entry **delta_base_heap;
+static unsigned int delta_base_heap_nr, delta_base_heap_alloc;
+
 static unsigned int pack_entry_hash(struct packed_git *p, off_t base_offset)
 {
 	unsigned int hash;
@@ -1432,6 +1462,52 @@ static int in_delta_base_cache(struct packed_git *p, off_t base_offset)
 	return !!get_delta_base_cache_entry(p, base_offset);
 }
 
+/*
+ * Return the eviction priority of a base of `size` bytes that took `depth`
+ * deltas to reconstruct, and advance the clock.
+ */
+static uint64_t delta_base_priority(unsigned long size, unsigned int depth)
+{
+	uint64_t cost = (uint64_t)(depth + 1) * (size + DELTA_BASE_STEP_OVERHEAD);
+
+	return delta_base_clock++ + DELTA_BASE_COST_WEIGHT * cost / (size + 1);
+}
+
+static void delta_base_heap_set(unsigned int pos,
+				struct delta_base_cache_entry *ent)
+{
+	delta_base_heap[pos] = ent;
+	ent->heap_pos = pos;
+}
+
+static void delta_base_heap_fix(unsigned int pos)
+{
+	struct delta_base_cache_entry *ent = delta_base_heap[pos];
+
+	while (pos) {
+		unsigned int parent = (pos - 1) / 2;
+
+		if (delta_base_heap[parent]->priority <= ent->priority)
+			break;
+		delta_base_heap_set(pos, delta_base_heap[parent]);
+		pos = parent;
+	}
+	for (;;) {
+		unsigned int child = 2 * pos + 1;
+
+		if (child >= delta_base_heap_nr)
+			break;
+		if (child + 1 < delta_base_heap_nr &&
+		    delta_base_heap[child + 1]->priority < delta_base_heap[child]->priority)
+			child++;
+		if (ent->priority <= delta_base_heap[child]->priority)
+			break;
+		delta_base_heap_set(pos, delta_base_heap[child]);
+		pos = child;
+	}
+	delta_base_heap_set(pos, ent);
+}
+
 /*
  * Remove the entry from the cache, but do _not_ free the associated
  * entry data. The caller takes ownership of the "data" buffer, and
@@ -1439,8 +1515,13 @@ static int in_delta_base_cache(struct packed_git *p, off_t base_offset)
  */
 static void detach_delta_base_cache_entry(struct delta_base_cache_entry *ent)
 {
+	unsigned int pos = ent->heap_pos;
+
 	hashmap_remove(&delta_base_cache, &ent->ent, &ent->key);
-	list_del(&ent->lru);
+	if (pos != --delta_base_heap_nr) {
+		delta_base_heap_set(pos, delta_base_heap[delta_base_heap_nr]);
+		delta_base_heap_fix(pos);
+	}
 	delta_base_cached -= ent->size;
 	free(ent);
 }
@@ -1454,6 +1535,10 @@ static void *cache_or_unpack_entry(struct repository *r, struct packed_git *p,
 	ent = get_delta_base_cache_entry(p, base_offset);
 	if (!ent)
 		return unpack_entry(r, p, base_offset, type, base_size);
+	trace2_counter_add(TRACE2_COUNTER_ID_DELTA_BASE_CACHE_HIT, 1);
+
+	ent->priority = delta_base_priority(ent->size, ent->depth);
+	delta_base_heap_fix(ent->heap_pos);
 
 	if (type)
 		*type = ent->type;
@@ -1470,19 +1555,15 @@ static inline void release_delta_base_cache(struct delta_base_cache_entry *ent)
 
 void clear_delta_base_cache(void)
 {
-	struct list_head *lru, *tmp;
-	list_for_each_safe(lru, tmp, &delta_base_cache_lru) {
-		struct delta_base_cache_entry *entry =
-			list_entry(lru, struct delta_base_cache_entry, lru);
-		release_delta_base_cache(entry);
-	}
+	while (delta_base_heap_nr)
+		release_delta_base_cache(delta_base_heap[0]);
 }
 
 static void add_delta_base_cache(struct packed_git *p, off_t base_offset,
-	void *base, unsigned long base_size, enum object_type type)
+	void *base, unsigned long base_size, enum object_type type,
+	unsigned int depth)
 {
 	struct delta_base_cache_entry *ent;
-	struct list_head *lru, *tmp;
 
 	/*
 	 * Check required to avoid redundant entries when more than one thread
@@ -1494,14 +1575,11 @@ static void add_delta_base_cache(struct packed_git *p, off_t base_offset,
 		return;
 	}
 
+	/* make room first, so that the new entry is never the one evicted */
 	delta_base_cached += base_size;
-
-	list_for_each_safe(lru, tmp, &delta_base_cache_lru) {
-		struct delta_base_cache_entry *f =
-			list_entry(lru, struct delta_base_cache_entry, lru);
-		if (delta_base_cached <= delta_base_cache_limit)
-			break;
-		release_delta_base_cache(f);
+	while (delta_base_heap_nr && delta_base_cached > delta_base_cache_limit) {
+		trace2_counter_add(TRACE2_COUNTER_ID_DELTA_BASE_CACHE_EVICT, 1);
+		release_delta_base_cache(delta_base_heap[0]);
 	}
 
 	ent = xmalloc(sizeof(*ent));
@@ -1510,12 +1588,16 @@ static void add_delta_base_cache(struct packed_git *p, off_t base_offset,
 	ent->type = type;
 	ent->data = base;
 	ent->size = base_size;
-	list_add_tail(&ent->lru, &delta_base_cache_lru);
+	ent->depth = depth;
+	ent->priority = delta_base_priority(base_size, depth);
 
 	if (!delta_base_cache.cmpfn)
 		hashmap_init(&delta_base_cache, delta_base_cache_hash_cmp, NULL, 0);
 	hashmap_entry_init(&ent->ent, pack_entry_hash(p, base_offset));
 	hashmap_add(&delta_base_cache, &ent->ent);
+	ALLOC_GROW(delta_base_heap, delta_base_heap_nr + 1, delta_base_heap_alloc);
+	delta_base_heap_set(delta_base_heap_nr++, ent);
+	delta_base_heap_fix(ent->heap_pos);
 }
 
 int packed_object_info(struct repository *r, struct packed_git *p,
@@ -1696,8 +1778,10 @@ void *unpack_entry(struct repository *r, struct packed_git *p, off_t obj_offset,
 	struct unpack_entry_stack_ent *delta_stack = small_delta_stack;
 	int delta_stack_nr = 0, delta_stack_alloc = UNPACK_ENTRY_STACK_PREALLOC;
 	int base_from_cache = 0;
+	unsigned int base_depth = 0;
 
 	g_nr_unpack_entry++;
+	trace2_timer_start(TRACE2_TIMER_ID_UNPACK_ENTRY);
 
 	write_pack_access_log(p, obj_offset);
 
@@ -1709,13 +1793,18 @@ void *unpack_entry(struct repository *r, struct packed_git *p, off_t obj_offset,
 
 		ent = get_delta_base_cache_entry(p, curpos);
 		if (ent) {
+			trace2_counter_add(TRACE2_COUNTER_ID_DELTA_BASE_CACHE_HIT, 1);
 			type = ent->type;
 			data = ent->data;
 			size = ent->size;
+			base_depth = ent->depth;
 			detach_delta_base_cache_entry(ent);
 			base_from_cache = 1;
 			break;
 		}
+		/* only the base of a delta is expected to be cached */
+		if (delta_stack_nr)
+			trace2_counter_add(TRACE2_COUNTER_ID_DELTA_BASE_CACHE_MISS, 1);
 
 		if (do_check_packed_object_crc && p->index_version > 1) {
 			struct revindex_entry *revidx = find_pack_revindex(p, obj_offset);
@@ -1861,7 +1950,9 @@ void *unpack_entry(struct repository *r, struct packed_git *p, off_t obj_offset,
 		 * before we are done using it.
 		 */
 		if (!external_base)
-			add_delta_base_cache(p, base_obj_offset, base, base_size, type);
+			add_delta_base_cache(p, base_obj_offset, base, base_size,
+					     type, base_depth);
+		base_depth++;
 
 		free(delta_data);
 		free(external_base);
@@ -1878,6 +1969,7 @@ void *unpack_entry(struct repository *r, struct packed_git *p, off_t obj_offset,
 	if (delta_stack != small_delta_stack)
 		free(delta_stack);
 
+	trace2_timer_stop(TRACE2_TIMER_ID_UNPACK_ENTRY);
 	return data;
 }
 
@@ -4,6 +4,8 @@
 #include "promisor-remote.h"
 #include "config.h"
 #include "transport.h"
+#include "oid-array.h"
+#include "oidmap.h"
 #include "strvec.h"
 
 static char *repository_format_partial_clone;
@@ -137,10 +139,25 @@ static int promisor_remote_config(const char *var, const char *value, void *data
 	return 0;
 }
 
+/*
+ * The answers of the promisor remotes to "object-info" requests, so that
+ * no object is asked about twice. An object that no remote knows has type
+ * OBJ_BAD.
+ */
+struct object_info_entry {
+	struct oidmap_entry entry;
+	enum object_type type;
+	unsigned long size;
+};
+
+static struct oidmap object_info_cache = OIDMAP_INIT;
+
 static int initialized;
 
 static void promisor_remote_init(void)
 {
+	struct promisor_remote *r;
+
 	if (initialized)
 		return;
 	initialized = 1;
@@ -157,6 +174,15 @@ static void promisor_remote_init(void)
 		else
 			promisor_remote_new(repository_format_partial_clone);
 	}
+
+	for (r = promisors; r; r = r->next) {
+		char *key = xstrfmt("remote.%s.objectinfo", r->name);
+		int value;
+
+		if (!git_config_get_bool(key, &value))
+			r->object_info = value;
+		free(key);
+	}
 }
 
 static void promisor_remote_clear(void)
@@ -164,10 +190,13 @@ static void promisor_remote_clear(void)
 	while (promisors) {
 		struct promisor_remote *r = promisors;
 		promisors = promisors->next;
+		if (r->object_info_transport)
+			transport_disconnect(r->object_info_transport);
 		free(r);
 	}
 
 	promisors_tail = &promisors;
+	oidmap_free(&object_info_cache, 1);
 }
 
 void promisor_remote_reinit(void)
@@ -266,3 +295,120 @@ int promisor_remote_get_direct(struct repository *repo,
 
 	return res;
 }
+
+static void remember_object_info(const struct object_id *oid,
+				 enum object_type type, unsigned long size)
+{
+	struct object_info_entry *e = xmalloc(sizeof(*e));
+
+	oidcpy(&e->entry.oid, oid);
+	e->type = type;
+	e->size = size;
+	free(oidmap_put(&object_info_cache, e));
+}
+
+/*
+ * Ask "r" about "oids" in a single request, over a connection that is
+ * kept open for later requests, and remember what it knows. The objects
+ * it does not know are left in "oids". Remotes that turn out not to
+ * support "object-info" are not asked again. Returns -1 if "r" could not
+ * be asked.
+ */
+static int object_info_from(struct promisor_remote *r, struct oid_array *oids)
+{
+	struct oid_array unknown = OID_ARRAY_INIT;
+	enum object_type *types;
+	unsigned long *sizes;
+	int i, ret;
+
+	if (!r->object_info || r->no_object_info)
+		return -1;
+	if (!r->object_info_transport) {
+		struct remote *remote = remote_get(r->name);
+
+		if (!remote || !remote->url_nr) {
+			r->no_object_info = 1;
+			return -1;
+		}
+		r->object_info_transport = transport_get(remote, NULL);
+	}
+
+	ALLOC_ARRAY(types, oids->nr);
+	ALLOC_ARRAY(sizes, oids->nr);
+	ret = transport_get_object_info(r->object_info_transport, oids,
+					sizes, types);
+	if (ret < 0) {
+		transport_disconnect(r->object_info_transport);
+		r->object_info_transport = NULL;
+		r->no_object_info = 1;
+	} else {
+		for (i = 0; i < oids->nr; i++) {
+			if (types[i] > 0)
+				remember_object_info(&oids->oid[i], types[i],
+						     sizes[i]);
+			else
+				oid_array_append(&unknown, &oids->oid[i]);
+		}
+		trace2_data_intmax("promisor", the_repository,
+				   "object-info/count", oids->nr);
+		oid_array_clear(oids);
+		*oids = unknown;
+	}
+	free(types);
+	free(sizes);
+	return ret;
+}
+
+static int append_unique(const struct object_id *oid, void *data)
+{
+	oid_array_append(data, oid);
+	return 0;
+}
+
+void promisor_remote_get_object_info_many(struct repository *repo,
+					  const struct object_id *oids,
+					  int oid_nr)
+{
+	struct oid_array todo = OID_ARRAY_INIT;
+	struct oid_array unique = OID_ARRAY_INIT;
+	struct promisor_remote *r;
+	int i, asked = 0;
+
+	if (core_use_gvfs_helper)
+		return;
+
+	promisor_remote_init();
+
+	for (i = 0; i < oid_nr; i++)
+		if (!oidmap_get(&object_info_cache, &oids[i]))
+			oid_array_append(&todo, &oids[i]);
+	oid_array_for_each_unique(&todo, append_unique, &unique);
+	oid_array_clear(&todo);
+	todo = unique;
+
+	for (r = promisors; r && todo.nr; r = r->next)
+		if (!object_info_from(r, &todo))
+			asked = 1;
+
+	/* do not ask again about objects that no remote knows */
+	if (asked)
+		for (i = 0; i < todo.nr; i++)
+			remember_object_info(&todo.oid[i], OBJ_BAD, 0);
+	oid_array_clear(&todo);
+}
+
+int promisor_remote_get_object_info(struct repository *repo,
+				    const struct object_id *oid,
+				    enum object_type *type,
+				    unsigned long *size)
+{
+	struct object_info_entry *e;
+
+	promisor_remote_get_object_info_many(repo, oid, 1);
+	e = oidmap_get(&object_info_cache, oid);
+	if (!e || e->type == OBJ_BAD)
+		return -1;
+	*type = e->type;
+	*size = e->size;
+	return 0;
+}
@@ -4,6 +4,7 @@
 #include "repository.h"
 
 struct object_id;
+struct transport;
 
 /*
  * Promisor remote linked list
@@ -14,6 +15,11 @@ struct object_id;
 struct promisor_remote {
 	struct promisor_remote *next;
 	const char *partial_clone_filter;
+	/* connection used for "object-info" requests, if any */
+	struct transport *object_info_transport;
+	/* from remote.XXX.objectInfo */
+	unsigned object_info : 1;
+	unsigned no_object_info : 1;
 	const char name[FLEX_ARRAY];
 };
 
@@ -32,6 +38,28 @@ int promisor_remote_get_direct(struct repository *repo,
 			       const struct object_id *oids,
 			       int oid_nr);
 
+/*
+ * Asks the promisor remotes that have remote.XXX.objectInfo set for the
+ * type and size of an object without fetching it, using the protocol v2
+ * "object-info" command where the remote supports it. Returns 0 and fills
+ * in "type" and "size" if a remote knows the object, and -1 otherwise.
+ * The answers are remembered, so each object is asked about only once.
+ */
+int promisor_remote_get_object_info(struct repository *repo,
+				    const struct object_id *oid,
+				    enum object_type *type,
+				    unsigned long *size);
+
+/*
+ * Like promisor_remote_get_object_info(), but asks about all the given
+ * objects in a single request, so that later calls to
+ * promisor_remote_get_object_info() for any of them are answered without
+ * contacting the remotes again.
+ */
+void promisor_remote_get_object_info_many(struct repository *repo,
+					  const struct object_id *oids,
+					  int oid_nr);
+
 /*
  * This should be used only once from setup.c to set the value we got
  * from the extensions.partialclone config option.
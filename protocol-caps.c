@@ -0,0 +1,120 @@
+#include "cache.h"
+#include "repository.h"
+#include "config.h"
+#include "object.h"
+#include "object-store.h"
+#include "oid-array.h"
+#include "pkt-line.h"
+#include "strvec.h"
+#include "protocol-caps.h"
+
+struct requested_info {
+	unsigned size : 1;
+	unsigned type : 1;
+};
+
+int object_info_advertise(struct repository *r, struct strbuf *value)
+{
+	int advertise = 0;
+
+	repo_config_get_bool(r, "transfer.advertiseobjectinfo", &advertise);
+	return advertise;
+}
+
+/*
+ * Send one "<oid>[ <size>][ <type>]" line per requested object, after a
+ * line naming the requested attributes in the order they appear. An
+ * attribute is left empty if the object does not exist.
+ */
+static void send_info(struct repository *r, struct packet_writer *writer,
+		      const struct oid_array *oids,
+		      const struct requested_info *info)
+{
+	struct strbuf buf = STRBUF_INIT;
+	int i;
+
+	if (!oids->nr)
+		return;
+
+	if (info->size)
+		strbuf_addstr(&buf, " size");
+	if (info->type)
+		strbuf_addstr(&buf, " type");
+	packet_writer_write(writer, "attrs%s", buf.buf);
+
+	for (i = 0; i < oids->nr; i++) {
+		const struct object_id *oid = &oids->oid[i];
+		struct object_info oi = OBJECT_INFO_INIT;
+		unsigned long size;
+		enum object_type type;
+		int found;
+
+		if (info->size)
+			oi.sizep = &size;
+		if (info->type)
+			oi.typep = &type;
+		found = !oid_object_info_extended(r, oid, &oi,
+						  OBJECT_INFO_SKIP_FETCH_OBJECT);
+
+		strbuf_reset(&buf);
+		strbuf_addstr(&buf, oid_to_hex(oid));
+		if (info->size) {
+			strbuf_addch(&buf, ' ');
+			if (found)
+				strbuf_addf(&buf, "%lu", size);
+		}
+		if (info->type) {
+			strbuf_addch(&buf, ' ');
+			if (found)
+				strbuf_addstr(&buf, type_name(type));
+		}
+		packet_writer_write(writer, "%s", buf.buf);
+	}
+	strbuf_release(&buf);
+}
+
+int cap_object_info(struct repository *r, struct strvec *keys,
+		    struct packet_reader *request)
+{
+	struct requested_info info = { 0 };
+	struct packet_writer writer;
+	struct oid_array oids = OID_ARRAY_INIT;
+
+	packet_writer_init(&writer, 1);
+
+	while (packet_reader_read(request) == PACKET_READ_NORMAL) {
+		const char *arg = request->line;
+		const char *out;
+		struct object_id oid;
+
+		if (!strcmp("size", arg))
+			info.size = 1;
+		else if (!strcmp("type", arg))
+			info.type = 1;
+		else if (skip_prefix(arg, "oid ", &out)) {
+			if (get_oid_hex(out, &oid) || out[the_hash_algo->hexsz]) {
+				packet_writer_error(&writer,
+						    "object-info: expected oid, got '%s'",
+						    out);
+				die("object-info: expected oid, got '%s'", out);
+			}
+			oid_array_append(&oids, &oid);
+		} else {
+			packet_writer_error(&writer,
+					    "object-info: unexpected line: '%s'",
+					    arg);
+			die("object-info: unexpected line: '%s'", arg);
+		}
+	}
+
+	if (request->status != PACKET_READ_FLUSH) {
+		packet_writer_error(&writer,
+				    "object-info: expected flush after arguments");
+		die(_("expected flush after object-info arguments"));
+	}
+
+	send_info(r, &writer, &oids, &info);
+	packet_flush(1);
+	oid_array_clear(&oids);
+	return 0;
+}
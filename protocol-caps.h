@@ -0,0 +1,12 @@
+#ifndef PROTOCOL_CAPS_H
+#define PROTOCOL_CAPS_H
+
+struct repository;
+struct strbuf;
+struct strvec;
+struct packet_reader;
+int object_info_advertise(struct repository *r, struct strbuf *value);
+int cap_object_info(struct repository *r, struct strvec *keys,
+		    struct packet_reader *request);
+
+#endif /* PROTOCOL_CAPS_H */
@@ -1381,7 +1381,7 @@ static struct cache_entry *refresh_cache_ent(struct index_state *istate,
 {
 	struct stat st;
 	struct cache_entry *updated;
-	int changed;
+	int changed, err_lstat;
 	int refresh = options & CE_MATCH_REFRESH;
 	int ignore_valid = options & CE_MATCH_IGNORE_VALID;
 	int ignore_skip_worktree = options & CE_MATCH_IGNORE_SKIP_WORKTREE;
@@ -1419,7 +1419,11 @@ static struct cache_entry *refresh_cache_ent(struct index_state *istate,
 		return NULL;
 	}
 
-	if (lstat(ce->name, &st) < 0) {
+	trace2_counter_add(TRACE2_COUNTER_ID_INDEX_LSTAT, 1);
+	trace2_timer_start(TRACE2_TIMER_ID_INDEX_LSTAT);
+	err_lstat = lstat(ce->name, &st);
+	trace2_timer_stop(TRACE2_TIMER_ID_INDEX_LSTAT);
+	if (err_lstat < 0) {
 		if (ignore_missing && errno == ENOENT)
 			return ce;
 		if (err)
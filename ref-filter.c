@@ -490,6 +490,14 @@ static int head_atom_parser(const struct ref_format *format, struct used_atom *a
 	return 0;
 }
 
+static int ahead_behind_atom_parser(const struct ref_format *format, struct used_atom *atom,
+				   const char *arg, struct strbuf *err)
+{
+	if (!arg)
+		return strbuf_addf_ret(err, -1, _("expected format: %%(ahead-behind:<committish>)"));
+	return 0;
+}
+
 static struct {
 	const char *name;
 	info_source source;
@@ -538,6 +546,7 @@ static struct {
 	{ "if", SOURCE_NONE, FIELD_STR, if_atom_parser },
 	{ "then", SOURCE_NONE },
 	{ "else", SOURCE_NONE },
+	{ "ahead-behind", SOURCE_OTHER, FIELD_STR, ahead_behind_atom_parser },
 	/*
 	 * Please update $__git_ref_fieldlist in git-completion.bash
 	 * when you add new atoms
@@ -1467,16 +1476,34 @@ static const char *show_ref(struct refname_atom *atom, const char *refname)
 		return xstrdup(refname);
 }
 
+/*
+ * Use the counts computed by filter_ahead_behind() when there are
+ * any, as stat_tracking_info() walks the history for each branch.
+ */
+static int tracking_counts(struct used_atom *atom, struct branch *branch,
+			   const struct ahead_behind_count *count,
+			   int *num_ours, int *num_theirs)
+{
+	if (!count)
+		return stat_tracking_info(branch, num_ours, num_theirs,
+					  NULL, atom->u.remote_ref.push,
+					  AHEAD_BEHIND_FULL);
+	*num_ours = count->ahead;
+	*num_theirs = count->behind;
+	return 0;
+}
+
 static void fill_remote_ref_details(struct used_atom *atom, const char *refname,
-				    struct branch *branch, const char **s)
+				    struct branch *branch,
+				    const struct ahead_behind_count *count,
+				    const char **s)
 {
 	int num_ours, num_theirs;
 	if (atom->u.remote_ref.option == RR_REF)
 		*s = show_ref(&atom->u.remote_ref.refname, refname);
 	else if (atom->u.remote_ref.option == RR_TRACK) {
-		if (stat_tracking_info(branch, &num_ours, &num_theirs,
-				       NULL, atom->u.remote_ref.push,
-				       AHEAD_BEHIND_FULL) < 0) {
+		if (tracking_counts(atom, branch, count,
+				    &num_ours, &num_theirs) < 0) {
 			*s = xstrdup(msgs.gone);
 		} else if (!num_ours && !num_theirs)
 			*s = xstrdup("");
@@ -1493,9 +1520,8 @@ static void fill_remote_ref_details(struct used_atom *atom, const char *refname,
 			free((void *)to_free);
 		}
 	} else if (atom->u.remote_ref.option == RR_TRACKSHORT) {
-		if (stat_tracking_info(branch, &num_ours, &num_theirs,
-				       NULL, atom->u.remote_ref.push,
-				       AHEAD_BEHIND_FULL) < 0) {
+		if (tracking_counts(atom, branch, count,
+				    &num_ours, &num_theirs) < 0) {
 			*s = xstrdup("");
 			return;
 		}
@@ -1655,6 +1681,77 @@ static char *get_worktree_path(const struct used_atom *atom, const struct ref_ar
 	return xstrdup(lookup_result->wt->path);
 }
 
+static struct ahead_behind_count *item_count(struct ref_array_item *ref, int atom)
+{
+	return ref->counts ? ref->counts[atom] : NULL;
+}
+
+/*
+ * Count the commits on each side of "tip...base" with a revision walk,
+ * which unlike ahead_behind() stops at the merge base even when there
+ * are no generation numbers to order the walk.
+ */
+static void left_right_count(struct commit *tip, struct commit *base,
+			     struct ahead_behind_count *count)
+{
+	struct rev_info revs;
+	struct strvec argv = STRVEC_INIT;
+	struct commit *c;
+
+	count->ahead = count->behind = 0;
+	if (tip == base)
+		return;
+
+	strvec_push(&argv, ""); /* ignored */
+	strvec_push(&argv, "--left-right");
+	strvec_pushf(&argv, "%s...%s", oid_to_hex(&tip->object.oid),
+		     oid_to_hex(&base->object.oid));
+	strvec_push(&argv, "--");
+
+	repo_init_revisions(the_repository, &revs, NULL);
+	setup_revisions(argv.nr, argv.v, &revs, NULL);
+	if (prepare_revision_walk(&revs))
+		die(_("revision walk setup failed"));
+	while ((c = get_revision(&revs))) {
+		if (c->object.flags & SYMMETRIC_LEFT)
+			count->ahead++;
+		else
+			count->behind++;
+	}
+
+	clear_commit_marks(tip, ALL_REV_FLAGS);
+	clear_commit_marks(base, ALL_REV_FLAGS);
+	strvec_clear(&argv);
+}
+
+/*
+ * Compute %(ahead-behind:<base>) for a single ref, for callers that
+ * did not call filter_ahead_behind() or when it had no generation
+ * numbers to work with.
+ */
+static int single_ahead_behind(struct ref_array_item *ref, const char *base_name,
+			       struct ahead_behind_count *count)
+{
+	struct commit *commits[2];
+
+	commits[0] = lookup_commit_reference_gently(the_repository,
+						    &ref->objectname, 1);
+	commits[1] = lookup_commit_reference_by_name(base_name);
+	if (!commits[1])
+		die(_("failed to find '%s'"), base_name);
+	if (!commits[0])
+		return -1;
+
+	if (!generation_numbers_enabled(the_repository)) {
+		left_right_count(commits[0], commits[1], count);
+		return 0;
+	}
+	count->tip_index = 0;
+	count->base_index = 1;
+	ahead_behind(the_repository, commits, 2, count, 1);
+	return 0;
+}
+
 /*
  * Parse the object referred by ref, and grab needed value.
  */
@@ -1713,7 +1810,8 @@ static int populate_value(struct ref_array_item *ref, struct strbuf *err)
 
 			refname = branch_get_upstream(branch, NULL);
 			if (refname)
-				fill_remote_ref_details(atom, refname, branch, &v->s);
+				fill_remote_ref_details(atom, refname, branch,
+							item_count(ref, i), &v->s);
 			else
 				v->s = xstrdup("");
 			continue;
@@ -1734,7 +1832,20 @@ static int populate_value(struct ref_array_item *ref, struct strbuf *err)
 			}
 			/* We will definitely re-init v->s on the next line. */
 			free((char *)v->s);
-			fill_remote_ref_details(atom, refname, branch, &v->s);
+			fill_remote_ref_details(atom, refname, branch,
+						item_count(ref, i), &v->s);
+			continue;
+		} else if (skip_prefix(name, "ahead-behind:", &name)) {
+			struct ahead_behind_count single, *count;
+
+			count = item_count(ref, i);
+			if (!count && !ref->counts &&
+			    !single_ahead_behind(ref, name, &single))
+				count = &single;
+			if (count)
+				v->s = xstrfmt("%u %u", count->ahead, count->behind);
+			else
+				v->s = xstrdup("");
 			continue;
 		} else if (starts_with(name, "color:")) {
 			v->s = xstrdup(atom->u.color);
@@ -2197,6 +2308,7 @@ static int ref_filter_handler(const char *refname, const struct object_id *oid,
 static void free_array_item(struct ref_array_item *item)
 {
 	free((char *)item->symref);
+	free(item->counts);
 	if (item->value) {
 		int i;
 		for (i = 0; i < used_atom_cnt; i++)
@@ -2215,6 +2327,7 @@ void ref_array_clear(struct ref_array *array)
 		free_array_item(array->items[i]);
 	FREE_AND_NULL(array->items);
 	array->nr = array->alloc = 0;
+	FREE_AND_NULL(array->counts);
 
 	for (i = 0; i < used_atom_cnt; i++)
 		free((char *)used_atom[i].name);
@@ -2235,34 +2348,45 @@ static void reach_filter(struct ref_array *array,
 			 struct commit_list *check_reachable,
 			 int include_reached)
 {
-	struct rev_info revs;
 	int i, old_nr;
 	struct commit **to_clear;
-	struct commit_list *cr;
 
 	if (!check_reachable)
 		return;
 
-	to_clear = xcalloc(sizeof(struct commit *), array->nr);
+	ALLOC_ARRAY(to_clear, array->nr);
+	for (i = 0; i < array->nr; i++)
+		to_clear[i] = array->items[i]->commit;
 
-	repo_init_revisions(the_repository, &revs, NULL);
+	/*
+	 * tips_reachable_from_bases() relies on generation numbers to
+	 * stop; without them, a limited walk stops sooner.
+	 */
+	if (generation_numbers_enabled(the_repository)) {
+		tips_reachable_from_bases(the_repository, check_reachable,
+					  to_clear, array->nr, UNINTERESTING);
+	} else {
+		struct rev_info revs;
+		struct commit_list *cr;
+
+		repo_init_revisions(the_repository, &revs, NULL);
+
+		for (i = 0; i < array->nr; i++) {
+			struct ref_array_item *item = array->items[i];
+			add_pending_object(&revs, &item->commit->object, item->refname);
+		}
 
-	for (i = 0; i < array->nr; i++) {
-		struct ref_array_item *item = array->items[i];
-		add_pending_object(&revs, &item->commit->object, item->refname);
-		to_clear[i] = item->commit;
-	}
+		for (cr = check_reachable; cr; cr = cr->next) {
+			struct commit *merge_commit = cr->item;
+			merge_commit->object.flags |= UNINTERESTING;
+			add_pending_object(&revs, &merge_commit->object, "");
+		}
 
-	for (cr = check_reachable; cr; cr = cr->next) {
-		struct commit *merge_commit = cr->item;
-		merge_commit->object.flags |= UNINTERESTING;
-		add_pending_object(&revs, &merge_commit->object, "");
+		revs.limited = 1;
+		if (prepare_revision_walk(&revs))
+			die(_("revision walk setup failed"));
 	}
 
-	revs.limited = 1;
-	if (prepare_revision_walk(&revs))
-		die(_("revision walk setup failed"));
-
 	old_nr = array->nr;
 	array->nr = 0;
 
@@ -2342,6 +2466,145 @@ int filter_refs(struct ref_array *array, struct ref_filter *filter, unsigned int
 	return ret;
 }
 
+static int want_ahead_behind(struct used_atom *atom, const char **base, int *push)
+{
+	const char *name = atom->name;
+
+	if (*name == '*')
+		name++;
+	if (skip_prefix(name, "ahead-behind:", base))
+		return 1;
+	*base = NULL;
+	if (!starts_with(name, "upstream") && !starts_with(name, "push"))
+		return 0;
+	*push = atom->u.remote_ref.push;
+	return atom->u.remote_ref.option == RR_TRACK ||
+	       atom->u.remote_ref.option == RR_TRACKSHORT;
+}
+
+static size_t add_ahead_behind_commit(struct commit ***commits, size_t *nr,
+				      size_t *alloc, struct commit *c)
+{
+	ALLOC_GROW(*commits, *nr + 1, *alloc);
+	(*commits)[*nr] = c;
+	return (*nr)++;
+}
+
+/*
+ * Resolve the upstream or push branch of a local branch to an index
+ * into 'commits', or return -1 when there is none.
+ */
+static ssize_t tracking_commit(struct ref_array_item *item, int push,
+			       struct string_list *seen, struct commit ***commits,
+			       size_t *nr, size_t *alloc)
+{
+	const char *branch_name, *base;
+	struct string_list_item *entry;
+	struct branch *branch;
+	struct object_id oid;
+	struct commit *c;
+
+	if (!skip_prefix(item->refname, "refs/heads/", &branch_name))
+		return -1;
+	branch = branch_get(branch_name);
+	base = push ? branch_get_push(branch, NULL) :
+		branch_get_upstream(branch, NULL);
+	if (!base)
+		return -1;
+
+	entry = string_list_insert(seen, base);
+	if (!entry->util) {
+		if (read_ref(base, &oid) ||
+		    !(c = lookup_commit_reference(the_repository, &oid)))
+			entry->util = (void *)(intptr_t)-1;
+		else
+			entry->util = (void *)(intptr_t)
+				add_ahead_behind_commit(commits, nr, alloc, c);
+	}
+	return (intptr_t)entry->util;
+}
+
+void filter_ahead_behind(struct repository *r, struct ref_array *array)
+{
+	struct commit **commits = NULL;
+	size_t commits_nr = 0, commits_alloc = 0, counts_nr = 0;
+	struct string_list seen[2] = { STRING_LIST_INIT_DUP, STRING_LIST_INIT_DUP };
+	struct ahead_behind_count *counts;
+	ssize_t *tips;
+	int i, j, wanted = 0;
+
+	for (i = 0; i < used_atom_cnt; i++) {
+		const char *base;
+		int push;
+
+		wanted += want_ahead_behind(&used_atom[i], &base, &push);
+	}
+	if (!wanted || !array->nr)
+		return;
+
+	/*
+	 * Without generation numbers, ahead_behind() has to compute them
+	 * down to the root commits, while the walks for each ref stop at
+	 * their merge bases.
+	 */
+	if (!generation_numbers_enabled(r))
+		return;
+
+	ALLOC_ARRAY(tips, array->nr);
+	for (i = 0; i < array->nr; i++) {
+		struct commit *c =
+			lookup_commit_reference_gently(r, &array->items[i]->objectname, 1);
+		tips[i] = c ? add_ahead_behind_commit(&commits, &commits_nr,
+						      &commits_alloc, c) : -1;
+		CALLOC_ARRAY(array->items[i]->counts, used_atom_cnt);
+	}
+
+	/* at most one pair per ref and atom, so that counts never moves */
+	CALLOC_ARRAY(counts, st_mult(array->nr, wanted));
+
+	for (i = 0; i < used_atom_cnt; i++) {
+		const char *base_name;
+		ssize_t base = -1;
+		int push = 0;
+
+		if (!want_ahead_behind(&used_atom[i], &base_name, &push))
+			continue;
+		if (base_name) {
+			struct commit *c = lookup_commit_reference_by_name(base_name);
+			if (!c)
+				die(_("failed to find '%s'"), base_name);
+			base = add_ahead_behind_commit(&commits, &commits_nr,
+						       &commits_alloc, c);
+		}
+
+		for (j = 0; j < array->nr; j++) {
+			struct ref_array_item *item = array->items[j];
+			ssize_t item_base = base;
+
+			if (tips[j] < 0)
+				continue;
+			if (!base_name) {
+				item_base = tracking_commit(item, push, &seen[push],
+							    &commits, &commits_nr,
+							    &commits_alloc);
+				if (item_base < 0)
+					continue;
+			}
+			counts[counts_nr].tip_index = tips[j];
+			counts[counts_nr].base_index = item_base;
+			item->counts[i] = &counts[counts_nr++];
+		}
+	}
+
+	ahead_behind(r, commits, commits_nr, counts, counts_nr);
+
+	array->counts = counts;
+	string_list_clear(&seen[0], 0);
+	string_list_clear(&seen[1], 0);
+	free(tips);
+	free(commits);
+}
+
 static int cmp_ref_sorting(struct ref_sorting *s, struct ref_array_item *a, struct ref_array_item *b)
 {
 	struct atom_value *va, *vb;
@@ -24,6 +24,7 @@
 #define FILTER_REFS_KIND_MASK      (FILTER_REFS_ALL | FILTER_REFS_DETACHED_HEAD)
 
 struct atom_value;
+struct ahead_behind_count;
 
 struct ref_sorting {
 	struct ref_sorting *next;
@@ -40,6 +41,8 @@ struct ref_array_item {
 	const char *symref;
 	struct commit *commit;
 	struct atom_value *value;
+	/* filled by filter_ahead_behind(), indexed like the atoms */
+	struct ahead_behind_count **counts;
 	char refname[FLEX_ARRAY];
 };
 
@@ -47,6 +50,7 @@ struct ref_array {
 	int nr, alloc;
 	struct ref_array_item **items;
 	struct rev_info *revs;
+	struct ahead_behind_count *counts;
 };
 
 struct ref_filter {
@@ -105,6 +109,14 @@ struct ref_format {
 int filter_refs(struct ref_array *array, struct ref_filter *filter, unsigned int type);
 /*  Clear all memory allocated to ref_array */
 void ref_array_clear(struct ref_array *array);
+/*
+ * Compute the values of the %(ahead-behind:<base>), %(upstream:track)
+ * and %(push:track) atoms of all the refs in the array with a single
+ * walk. Call after filter_refs() and verify_ref_format(); without it,
+ * or when the repository has no generation numbers, the atoms are
+ * computed for each ref on its own.
+ */
+void filter_ahead_behind(struct repository *r, struct ref_array *array);
 /*  Used to verify if the given format is correct and to parse out the used atoms */
 int verify_ref_format(struct ref_format *format);
 /*  Sort the given ref_array as per the ref_sorting provided */
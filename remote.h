@@ -191,6 +191,19 @@ struct ref **get_remote_refs(int fd_out, struct packet_reader *reader,
 			     const struct string_list *server_options,
 			     int stateless_rpc);
 
+/*
+ * Used for protocol v2 in order to ask a remote for the size and type of
+ * objects without fetching them. Returns -1 if the server does not
+ * support the "object-info" command. Otherwise, fills in sizes[i] and
+ * types[i] for each oids->oid[i], with OBJ_BAD for an object the server
+ * does not have, and returns 0.
+ */
+int get_remote_object_info(int fd_out, struct packet_reader *reader,
+			   const struct oid_array *oids,
+			   unsigned long *sizes, enum object_type *types,
+			   const struct string_list *server_options,
+			   int stateless_rpc);
+
 int resolve_remote_symref(struct ref *ref, struct ref *list);
 
 /*
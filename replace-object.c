@@ -45,7 +45,8 @@ void prepare_replace_object(struct repository *r)
 
 	r->objects->replace_map =
 		xmalloc(sizeof(*r->objects->replace_map));
-	oidmap_init(r->objects->replace_map, 0);
+	/* nearly all lookups are for objects that are not replaced */
+	oidmap_init_open(r->objects->replace_map, 0);
 
 	for_each_replace_ref(r, register_replace_ref, NULL);
 	r->objects->replace_map_initialized = 1;
@@ -41,6 +41,7 @@ struct repo_settings {
 	enum fetch_negotiation_setting fetch_negotiation_algorithm;
 
 	int core_multi_pack_index;
+	int core_depth_cache;
 };
 
 struct repository {
@@ -31,6 +31,7 @@
 #include "utf8.h"
 #include "bloom.h"
 #include "json-writer.h"
+#include "depth-cache.h"
 
 volatile show_early_output_fn_t show_early_output;
 
@@ -398,6 +399,15 @@ void add_pending_oid(struct rev_info *revs, const char *name,
 	add_pending_object(revs, object, name);
 }
 
+/*
+ * Whether "--topo-order" can be produced incrementally, without sorting
+ * the whole history in limit_list() first.
+ */
+static int can_stream_topo_order(struct repository *r)
+{
+	return generation_numbers_enabled(r) || depth_cache_enabled(r);
+}
+
 static struct commit *handle_commit(struct rev_info *revs,
 				    struct object_array_entry *entry)
 {
@@ -445,7 +455,7 @@ static struct commit *handle_commit(struct rev_info *revs,
 		if (flags & UNINTERESTING) {
 			mark_parents_uninteresting(commit);
 
-			if (!revs->topo_order || !generation_numbers_enabled(the_repository))
+			if (!revs->topo_order || !can_stream_topo_order(revs->repo))
 				revs->limited = 1;
 		}
 		if (revs->sources) {
@@ -2861,7 +2871,7 @@ int setup_revisions(int argc, const char **argv, struct rev_info *revs, struct s
 		revs->topo_order = 1;
 	}
 
-	if (revs->topo_order && !generation_numbers_enabled(the_repository))
+	if (revs->topo_order && !can_stream_topo_order(revs->repo))
 		revs->limited = 1;
 
 	if (revs->prune_data.nr) {
@@ -3309,6 +3319,7 @@ define_commit_slab(author_date_slab, timestamp_t);
 
 struct topo_walk_info {
 	uint32_t min_generation;
+	struct depth_cache *depths;
 	struct prio_queue explore_queue;
 	struct prio_queue indegree_queue;
 	struct prio_queue topo_queue;
@@ -3316,6 +3327,36 @@ struct topo_walk_info {
 	struct author_date_slab author_date;
 };
 
+/*
+ * The generation of a commit for the topo-order walk: the one from the
+ * commit-graph, or the depth from the depth cache if generation numbers
+ * are not available.
+ */
+static uint32_t topo_generation(struct topo_walk_info *info, struct commit *c)
+{
+	if (info->depths)
+		return depth_cache_get(info->depths, c);
+	return commit_graph_generation(c);
+}
+
+static int compare_commits_by_depth_then_commit_date(const void *a_,
+						     const void *b_,
+						     void *cb_data)
+{
+	struct depth_cache *depths = cb_data;
+	const struct commit *a = a_, *b = b_;
+	uint32_t depth_a = depth_cache_get(depths, (struct commit *)a);
+	uint32_t depth_b = depth_cache_get(depths, (struct commit *)b);
+
+	/* newer commits first */
+	if (depth_a < depth_b)
+		return 1;
+	else if (depth_a > depth_b)
+		return -1;
+
+	return compare_commits_by_commit_date(a_, b_, NULL);
+}
+
 static inline void test_flag_and_insert(struct prio_queue *q, struct commit *c, int flag)
 {
 	if (c->object.flags & flag)
@@ -3359,7 +3400,7 @@ static void explore_to_depth(struct rev_info *revs,
 	struct topo_walk_info *info = revs->topo_walk_info;
 	struct commit *c;
 	while ((c = prio_queue_peek(&info->explore_queue)) &&
-	       commit_graph_generation(c) >= gen_cutoff)
+	       topo_generation(info, c) >= gen_cutoff)
 		explore_walk_step(revs);
 }
 
@@ -3375,7 +3416,7 @@ static void indegree_walk_step(struct rev_info *revs)
 	if (repo_parse_commit_gently(revs->repo, c, 1) < 0)
 		return;
 
-	explore_to_depth(revs, commit_graph_generation(c));
+	explore_to_depth(revs, topo_generation(info, c));
 
 	for (p = c->parents; p; p = p->next) {
 		struct commit *parent = p->item;
@@ -3399,7 +3440,7 @@ static void compute_indegrees_to_depth(struct rev_info *revs,
 	struct topo_walk_info *info = revs->topo_walk_info;
 	struct commit *c;
 	while ((c = prio_queue_peek(&info->indegree_queue)) &&
-	       commit_graph_generation(c) >= gen_cutoff)
+	       topo_generation(info, c) >= gen_cutoff)
 		indegree_walk_step(revs);
 }
 
@@ -3412,6 +3453,7 @@ static void reset_topo_walk(struct rev_info *revs)
 	clear_prio_queue(&info->topo_queue);
 	clear_indegree_slab(&info->indegree);
 	clear_author_date_slab(&info->author_date);
+	depth_cache_free(info->depths);
 
 	FREE_AND_NULL(revs->topo_walk_info);
 }
@@ -3446,8 +3488,17 @@ static void init_topo_walk(struct rev_info *revs)
 		break;
 	}
 
-	info->explore_queue.compare = compare_commits_by_gen_then_commit_date;
-	info->indegree_queue.compare = compare_commits_by_gen_then_commit_date;
+	if (!generation_numbers_enabled(revs->repo))
+		info->depths = depth_cache_open(revs->repo);
+	if (info->depths) {
+		info->explore_queue.compare = compare_commits_by_depth_then_commit_date;
+		info->explore_queue.cb_data = info->depths;
+		info->indegree_queue.compare = compare_commits_by_depth_then_commit_date;
+		info->indegree_queue.cb_data = info->depths;
+	} else {
+		info->explore_queue.compare = compare_commits_by_gen_then_commit_date;
+		info->indegree_queue.compare = compare_commits_by_gen_then_commit_date;
+	}
 
 	info->min_generation = GENERATION_NUMBER_INFINITY;
 	for (list = revs->commits; list; list = list->next) {
@@ -3460,7 +3511,7 @@ static void init_topo_walk(struct rev_info *revs)
 		test_flag_and_insert(&info->explore_queue, c, TOPO_WALK_EXPLORED);
 		test_flag_and_insert(&info->indegree_queue, c, TOPO_WALK_INDEGREE);
 
-		generation = commit_graph_generation(c);
+		generation = topo_generation(info, c);
 		if (generation < info->min_generation)
 			info->min_generation = generation;
 
@@ -3469,6 +3520,12 @@ static void init_topo_walk(struct rev_info *revs)
 		if (revs->sort_order == REV_SORT_BY_AUTHOR_DATE)
 			record_author_date(&info->author_date, c);
 	}
+	/*
+	 * The depths of all the commits the walk can reach are known
+	 * now; store any that were missing for the next walk.
+	 */
+	if (info->depths)
+		depth_cache_write(info->depths);
 	compute_indegrees_to_depth(revs, info->min_generation);
 
 	for (list = revs->commits; list; list = list->next) {
@@ -3521,7 +3578,7 @@ static void expand_topo_walk(struct rev_info *revs, struct commit *commit)
 		if (repo_parse_commit_gently(revs->repo, parent, 1) < 0)
 			continue;
 
-		generation = commit_graph_generation(parent);
+		generation = topo_generation(info, parent);
 		if (generation < info->min_generation) {
 			info->min_generation = generation;
 			compute_indegrees_to_depth(revs, info->min_generation);
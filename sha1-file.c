@@ -1275,6 +1275,7 @@ static int stat_loose_object(struct repository *r, const struct object_id *oid,
 	struct object_directory *odb;
 	static struct strbuf buf = STRBUF_INIT;
 
+	trace2_counter_add(TRACE2_COUNTER_ID_LOOSE_OBJECT_LOOKUP, 1);
 	prepare_alt_odb(r);
 	for (odb = r->objects->odb; odb; odb = odb->next) {
 		*path = odb_loose_path(odb, &buf, oid);
@@ -1297,6 +1298,7 @@ static int open_loose_object(struct repository *r,
 	int most_interesting_errno = ENOENT;
 	static struct strbuf buf = STRBUF_INIT;
 
+	trace2_counter_add(TRACE2_COUNTER_ID_LOOSE_OBJECT_LOOKUP, 1);
 	prepare_alt_odb(r);
 	for (odb = r->objects->odb; odb; odb = odb->next) {
 		*path = odb_loose_path(odb, &buf, oid);
@@ -1316,6 +1318,7 @@ static int quick_has_loose(struct repository *r,
 {
 	struct object_directory *odb;
 
+	trace2_counter_add(TRACE2_COUNTER_ID_LOOSE_OBJECT_LOOKUP, 1);
 	prepare_alt_odb(r);
 	for (odb = r->objects->odb; odb; odb = odb->next) {
 		if (oid_array_lookup(odb_loose_cache(odb, oid), oid) >= 0)
@@ -1666,6 +1669,16 @@ void disable_obj_read_lock(void)
 
 int fetch_if_missing = 1;
 
+/*
+ * Whether "oi" asks for nothing but the type and size of an object, which a
+ * promisor remote may be able to tell us without sending the object.
+ */
+static int object_info_wants_metadata_only(const struct object_info *oi)
+{
+	return (oi->typep || oi->sizep || oi->type_name) &&
+		!oi->contentp && !oi->disk_sizep && !oi->delta_base_oid;
+}
+
 static int do_oid_object_info_extended(struct repository *r,
 				       const struct object_id *oid,
 				       struct object_info *oi, unsigned flags)
@@ -1762,6 +1775,23 @@ static int do_oid_object_info_extended(struct repository *r,
 		if (fetch_if_missing && has_promisor_remote() &&
 		    !already_retried && r == the_repository &&
 		    !(flags & OBJECT_INFO_SKIP_FETCH_OBJECT)) {
+			enum object_type type;
+			unsigned long size;
+
+			if (object_info_wants_metadata_only(oi) &&
+			    !promisor_remote_get_object_info(r, real,
+							     &type, &size)) {
+				if (oi->typep)
+					*(oi->typep) = type;
+				if (oi->sizep)
+					*(oi->sizep) = size;
+				if (oi->type_name)
+					strbuf_addstr(oi->type_name,
+						      type_name(type));
+				oi->whence = OI_REMOTE;
+				return 0;
+			}
+
 			/*
 			 * TODO Investigate checking promisor_remote_get_direct()
 			 * TODO return value and stopping on error here.
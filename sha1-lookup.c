@@ -100,6 +100,73 @@ int sha1_pos(const unsigned char *hash, void *table, size_t nr,
 	return index_pos_to_insert_pos(lo);
 }
 
+/*
+ * The 32 bits of a hash that follow the first byte, which the fanout
+ * table has already used up.
+ */
+static inline uint64_t hash_prefix_after_fanout(const unsigned char *hash)
+{
+	return get_be32(hash + 1);
+}
+
+/*
+ * Narrow down the interval [*lo, *hi) of a large table to fewer than
+ * BSEARCH_HASH_INTERPOLATE_MIN entries. Return 1 and set *lo to the
+ * position of sha1 if it happens to be found on the way.
+ *
+ * Hashes are uniformly distributed, so instead of bisecting, we guess
+ * where the target is from how far its prefix lies between the prefixes
+ * at both ends of the interval. That takes about log(log(n)) probes
+ * instead of log(n), and each probe is a potential cache miss on a large
+ * index. Unlucky guesses that do not halve the interval are followed by
+ * a bisection, so that we never need more than about twice as many
+ * probes as the binary search.
+ */
+#define BSEARCH_HASH_INTERPOLATE_MIN 64
+
+static int interpolate_hash(const unsigned char *sha1,
+			    const unsigned char *table, size_t stride,
+			    uint32_t *lo_p, uint32_t *hi_p)
+{
+	uint32_t lo = *lo_p, hi = *hi_p;
+	/* the prefixes of all entries in [lo, hi) are within [lov, hiv] */
+	uint64_t lov = 0, hiv = 0xffffffff;
+	uint64_t miv = hash_prefix_after_fanout(sha1);
+	int bisect = 0, found = 0;
+
+	while (hi - lo >= BSEARCH_HASH_INTERPOLATE_MIN) {
+		uint32_t nr = hi - lo;
+		uint32_t mi;
+		const unsigned char *entry;
+		int cmp;
+
+		if (bisect || miv < lov || hiv < miv)
+			mi = lo + nr / 2;
+		else
+			mi = lo + nr * (miv - lov) / (hiv - lov + 1);
+
+		entry = table + (size_t)mi * stride;
+		cmp = hashcmp(entry, sha1);
+		if (!cmp) {
+			lo = mi;
+			found = 1;
+			break;
+		}
+		if (cmp > 0) {
+			hi = mi;
+			hiv = hash_prefix_after_fanout(entry);
+		} else {
+			lo = mi + 1;
+			lov = hash_prefix_after_fanout(entry);
+		}
+		bisect = !bisect && hi - lo > nr / 2;
+	}
+
+	*lo_p = lo;
+	*hi_p = hi;
+	return found;
+}
+
 int bsearch_hash(const unsigned char *sha1, const uint32_t *fanout_nbo,
 		 const unsigned char *table, size_t stride, uint32_t *result)
 {
@@ -108,6 +175,13 @@ int bsearch_hash(const unsigned char *sha1, const uint32_t *fanout_nbo,
 	hi = ntohl(fanout_nbo[*sha1]);
 	lo = ((*sha1 == 0x0) ? 0 : ntohl(fanout_nbo[*sha1 - 1]));
 
+	if (hi - lo >= BSEARCH_HASH_INTERPOLATE_MIN &&
+	    interpolate_hash(sha1, table, stride, &lo, &hi)) {
+		if (result)
+			*result = lo;
+		return 1;
+	}
+
 	while (lo < hi) {
 		unsigned mi = lo + (hi - lo) / 2;
 		int cmp = hashcmp(table + mi * stride, sha1);
@@ -10,7 +10,8 @@ int sha1_pos(const unsigned char *sha1,
 
 /*
  * Searches for sha1 in table, using the given fanout table to determine the
- * interval to search, then using binary search. Returns 1 if found, 0 if not.
+ * interval to search, then using interpolation and binary search. Returns 1
+ * if found, 0 if not.
  *
  * Takes the following parameters:
  *
@@ -2,6 +2,7 @@
 #include "git-compat-util.h"
 #include "hashmap.h"
 #include "strbuf.h"
+#include "trace.h"
 
 struct test_entry
 {
@@ -53,6 +54,7 @@ static struct test_entry *alloc_test_entry(unsigned int hash,
 #define HASH_METHOD_X2 4
 #define TEST_SPARSE 8
 #define TEST_ADD 16
+#define TEST_OPEN 32
 #define TEST_SIZE 100000
 
 static unsigned int hash(unsigned int method, unsigned int i, const char *key)
@@ -79,6 +81,40 @@ static unsigned int hash(unsigned int method, unsigned int i, const char *key)
 	return hash;
 }
 
+static void init_test_map(struct hashmap *map, int open, const void *cmp_data)
+{
+	if (open)
+		hashmap_init_open(map, test_entry_cmp, cmp_data, 0);
+	else
+		hashmap_init(map, test_entry_cmp, cmp_data, 0);
+}
+
+static void alloc_test_entries(unsigned int method,
+			       struct test_entry ***entries,
+			       unsigned int **hashes)
+{
+	char buf[16];
+	unsigned int i;
+
+	ALLOC_ARRAY(*entries, TEST_SIZE);
+	ALLOC_ARRAY(*hashes, TEST_SIZE);
+	for (i = 0; i < TEST_SIZE; i++) {
+		xsnprintf(buf, sizeof(buf), "%i", i);
+		(*entries)[i] = alloc_test_entry(0, buf, "");
+		(*hashes)[i] = hash(method, i, (*entries)[i]->key);
+	}
+}
+
+static void free_test_entries(struct test_entry **entries, unsigned int *hashes)
+{
+	unsigned int i;
+
+	for (i = 0; i < TEST_SIZE; i++)
+		free(entries[i]);
+	free(entries);
+	free(hashes);
+}
+
 /*
  * Test performance of hashmap.[ch]
  * Usage: time echo "perfhashmap method rounds" | test-tool hashmap
@@ -86,23 +122,16 @@ static unsigned int hash(unsigned int method, unsigned int i, const char *key)
 static void perf_hashmap(unsigned int method, unsigned int rounds)
 {
 	struct hashmap map;
-	char buf[16];
 	struct test_entry **entries;
 	unsigned int *hashes;
 	unsigned int i, j;
 
-	ALLOC_ARRAY(entries, TEST_SIZE);
-	ALLOC_ARRAY(hashes, TEST_SIZE);
-	for (i = 0; i < TEST_SIZE; i++) {
-		xsnprintf(buf, sizeof(buf), "%i", i);
-		entries[i] = alloc_test_entry(0, buf, "");
-		hashes[i] = hash(method, i, entries[i]->key);
-	}
+	alloc_test_entries(method, &entries, &hashes);
 
 	if (method & TEST_ADD) {
 		/* test adding to the map */
 		for (j = 0; j < rounds; j++) {
-			hashmap_init(&map, test_entry_cmp, NULL, 0);
+			init_test_map(&map, method & TEST_OPEN, NULL);
 
 			/* add entries */
 			for (i = 0; i < TEST_SIZE; i++) {
@@ -114,7 +143,7 @@ static void perf_hashmap(unsigned int method, unsigned int rounds)
 		}
 	} else {
 		/* test map lookups */
-		hashmap_init(&map, test_entry_cmp, NULL, 0);
+		init_test_map(&map, method & TEST_OPEN, NULL);
 
 		/* fill the map (sparsely if specified) */
 		j = (method & TEST_SPARSE) ? TEST_SIZE / 10 : TEST_SIZE;
@@ -132,6 +161,66 @@ static void perf_hashmap(unsigned int method, unsigned int rounds)
 
 		hashmap_free(&map);
 	}
+
+	free_test_entries(entries, hashes);
+}
+
+/*
+ * Compare chained and open-addressing maps: print the time per insert
+ * and per lookup, and the size of the table once all entries are added
+ * (the entries themselves are the same for both).
+ * Usage: echo "comparehashmap method rounds" | test-tool hashmap
+ */
+static void compare_hashmap(unsigned int method, unsigned int rounds)
+{
+	struct test_entry **entries;
+	unsigned int *hashes;
+	int open;
+
+	alloc_test_entries(method, &entries, &hashes);
+
+	for (open = 0; open <= 1; open++) {
+		struct hashmap map;
+		uint64_t start, add_ns = 0, get_ns;
+		size_t table_bytes = 0;
+		unsigned int i, j, n;
+
+		n = (method & TEST_SPARSE) ? TEST_SIZE / 10 : TEST_SIZE;
+		for (j = 0; j < rounds; j++) {
+			init_test_map(&map, open, NULL);
+			start = getnanotime();
+			for (i = 0; i < n; i++) {
+				hashmap_entry_init(&entries[i]->ent, hashes[i]);
+				hashmap_add(&map, &entries[i]->ent);
+			}
+			add_ns += getnanotime() - start;
+
+			if (map.groups)
+				table_bytes = st_mult(map.tablesize / 8,
+						      sizeof(struct hashmap_group));
+			else
+				table_bytes = st_mult(map.tablesize,
+						      sizeof(struct hashmap_entry *));
+			if (j + 1 < rounds)
+				hashmap_free(&map);
+		}
+
+		start = getnanotime();
+		for (j = 0; j < rounds; j++)
+			for (i = 0; i < TEST_SIZE; i++)
+				hashmap_get_from_hash(&map, hashes[i],
+						      entries[i]->key);
+		get_ns = getnanotime() - start;
+		hashmap_free(&map);
+
+		printf("%s add %.1f ns get %.1f ns table %"PRIuMAX" bytes\n",
+		       open ? "open" : "chained",
+		       (double)add_ns / ((uint64_t)rounds * n),
+		       (double)get_ns / ((uint64_t)rounds * TEST_SIZE),
+		       (uintmax_t)table_bytes);
+	}
+
+	free_test_entries(entries, hashes);
 }
 
 #define DELIM " \t\r\n"
@@ -147,16 +236,26 @@ static void perf_hashmap(unsigned int method, unsigned int rounds)
  * size -> tablesize numentries
  *
  * perfhashmap method rounds -> test hashmap.[ch] performance
+ * comparehashmap method rounds -> compare chained and open-addressing maps
+ *
+ * Options "ignorecase" and "open" select the kind of map the commands
+ * operate on.
  */
 int cmd__hashmap(int argc, const char **argv)
 {
 	struct strbuf line = STRBUF_INIT;
 	struct hashmap map;
-	int icase;
+	int icase = 0, open = 0, i;
+
+	for (i = 1; i < argc; i++) {
+		if (!strcmp("ignorecase", argv[i]))
+			icase = 1;
+		else if (!strcmp("open", argv[i]))
+			open = 1;
+	}
 
 	/* init hash map */
-	icase = argc > 1 && !strcmp("ignorecase", argv[1]);
-	hashmap_init(&map, test_entry_cmp, &icase, 0);
+	init_test_map(&map, open, &icase);
 
 	/* process commands from stdin */
 	while (strbuf_getline(&line, stdin) != EOF) {
@@ -254,6 +353,10 @@ int cmd__hashmap(int argc, const char **argv)
 
 			perf_hashmap(atoi(p1), atoi(p2));
 
+		} else if (!strcmp("comparehashmap", cmd) && p1 && p2) {
+
+			compare_hashmap(atoi(p1), atoi(p2));
+
 		} else {
 
 			printf("Unknown command %s\n", cmd);
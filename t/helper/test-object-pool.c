@@ -0,0 +1,156 @@
+#include "test-tool.h"
+#include "cache.h"
+#include "blob.h"
+#include "commit.h"
+#include "object.h"
+#include "repository.h"
+#include "tag.h"
+#include "thread-utils.h"
+#include "tree.h"
+
+struct input {
+	enum object_type type;
+	struct object_id oid;
+};
+
+struct thread_data {
+	pthread_t thread;
+	int nr;
+	struct input *input;
+	int input_nr;
+	struct object **found;
+};
+
+static struct object *lookup_typed(struct input *in)
+{
+	switch (in->type) {
+	case OBJ_COMMIT:
+		return &lookup_commit(the_repository, &in->oid)->object;
+	case OBJ_TREE:
+		return &lookup_tree(the_repository, &in->oid)->object;
+	case OBJ_BLOB:
+		return &lookup_blob(the_repository, &in->oid)->object;
+	case OBJ_TAG:
+		return &lookup_tag(the_repository, &in->oid)->object;
+	default:
+		BUG("unexpected type %d", in->type);
+	}
+}
+
+/*
+ * Every thread looks up every object, each starting at a different
+ * place in the input, so that they race to create the same objects.
+ */
+static void *lookup_all(void *data)
+{
+	struct thread_data *td = data;
+	int i;
+
+	for (i = 0; i < td->input_nr; i++) {
+		int j = (i + td->nr * td->input_nr / 7) % td->input_nr;
+
+		td->found[j] = lookup_typed(&td->input[j]);
+		if (lookup_object(the_repository, &td->input[j].oid) != td->found[j])
+			die("object %s was not found again",
+			    oid_to_hex(&td->input[j].oid));
+	}
+	return NULL;
+}
+
+static int compare_commit_index(const void *a_, const void *b_)
+{
+	const struct commit *a = *(const struct commit **)a_;
+	const struct commit *b = *(const struct commit **)b_;
+
+	return a->index < b->index ? -1 : a->index > b->index;
+}
+
+/*
+ * Read "<type> <oid>" lines from stdin and look up all objects from
+ * several threads at once. Check that all threads got the same objects,
+ * that commits got distinct indices, and that the pool still works once
+ * the threads are disabled. Print the number of objects in the pool.
+ */
+static int object_pool_threads(int nr_threads)
+{
+	struct strbuf line = STRBUF_INIT;
+	struct input *input = NULL;
+	struct thread_data *td;
+	struct commit **commits;
+	int input_nr = 0, input_alloc = 0, commits_nr = 0;
+	unsigned int nr_objs = 0;
+	int i, t;
+
+	while (strbuf_getline(&line, stdin) != EOF) {
+		const char *p;
+		char *sp = strchr(line.buf, ' ');
+
+		if (!sp)
+			die("bad input line: %s", line.buf);
+		*sp = '\0';
+		ALLOC_GROW(input, input_nr + 1, input_alloc);
+		input[input_nr].type = type_from_string(line.buf);
+		if (parse_oid_hex(sp + 1, &input[input_nr].oid, &p) || *p)
+			die("bad input line: %s", line.buf);
+		input_nr++;
+	}
+	strbuf_release(&line);
+
+	parsed_object_pool_enable_threads(the_repository->parsed_objects);
+	CALLOC_ARRAY(td, nr_threads);
+	for (t = 0; t < nr_threads; t++) {
+		td[t].nr = t;
+		td[t].input = input;
+		td[t].input_nr = input_nr;
+		CALLOC_ARRAY(td[t].found, input_nr);
+		if (pthread_create(&td[t].thread, NULL, lookup_all, &td[t]))
+			die("unable to create thread");
+	}
+	for (t = 0; t < nr_threads; t++)
+		pthread_join(td[t].thread, NULL);
+	parsed_object_pool_disable_threads(the_repository->parsed_objects);
+
+	ALLOC_ARRAY(commits, input_nr);
+	for (i = 0; i < input_nr; i++) {
+		struct object *obj = td[0].found[i];
+
+		for (t = 1; t < nr_threads; t++)
+			if (td[t].found[i] != obj)
+				die("threads disagree on %s",
+				    oid_to_hex(&input[i].oid));
+		if (!obj || obj->type != input[i].type ||
+		    !oideq(&obj->oid, &input[i].oid))
+			die("wrong object for %s", oid_to_hex(&input[i].oid));
+		if (lookup_object(the_repository, &input[i].oid) != obj)
+			die("object %s is lost", oid_to_hex(&input[i].oid));
+		if (obj->type == OBJ_COMMIT)
+			commits[commits_nr++] = (struct commit *)obj;
+	}
+
+	QSORT(commits, commits_nr, compare_commit_index);
+	for (i = 1; i < commits_nr; i++)
+		if (commits[i - 1]->index == commits[i]->index)
+			die("commits share index %u", commits[i]->index);
+
+	for (i = 0; i < get_max_object_index(); i++)
+		if (get_indexed_object(i))
+			nr_objs++;
+	printf("%u\n", nr_objs);
+
+	for (t = 0; t < nr_threads; t++)
+		free(td[t].found);
+	free(td);
+	free(commits);
+	free(input);
+	return 0;
+}
+
+int cmd__object_pool(int argc, const char **argv)
+{
+	if (argc == 3 && !strcmp(argv[1], "threads")) {
+		setup_git_directory();
+		return object_pool_threads(atoi(argv[2]));
+	}
+
+	die("usage: test-tool object-pool threads <n>");
+}
@@ -1,6 +1,7 @@
 #include "test-tool.h"
 #include "cache.h"
 #include "oid-array.h"
+#include "sha1-lookup.h"
 
 static int print_oid(const struct object_id *oid, void *data)
 {
@@ -8,6 +9,34 @@ static int print_oid(const struct object_id *oid, void *data)
 	return 0;
 }
 
+static int cmp_oid(const void *a, const void *b)
+{
+	return oidcmp(a, b);
+}
+
+/* Look up oid with bsearch_hash(), answering like oid_array_lookup(). */
+static int bsearch_hash_array(struct oid_array *array,
+			      const struct object_id *oid)
+{
+	uint32_t fanout[256];
+	uint32_t pos;
+	size_t nr = 0;
+	int i;
+
+	QSORT(array->oid, array->nr, cmp_oid);
+	array->sorted = 1;
+	for (i = 0; i < 256; i++) {
+		while (nr < array->nr && array->oid[nr].hash[0] <= i)
+			nr++;
+		fanout[i] = htonl(nr);
+	}
+
+	if (bsearch_hash(oid->hash, fanout, (const unsigned char *)array->oid,
+			 sizeof(*array->oid), &pos))
+		return pos;
+	return -1 - pos;
+}
+
 int cmd__oid_array(int argc, const char **argv)
 {
 	struct oid_array array = OID_ARRAY_INIT;
@@ -28,6 +57,10 @@ int cmd__oid_array(int argc, const char **argv)
 			if (get_oid_hex(arg, &oid))
 				die("not a hexadecimal oid: %s", arg);
 			printf("%d\n", oid_array_lookup(&array, &oid));
+		} else if (skip_prefix(line.buf, "bsearch_hash ", &arg)) {
+			if (get_oid_hex(arg, &oid))
+				die("not a hexadecimal oid: %s", arg);
+			printf("%d\n", bsearch_hash_array(&array, &oid));
 		} else if (!strcmp(line.buf, "clear"))
 			oid_array_clear(&array);
 		else if (!strcmp(line.buf, "for_each_unique"))
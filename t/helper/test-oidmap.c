@@ -1,7 +1,9 @@
 #include "test-tool.h"
 #include "cache.h"
+#include "object-store.h"
 #include "oidmap.h"
 #include "strbuf.h"
+#include "trace.h"
 
 /* key is an oid and value is a name (could be a refname for example) */
 struct test_entry {
@@ -11,6 +13,80 @@ struct test_entry {
 
 #define DELIM " \t\r\n"
 
+/*
+ * Compare oidmaps using chained and open-addressing hashmaps: print the
+ * time per insert, per lookup of an existing and of a missing oid, and
+ * the size of the table once all entries are added.
+ */
+static void compare_oidmap(unsigned int nr, unsigned int rounds)
+{
+	struct oidmap_entry *entries;
+	struct object_id *missing;
+	unsigned int i, j;
+	int open;
+
+	ALLOC_ARRAY(entries, nr);
+	ALLOC_ARRAY(missing, nr);
+	for (i = 0; i < nr; i++) {
+		char buf[32];
+		int len = xsnprintf(buf, sizeof(buf), "%u", i);
+
+		hash_object_file(the_hash_algo, buf, len, "blob",
+				 &entries[i].oid);
+		hash_object_file(the_hash_algo, buf, len, "tree", &missing[i]);
+	}
+
+	for (open = 0; open <= 1; open++) {
+		struct oidmap map;
+		uint64_t start, add_ns = 0, get_ns, miss_ns;
+		size_t table_bytes;
+
+		for (j = 0; j < rounds; j++) {
+			if (open)
+				oidmap_init_open(&map, 0);
+			else
+				oidmap_init(&map, 0);
+			start = getnanotime();
+			for (i = 0; i < nr; i++)
+				oidmap_put(&map, &entries[i]);
+			add_ns += getnanotime() - start;
+			if (j + 1 < rounds)
+				oidmap_free(&map, 0);
+		}
+
+		if (map.map.groups)
+			table_bytes = st_mult(map.map.tablesize / 8,
+					      sizeof(struct hashmap_group));
+		else
+			table_bytes = st_mult(map.map.tablesize,
+					      sizeof(struct hashmap_entry *));
+
+		start = getnanotime();
+		for (j = 0; j < rounds; j++)
+			for (i = 0; i < nr; i++)
+				oidmap_get(&map, &entries[i].oid);
+		get_ns = getnanotime() - start;
+
+		start = getnanotime();
+		for (j = 0; j < rounds; j++)
+			for (i = 0; i < nr; i++)
+				oidmap_get(&map, &missing[i]);
+		miss_ns = getnanotime() - start;
+
+		oidmap_free(&map, 0);
+
+		printf("%s add %.1f ns get %.1f ns miss %.1f ns table %"PRIuMAX" bytes\n",
+		       open ? "open" : "chained",
+		       (double)add_ns / ((uint64_t)rounds * nr),
+		       (double)get_ns / ((uint64_t)rounds * nr),
+		       (double)miss_ns / ((uint64_t)rounds * nr),
+		       (uintmax_t)table_bytes);
+	}
+
+	free(entries);
+	free(missing);
+}
+
 /*
  * Read stdin line by line and print result of commands to stdout:
  *
@@ -19,7 +95,9 @@ struct test_entry {
  * get oidkey -> NULL / namevalue
  * remove oidkey -> NULL / old namevalue
  * iterate -> oidkey1 namevalue1\noidkey2 namevalue2\n...
+ * compareoidmap nr rounds -> compare chained and open-addressing maps
  *
+ * Option "open" makes the commands operate on an open-addressing map.
  */
 int cmd__oidmap(int argc, const char **argv)
 {
@@ -29,7 +107,10 @@ int cmd__oidmap(int argc, const char **argv)
 	setup_git_directory();
 
 	/* init oidmap */
-	oidmap_init(&map, 0);
+	if (argc > 1 && !strcmp("open", argv[1]))
+		oidmap_init_open(&map, 0);
+	else
+		oidmap_init(&map, 0);
 
 	/* process commands from stdin */
 	while (strbuf_getline(&line, stdin) != EOF) {
@@ -99,6 +180,10 @@ int cmd__oidmap(int argc, const char **argv)
 			while ((entry = oidmap_iter_next(&iter)))
 				printf("%s %s\n", oid_to_hex(&entry->entry.oid), entry->name);
 
+		} else if (!strcmp("compareoidmap", cmd) && p1 && p2) {
+
+			compare_oidmap(atoi(p1), atoi(p2));
+
 		} else {
 
 			printf("Unknown command %s\n", cmd);
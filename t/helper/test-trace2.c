@@ -4,6 +4,7 @@
 #include "run-command.h"
 #include "exec-cmd.h"
 #include "config.h"
+#include "thread-utils.h"
 
 typedef int(fn_unit_test)(int argc, const char **argv);
 
@@ -198,6 +199,172 @@ static int ut_006data(int argc, const char **argv)
 	return 0;
 }
 
+/*
+ * Run the stopwatch timer `tid` `count` times, sleeping `delay` ms in
+ * each interval, and run it nested inside itself once more.
+ */
+static void run_timer(enum trace2_timer_id tid, int count, int delay)
+{
+	int k;
+
+	for (k = 0; k < count; k++) {
+		trace2_timer_start(tid);
+		sleep_millisec(delay);
+		trace2_timer_stop(tid);
+	}
+
+	trace2_timer_start(tid);
+	trace2_timer_start(tid);
+	sleep_millisec(delay);
+	trace2_timer_stop(tid);
+	trace2_timer_stop(tid);
+}
+
+/*
+ * Use the "test1" timer, which only emits a process-wide "timer"
+ * event, <count> + 1 times.
+ */
+static int ut_100timer(int argc, const char **argv)
+{
+	const char *usage_error = "expect <count> <ms_delay>";
+	int count = 0;
+	int delay = 0;
+
+	if (argc != 2)
+		die("%s", usage_error);
+	if (get_i(&count, argv[0]))
+		die("%s", usage_error);
+	if (get_i(&delay, argv[1]))
+		die("%s", usage_error);
+
+	run_timer(TRACE2_TIMER_ID_TEST1, count, delay);
+	return 0;
+}
+
+struct ut_thread_data {
+	int count;
+	int delay;
+	uint64_t value;
+};
+
+static void *ut_101timer_thread_proc(void *_data)
+{
+	struct ut_thread_data *data = _data;
+
+	trace2_thread_start("ut_101");
+	run_timer(TRACE2_TIMER_ID_TEST2, data->count, data->delay);
+	trace2_thread_exit();
+	return NULL;
+}
+
+/*
+ * Use the "test2" timer, which also emits per-thread "th_timer" events,
+ * <count> + 1 times in each of <threads> threads.
+ */
+static int ut_101timer(int argc, const char **argv)
+{
+	const char *usage_error = "expect <count> <ms_delay> <threads>";
+	struct ut_thread_data data = { 0 };
+	int nr_threads = 0;
+	int k;
+	pthread_t *pids = NULL;
+
+	if (argc != 3)
+		die("%s", usage_error);
+	if (get_i(&data.count, argv[0]))
+		die("%s", usage_error);
+	if (get_i(&data.delay, argv[1]))
+		die("%s", usage_error);
+	if (get_i(&nr_threads, argv[2]) || nr_threads < 1)
+		die("%s", usage_error);
+
+	CALLOC_ARRAY(pids, nr_threads);
+
+	for (k = 0; k < nr_threads; k++) {
+		if (pthread_create(&pids[k], NULL, ut_101timer_thread_proc, &data))
+			die("failed to create thread[%d]", k);
+	}
+
+	for (k = 0; k < nr_threads; k++) {
+		if (pthread_join(pids[k], NULL))
+			die("failed to join thread[%d]", k);
+	}
+
+	free(pids);
+
+	return 0;
+}
+
+/*
+ * Add each of the values to the "test1" counter, which only emits a
+ * process-wide "counter" event.
+ */
+static int ut_200counter(int argc, const char **argv)
+{
+	const char *usage_error = "expect <v1> [<v2> [...]]";
+	int value;
+	int k;
+
+	if (argc < 1)
+		die("%s", usage_error);
+
+	for (k = 0; k < argc; k++) {
+		if (get_i(&value, argv[k]))
+			die("invalid value[%s] -- %s", argv[k], usage_error);
+		trace2_counter_add(TRACE2_COUNTER_ID_TEST1, value);
+	}
+
+	return 0;
+}
+
+static void *ut_201counter_thread_proc(void *_data)
+{
+	struct ut_thread_data *data = _data;
+
+	trace2_thread_start("ut_201");
+	trace2_counter_add(TRACE2_COUNTER_ID_TEST2, data->value);
+	trace2_thread_exit();
+	return NULL;
+}
+
+/*
+ * Add <value> to the "test2" counter, which also emits per-thread
+ * "th_counter" events, in each of <threads> threads.
+ */
+static int ut_201counter(int argc, const char **argv)
+{
+	const char *usage_error = "expect <value> <threads>";
+	struct ut_thread_data data = { 0 };
+	int value = 0;
+	int nr_threads = 0;
+	int k;
+	pthread_t *pids = NULL;
+
+	if (argc != 2)
+		die("%s", usage_error);
+	if (get_i(&value, argv[0]))
+		die("%s", usage_error);
+	if (get_i(&nr_threads, argv[1]) || nr_threads < 1)
+		die("%s", usage_error);
+	data.value = value;
+
+	CALLOC_ARRAY(pids, nr_threads);
+
+	for (k = 0; k < nr_threads; k++) {
+		if (pthread_create(&pids[k], NULL, ut_201counter_thread_proc, &data))
+			die("failed to create thread[%d]", k);
+	}
+
+	for (k = 0; k < nr_threads; k++) {
+		if (pthread_join(pids[k], NULL))
+			die("failed to join thread[%d]", k);
+	}
+
+	free(pids);
+
+	return 0;
+}
+
 /*
  * Usage:
  *     test-tool trace2 <ut_name_1> <ut_usage_1>
@@ -214,6 +381,12 @@ static struct unit_test ut_table[] = {
 	{ ut_004child,    "004child",  "[<child_command_line>]" },
 	{ ut_005exec,     "005exec",   "<git_command_args>" },
 	{ ut_006data,     "006data",   "[<category> <key> <value>]+" },
+
+	{ ut_100timer,    "100timer",  "<count> <ms_delay>" },
+	{ ut_101timer,    "101timer",  "<count> <ms_delay> <threads>" },
+
+	{ ut_200counter,  "200counter", "<v1> [<v2> [<v3> [...]]]" },
+	{ ut_201counter,  "201counter", "<value> <threads>" },
 };
 /* clang-format on */
 
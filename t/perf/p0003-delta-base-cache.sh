@@ -3,7 +3,10 @@
 test_description='Test operations that emphasize the delta base cache.
 
 We look at both "log --raw", which should put only trees into the delta cache,
-and "log -Sfoo --raw", which should look at both trees and blobs.
+and "log -Sfoo --raw", which should look at both trees and blobs. "log -p"
+with a smaller cache shows how well eviction works, "cat-file" how the cache
+copes with objects read in hash order, and "grep --threads" how it copes with
+several threads.
 
 Any effects will be emphasized if the test repository is fully packed (loose
 objects obviously do not use the delta base cache at all). It is also
@@ -28,4 +31,21 @@ test_perf 'log -S' '
 	git log --raw -Sfoo >/dev/null
 '
 
+# mixes large blob bases with small tree bases in a cache that is too
+# small for all of them, so which entries get evicted matters
+test_perf 'log -p (8MB cache)' '
+	git -c core.deltaBaseCacheLimit=8m log -p -1000 >/dev/null
+'
+
+# reads objects in hash order, jumping around between delta chains
+test_perf 'cat-file --batch-all-objects' '
+	git cat-file --batch-all-objects --batch >/dev/null
+'
+
+# several threads share the cache
+test_perf 'grep --threads=8 (8MB cache)' '
+	git -c core.deltaBaseCacheLimit=8m \
+		grep --threads=8 -e foo $(git rev-list -20 HEAD) >/dev/null
+'
+
 test_done
@@ -40,4 +40,35 @@ do
 	'
 done
 
+test_expect_success 'setup ignore-heavy tree' '
+	mkdir ignores &&
+	(
+		cd ignores &&
+		for i in $(test_seq 1 100)
+		do
+			mkdir dir$i &&
+			for j in $(test_seq 1 20)
+			do
+				>dir$i/file$j.c &&
+				>dir$i/file$j.o$j || return 1
+			done || return 1
+		done &&
+		for i in $(test_seq 1 2000)
+		do
+			echo "generated$i" &&
+			echo "*.o$i" &&
+			echo "/dir$i/build$i" || return 1
+		done >.gitignore &&
+		echo "gen*ted[0-9]/" >>.gitignore
+	)
+'
+
+test_perf 'status -uall with thousands of ignore patterns' '
+	git status --porcelain -uall ignores >/dev/null
+'
+
+test_perf 'clean -n with thousands of ignore patterns' '
+	git clean -n -d ignores >/dev/null
+'
+
 test_done
@@ -0,0 +1,79 @@
+#!/bin/sh
+
+test_description='Commit walk performance tests'
+. ./perf-lib.sh
+
+test_perf_large_repo
+
+test_expect_success 'setup' '
+	git rev-list --first-parent HEAD >commits &&
+	step=$(( $(wc -l <commits) / 50 + 1 )) &&
+	head_ref=$(git symbolic-ref HEAD) &&
+	awk "NR % $step == 0 { print \"create refs/heads/perf-ab/\" NR \" \" \$0 }" \
+		<commits >updates &&
+	git update-ref --stdin <updates &&
+	for branch in $(git for-each-ref --format="%(refname:lstrip=2)" refs/heads/perf-ab/)
+	do
+		git config branch.$branch.remote . &&
+		git config branch.$branch.merge $head_ref ||
+		return 1
+	done &&
+	git commit-graph write --reachable
+'
+
+test_perf 'ahead-behind counts: git for-each-ref' '
+	git for-each-ref --format="%(ahead-behind:HEAD)" refs/heads/perf-ab/
+'
+
+test_perf 'upstream:track: git for-each-ref' '
+	git for-each-ref --format="%(upstream:track)" refs/heads/perf-ab/
+'
+
+test_perf 'upstream:track: git branch -vv' '
+	git branch -vv --list "perf-ab/*"
+'
+
+test_perf 'upstream:track: git branch -vv (no commit-graph)' '
+	git -c core.commitGraph=false branch -vv --list "perf-ab/*"
+'
+
+test_perf 'ahead-behind counts: git for-each-ref (no commit-graph)' '
+	git -c core.commitGraph=false for-each-ref \
+		--format="%(ahead-behind:HEAD)" refs/heads/perf-ab/
+'
+
+test_perf 'contains: git branch --contains' '
+	git branch --contains HEAD~100 --list "perf-ab/*"
+'
+
+test_perf 'contains: git tag --contains' '
+	git tag --contains HEAD~100
+'
+
+test_perf 'merged: git branch --merged' '
+	git branch --merged HEAD~100 --list "perf-ab/*"
+'
+
+test_perf 'merged: git branch --no-merged' '
+	git branch --no-merged HEAD~100 --list "perf-ab/*"
+'
+
+test_perf 'merged: git branch --no-merged (no commit-graph)' '
+	git -c core.commitGraph=false branch --no-merged HEAD~100 --list "perf-ab/*"
+'
+
+test_perf 'first page of git log --graph (no commit-graph)' '
+	git -c core.commitGraph=false log --graph --oneline -50 >/dev/null
+'
+
+test_expect_success 'fill the depth cache' '
+	git -c core.commitGraph=false -c core.depthCache=true \
+		log --topo-order -1 >/dev/null
+'
+
+test_perf 'first page of git log --graph (depth cache)' '
+	git -c core.commitGraph=false -c core.depthCache=true \
+		log --graph --oneline -50 >/dev/null
+'
+
+test_done
@@ -26,4 +26,24 @@ test_perf 'log -p -3000 --patience' '
 	git log -p -3000 --patience >/dev/null
 '
 
+# A pair of large generated files with changes spread all over and a
+# big block moved around, where the default algorithm has to work on
+# one huge box.
+test_expect_success 'setup large files' '
+	test_seq 300000 | sed "s/\(.*[05]\)\$/}/" >large1 &&
+	sed -e "s/^\(.*\)77\$/changed \1/" \
+		-e "/^1234[0-9]/d" -e "/^2345[0-9]/a\\
+new" large1 >edited &&
+	sed "100000,160000d" edited >large2 &&
+	sed -n "100000,160000p" edited >>large2
+'
+
+for alg in myers patience histogram chunked
+do
+	test_perf "diff --no-index large files ($alg)" "
+		test_might_fail git diff --no-index --diff-algorithm=$alg \
+			large1 large2 >/dev/null
+	"
+done
+
 test_done
@@ -44,6 +44,26 @@ do
 	'
 done
 
+# A pack without deltas spends nearly all of its time in the first pass,
+# where the reader thread inflates objects and the workers hash them.
+test_expect_success 'repack without deltas' '
+	git pack-objects --all --window=0 --depth=0 nodelta </dev/null >nodelta.name &&
+	NODELTA_PACK=nodelta-$(cat nodelta.name).pack &&
+	export NODELTA_PACK
+'
+
+for t in $threads
+do
+	THREADS=$t
+	export THREADS
+	test_perf "index-pack (no deltas) $t threads" '
+		rm -rf repo.git &&
+		git init --bare repo.git &&
+		GIT_DIR=repo.git GIT_FORCE_THREADS=1 \
+		git index-pack --threads=$THREADS --stdin <$NODELTA_PACK
+	'
+done
+
 test_perf 'index-pack default number of threads' '
 	rm -rf repo.git &&
 	git init --bare repo.git &&
@@ -63,6 +63,11 @@ test_expect_success 'simplify reachability' '
 	git repack -ad
 '
 
+# Lookups in traversal order jump around the pack indexes.
+test_expect_success 'list objects' '
+	git rev-list --objects --all | cut -d" " -f1 >all-objects
+'
+
 for nr_packs in 1 50 1000
 do
 	test_expect_success "create $nr_packs-pack scenario" '
@@ -87,6 +92,22 @@ do
 		  --reflog --indexed-objects --delta-base-offset \
 		  --stdout </dev/null >/dev/null
 	'
+
+	test_perf "batch-check ($nr_packs)" '
+		git cat-file --batch-check="%(objectname)" <all-objects >/dev/null
+	'
+
+	test_expect_success "write midx ($nr_packs)" '
+		git multi-pack-index write
+	'
+
+	test_perf "batch-check with midx ($nr_packs)" '
+		git cat-file --batch-check="%(objectname)" <all-objects >/dev/null
+	'
+
+	test_expect_success "remove midx ($nr_packs)" '
+		rm -f .git/objects/pack/multi-pack-index
+	'
 done
 
 # Measure pack loading with 10,000 packs.
@@ -20,4 +20,8 @@ test_perf 'grep --cached, expensive regex' '
 	git grep --cached "^.* *some_nonexistent_string$" || :
 '
 
+test_perf 'grep 20 revisions, cheap regex' '
+	git grep some_nonexistent_string $(git rev-list -n 20 HEAD) || :
+'
+
 test_done
@@ -197,6 +197,14 @@ test_expect_success 'attribute test: read paths from stdin' '
 	test_cmp expect actual
 '
 
+test_expect_success 'attribute test: revisit directories from stdin' '
+	grep -v notest <expect-all >expect-one &&
+	sort -r expect-one >expect-two &&
+	cat expect-one expect-two >expect &&
+	sed -e "s/:.*//" <expect | git check-attr --stdin test >actual &&
+	test_cmp expect actual
+'
+
 test_expect_success 'attribute test: --all option' '
 	grep -v unspecified <expect-all | sort >specified-all &&
 	sed -e "s/:.*//" <expect-all | uniq >stdin-all &&
@@ -865,4 +865,54 @@ test_expect_success 'info/exclude trumps core.excludesfile' '
 	test_cmp expect actual
 '
 
+test_expect_success 'last match wins in a long list of literal patterns' '
+	mkdir -p long/dir long/name11 &&
+	for i in $(test_seq 1 40)
+	do
+		echo "name$i" &&
+		echo "*.ext$i" &&
+		echo "/dir/path$i" || return 1
+	done >long/.gitignore &&
+	cat >>long/.gitignore <<-\EOF &&
+	!name7
+	n*8
+	!*.ext9
+	!dir/path10
+	dir/path1*
+	name11/
+	!sub*
+	sub.ext12
+	EOF
+	cat >paths <<-\EOF &&
+	long/name1
+	long/dir/name7
+	long/name8
+	long/dir/x.ext9
+	long/x.ext1
+	long/dir/path10
+	long/dir/path11
+	long/dir/path2
+	long/path3
+	long/name11
+	long/sub.ext12
+	long/sub.ext13
+	long/untracked
+	EOF
+	cat >expect <<-\EOF &&
+	long/.gitignore:1:name1	long/name1
+	long/.gitignore:121:!name7	long/dir/name7
+	long/.gitignore:122:n*8	long/name8
+	long/.gitignore:123:!*.ext9	long/dir/x.ext9
+	long/.gitignore:2:*.ext1	long/x.ext1
+	long/.gitignore:125:dir/path1*	long/dir/path10
+	long/.gitignore:125:dir/path1*	long/dir/path11
+	long/.gitignore:6:/dir/path2	long/dir/path2
+	long/.gitignore:126:name11/	long/name11
+	long/.gitignore:128:sub.ext12	long/sub.ext12
+	long/.gitignore:127:!sub*	long/sub.ext13
+	EOF
+	git check-ignore -v --stdin <paths >actual &&
+	test_cmp expect actual
+'
+
 test_done
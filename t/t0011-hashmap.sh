@@ -242,6 +242,104 @@ test_expect_success 'grow / shrink' '
 
 '
 
+test_expect_success 'put, get and remove (open addressing)' '
+
+test_hashmap "put key1 value1
+put key2 value2
+put fooBarFrotz value3
+put key1 value4
+get key1
+get fooBarFrotz
+get notInMap
+remove key2
+remove key2
+get key2
+size" "NULL
+NULL
+NULL
+value1
+value4
+value3
+NULL
+value2
+NULL
+NULL
+64 2" open
+
+'
+
+test_expect_success 'add duplicates (open addressing)' '
+	test-tool hashmap open ignorecase >actual.raw <<-\EOF &&
+	add key1 value1
+	add Key1 value2
+	add fooBarFrotz value3
+	add KEY1 value4
+	get key1
+	EOF
+
+	cat >expect <<-\EOF &&
+	value1
+	value2
+	value4
+	EOF
+
+	sort <actual.raw >actual &&
+	test_cmp expect actual
+'
+
+test_expect_success 'iterate (open addressing)' '
+	for n in $(test_seq 100)
+	do
+		echo put key$n value$n &&
+		echo NULL >>expect.raw || return 1
+	done >in &&
+	for n in $(test_seq 50)
+	do
+		echo remove key$((2 * n)) &&
+		echo value$((2 * n)) >>expect.raw || return 1
+	done >>in &&
+	echo iterate >>in &&
+	for n in $(test_seq 50)
+	do
+		echo key$((2 * n - 1)) value$((2 * n - 1)) >>expect.raw || return 1
+	done &&
+	test-tool hashmap open <in >actual.raw &&
+	sort <expect.raw >expect &&
+	sort <actual.raw >actual &&
+	test_cmp expect actual
+'
+
+test_expect_success 'grow / shrink (open addressing)' '
+
+	rm -f in &&
+	rm -f expect &&
+	for n in $(test_seq 44)
+	do
+		echo put key$n value$n >> in &&
+		echo NULL >> expect
+	done &&
+	echo size >> in &&
+	echo 64 44 >> expect &&
+	echo put key45 value45 >> in &&
+	echo NULL >> expect &&
+	echo size >> in &&
+	echo 256 45 >> expect &&
+	for n in $(test_seq 10)
+	do
+		echo remove key$n >> in &&
+		echo value$n >> expect
+	done &&
+	echo size >> in &&
+	echo 256 35 >> expect &&
+	echo remove key35 >> in &&
+	echo value35 >> expect &&
+	echo size >> in &&
+	echo 64 34 >> expect &&
+	cat in | test-tool hashmap open > out &&
+	test_cmp expect out
+
+'
+
 test_expect_success 'string interning' '
 
 test_hashmap "intern value1
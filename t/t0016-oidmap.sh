@@ -107,4 +107,34 @@ test_expect_success 'iterate' '
 	test_cmp expect actual
 '
 
+test_expect_success 'put, get, remove and iterate (open addressing)' '
+	test-tool oidmap open >actual.raw <<-\EOF &&
+	put one 1
+	put two 2
+	put three 3
+	put two 4
+	get two
+	remove one
+	remove one
+	get one
+	iterate
+	EOF
+
+	sort >expect <<-EOF &&
+	NULL
+	NULL
+	NULL
+	2
+	4
+	1
+	NULL
+	NULL
+	$(git rev-parse two) 4
+	$(git rev-parse three) 3
+	EOF
+
+	sort <actual.raw >actual &&
+	test_cmp expect actual
+'
+
 test_done
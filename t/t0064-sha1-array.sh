@@ -96,4 +96,33 @@ test_expect_success 'lookup with single duplicate value' '
 	test "$n" -le 1
 '
 
+# Print "<cmd> <oid>" for n hashes that are uniformly distributed, or
+# clustered in a narrow range that defeats interpolation.
+gen_oids () {
+	perl -MDigest::SHA=sha256_hex -e '
+		my ($cmd, $n, $clustered, $len) = @ARGV;
+		for my $i (1..$n) {
+			my $hex = $clustered ?
+				sprintf("00000000%08x", $i * $i) . ("0" x ($len - 16)) :
+				substr(sha256_hex($i), 0, $len);
+			print "$cmd $hex\n";
+		}
+	' "$@" $(test_oid hexsz)
+}
+
+for dist in uniform clustered
+do
+	test_expect_success "bsearch_hash agrees with lookup ($dist)" '
+		clustered=$(test $dist = clustered && echo 1 || echo 0) &&
+		gen_oids append 20000 $clustered >input &&
+		gen_oids lookup 30000 $clustered >>input &&
+		sed -n "s/^lookup /bsearch_hash /p" input >input.bsearch &&
+		test-tool oid-array <input >expect &&
+		grep "^append" input >input2 &&
+		cat input.bsearch >>input2 &&
+		test-tool oid-array <input2 >actual &&
+		test_cmp expect actual
+	'
+done
+
 test_done
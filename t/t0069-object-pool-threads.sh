@@ -0,0 +1,29 @@
+#!/bin/sh
+
+test_description='looking up objects from several threads'
+. ./test-lib.sh
+
+test_expect_success 'setup' '
+	for i in $(test_seq 1 50)
+	do
+		mkdir -p dir$((i % 5)) &&
+		echo $i >dir$((i % 5))/file$i &&
+		git add . &&
+		test_tick &&
+		git commit -q -m "commit $i" &&
+		git tag -a -m "tag $i" tag$i || return 1
+	done &&
+	git cat-file --batch-all-objects \
+		--batch-check="%(objecttype) %(objectname)" >input
+'
+
+for threads in 1 2 8
+do
+	test_expect_success "all objects are created once ($threads threads)" '
+		echo $(wc -l <input) >expect &&
+		test-tool object-pool threads '$threads' <input >actual &&
+		test_cmp expect actual
+	'
+done
+
+test_done
@@ -171,4 +171,91 @@ test_expect_success 'using global config, perf stream, return code 0' '
 	test_cmp expect actual
 '
 
+# Exercise the stopwatch timers in a loop and confirm that we have
+# as many samples as expected.  We can use the "test1" and "test2"
+# timers, which are defined in tr2_tmr.c for testing purposes.  We
+# cannot test the actual elapsed times, so only check the counts.
+
+have_timer_event () {
+	thread=$1 event=$2 category=$3 name=$4 intervals=$5 file=$6 &&
+
+	pattern="d0|${thread}|${event}||_T_ABS_||${category}|name:${name} intervals:${intervals}" &&
+
+	grep "${pattern}" ${file}
+}
+
+test_expect_success 'stopwatch timer test/test1' '
+	test_when_finished "rm trace.perf actual" &&
+	test_config_global trace2.perfBrief 1 &&
+	test_config_global trace2.perfTarget "$(pwd)/trace.perf" &&
+
+	# Use the timer "test1" 5 times, plus once nested; emit the
+	# summary event only.
+	test-tool trace2 100timer 5 10 &&
+
+	perl "$TEST_DIRECTORY/t0211/scrub_perf.perl" <trace.perf >actual &&
+
+	have_timer_event "main" "timer" "test" "test1" 6 actual &&
+	! grep th_timer actual
+'
+
+test_expect_success PTHREADS 'stopwatch timer test/test2' '
+	test_when_finished "rm trace.perf actual" &&
+	test_config_global trace2.perfBrief 1 &&
+	test_config_global trace2.perfTarget "$(pwd)/trace.perf" &&
+
+	# Use the timer "test2" 5 times, plus once nested, in each of 3
+	# threads; emit per-thread and summary events.
+	test-tool trace2 101timer 5 10 3 &&
+
+	perl "$TEST_DIRECTORY/t0211/scrub_perf.perl" <trace.perf >actual &&
+
+	have_timer_event "th01:ut_101" "th_timer" "test" "test2" 6 actual &&
+	have_timer_event "th02:ut_101" "th_timer" "test" "test2" 6 actual &&
+	have_timer_event "th03:ut_101" "th_timer" "test" "test2" 6 actual &&
+	have_timer_event "main" "timer" "test" "test2" 18 actual
+'
+
+# Exercise the global counters and confirm that we get the expected
+# values.  We can use the "test1" and "test2" counters, which are
+# defined in tr2_ctr.c for testing purposes.
+
+have_counter_event () {
+	thread=$1 event=$2 category=$3 name=$4 value=$5 file=$6 &&
+
+	pattern="d0|${thread}|${event}||_T_ABS_||${category}|name:${name} value:${value}" &&
+
+	grep "${pattern}" ${file}
+}
+
+test_expect_success 'global counter test/test1' '
+	test_when_finished "rm trace.perf actual" &&
+	test_config_global trace2.perfBrief 1 &&
+	test_config_global trace2.perfTarget "$(pwd)/trace.perf" &&
+
+	# Use the counter "test1" and add n integers.
+	test-tool trace2 200counter 1 2 3 4 5 &&
+
+	perl "$TEST_DIRECTORY/t0211/scrub_perf.perl" <trace.perf >actual &&
+
+	have_counter_event "main" "counter" "test" "test1" 15 actual &&
+	! grep th_counter actual
+'
+
+test_expect_success PTHREADS 'global counter test/test2' '
+	test_when_finished "rm trace.perf actual" &&
+	test_config_global trace2.perfBrief 1 &&
+	test_config_global trace2.perfTarget "$(pwd)/trace.perf" &&
+
+	# Add 2 to the counter "test2" in each of 3 threads.
+	test-tool trace2 201counter 2 3 &&
+
+	perl "$TEST_DIRECTORY/t0211/scrub_perf.perl" <trace.perf >actual &&
+
+	have_counter_event "th01:ut_201" "th_counter" "test" "test2" 2 actual &&
+	have_counter_event "th02:ut_201" "th_counter" "test" "test2" 2 actual &&
+	have_counter_event "th03:ut_201" "th_counter" "test" "test2" 2 actual &&
+	have_counter_event "main" "counter" "test" "test2" 6 actual
+'
+
 test_done
@@ -302,6 +302,88 @@ test_expect_success JSON_PP 'using global config, event stream, error event' '
 	test_cmp expect actual
 '
 
+# Exercise the stopwatch timers and the global counters and confirm
+# that the event stream has the expected summaries.  We cannot test
+# the actual elapsed times, so only check the counts.
+
+have_timer_event () {
+	thread=$1 event=$2 category=$3 name=$4 intervals=$5 file=$6 &&
+
+	pattern="\"event\":\"${event}\",\"sid\":\"[^\"]*\",\"thread\":\"${thread}\"" &&
+	pattern="${pattern},.*\"category\":\"${category}\",\"name\":\"${name}\"" &&
+	pattern="${pattern},\"intervals\":${intervals}," &&
+
+	grep "${pattern}" ${file}
+}
+
+have_counter_event () {
+	thread=$1 event=$2 category=$3 name=$4 value=$5 file=$6 &&
+
+	pattern="\"event\":\"${event}\",\"sid\":\"[^\"]*\",\"thread\":\"${thread}\"" &&
+	pattern="${pattern},.*\"category\":\"${category}\",\"name\":\"${name}\"" &&
+	pattern="${pattern},\"count\":${value}}" &&
+
+	grep "${pattern}" ${file}
+}
+
+test_expect_success 'stopwatch timer test/test1' '
+	test_when_finished "rm trace.event" &&
+	test_config_global trace2.eventTarget "$(pwd)/trace.event" &&
+
+	test-tool trace2 100timer 5 10 &&
+
+	have_timer_event "main" "timer" "test" "test1" 6 trace.event &&
+	! grep th_timer trace.event
+'
+
+test_expect_success PTHREADS 'stopwatch timer test/test2' '
+	test_when_finished "rm trace.event" &&
+	test_config_global trace2.eventTarget "$(pwd)/trace.event" &&
+
+	test-tool trace2 101timer 5 10 3 &&
+
+	have_timer_event "th01:ut_101" "th_timer" "test" "test2" 6 trace.event &&
+	have_timer_event "th02:ut_101" "th_timer" "test" "test2" 6 trace.event &&
+	have_timer_event "th03:ut_101" "th_timer" "test" "test2" 6 trace.event &&
+	have_timer_event "main" "timer" "test" "test2" 18 trace.event
+'
+
+test_expect_success 'global counter test/test1' '
+	test_when_finished "rm trace.event" &&
+	test_config_global trace2.eventTarget "$(pwd)/trace.event" &&
+
+	test-tool trace2 200counter 1 2 3 4 5 &&
+
+	have_counter_event "main" "counter" "test" "test1" 15 trace.event &&
+	! grep th_counter trace.event
+'
+
+test_expect_success PTHREADS 'global counter test/test2' '
+	test_when_finished "rm trace.event" &&
+	test_config_global trace2.eventTarget "$(pwd)/trace.event" &&
+
+	test-tool trace2 201counter 2 3 &&
+
+	have_counter_event "th01:ut_201" "th_counter" "test" "test2" 2 trace.event &&
+	have_counter_event "th02:ut_201" "th_counter" "test" "test2" 2 trace.event &&
+	have_counter_event "th03:ut_201" "th_counter" "test" "test2" 2 trace.event &&
+	have_counter_event "main" "counter" "test" "test2" 6 trace.event
+'
+
+test_expect_success 'hot paths are counted' '
+	test_when_finished "rm trace.event" &&
+	test_commit counted &&
+	git repack -adq &&
+	git config --global trace2.eventTarget "$(pwd)/trace.event" &&
+	test_when_finished "git config --global --unset trace2.eventTarget" &&
+	test-tool chmtime +10 counted.t &&
+	git update-index --refresh &&
+	git log -p >/dev/null &&
+	grep "\"event\":\"counter\",.*\"category\":\"index\",\"name\":\"refresh/lstat\"" trace.event &&
+	grep "\"event\":\"counter\",.*\"category\":\"pack\",\"name\":\"window_maps\"" trace.event &&
+	grep "\"event\":\"timer\",.*\"category\":\"pack\",\"name\":\"unpack_entry\"" trace.event
+'
+
 test_expect_success 'discard traces when there are too many files' '
 	mkdir trace_target_dir &&
 	test_when_finished "rm -r trace_target_dir" &&
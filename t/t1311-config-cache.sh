@@ -0,0 +1,238 @@
+#!/bin/sh
+
+test_description='test the cache of parsed configuration files'
+
+. ./test-lib.sh
+
+# Config files modified within the current second are not cached; move
+# them into the past so that the cache gets written right away.
+backdate () {
+	for f in "$@"
+	do
+		test-tool chmtime =-10 "$f" || return 1
+	done
+}
+
+cache_state () {
+	rm -f trace.event &&
+	GIT_TRACE2_EVENT="$PWD/trace.event" "$@" >/dev/null &&
+	grep "\"key\":\"cache\"" trace.event |
+	sed -n "s/.*\"value\":\"\\([a-z]*\\)\".*/\\1/p" | head -n 1
+}
+
+test_expect_success 'setup' '
+	git config --global core.configCache true &&
+	git config cache.value one &&
+	backdate .git/config
+'
+
+test_expect_success 'cache is written and used' '
+	test_path_is_missing .git/config-cache &&
+	test "$(cache_state test-tool config get_value cache.value)" = none &&
+	test_path_is_file .git/config-cache &&
+	test "$(cache_state test-tool config get_value cache.value)" = hit &&
+	test-tool config get_value cache.value >actual &&
+	echo one >expect &&
+	test_cmp expect actual
+'
+
+test_expect_success 'cached values keep their scope and origin' '
+	git config --global core.configCache false &&
+	test-tool config iterate >parsed &&
+	git config --global core.configCache true &&
+	test-tool config iterate >/dev/null &&
+	test "$(cache_state test-tool config iterate)" = hit &&
+	test-tool config iterate >cached &&
+	# cached values name their file by its real path
+	sed -e "s|^name=.git/config$|name=$(test-tool path-utils real_path .git/config)|" \
+	    -e "/^key=core.configcache$/{n;s/false/true/;}" parsed >expect &&
+	test_cmp expect cached
+'
+
+test_expect_success 'modified config invalidates the cache' '
+	git config cache.value two &&
+	test "$(cache_state test-tool config get_value cache.value)" = stale &&
+	test-tool config get_value cache.value >actual &&
+	echo two >expect &&
+	test_cmp expect actual
+'
+
+test_expect_success 'command-line values override cached ones' '
+	backdate .git/config &&
+	test-tool config get_value cache.value >/dev/null &&
+	GIT_CONFIG_PARAMETERS="${SQ}cache.value=three${SQ}" &&
+	export GIT_CONFIG_PARAMETERS &&
+	test "$(cache_state test-tool config get_value cache.value)" = hit &&
+	test-tool config get_value cache.value >actual &&
+	echo three >expect &&
+	test_cmp expect actual &&
+	sane_unset GIT_CONFIG_PARAMETERS &&
+	test-tool config get_value cache.value >actual &&
+	echo two >expect &&
+	test_cmp expect actual
+'
+
+test_expect_success 'included files are checked' '
+	echo "[cache]value = five" >include &&
+	git config include.path ../include &&
+	backdate .git/config include &&
+	test-tool config get_value cache.value >/dev/null &&
+	test "$(cache_state test-tool config get_value cache.value)" = hit &&
+	echo "[cache]value = six" >include &&
+	test "$(cache_state test-tool config get_value cache.value)" = stale &&
+	test-tool config get_value cache.value >actual &&
+	echo six >expect &&
+	test_cmp expect actual
+'
+
+test_expect_success 'files that appear invalidate the cache' '
+	git config --add include.path ../missing &&
+	backdate .git/config include &&
+	test-tool config get_value cache.value >/dev/null &&
+	test "$(cache_state test-tool config get_value cache.value)" = hit &&
+	echo "[cache]other = seven" >missing &&
+	test "$(cache_state test-tool config get_value cache.other)" = stale &&
+	test-tool config get_value cache.other >actual &&
+	echo seven >expect &&
+	test_cmp expect actual
+'
+
+global_cache_state () {
+	rm -f trace.event &&
+	GIT_TRACE2_EVENT="$PWD/trace.event" "$@" >/dev/null &&
+	grep "\"key\":\"global-cache\"" trace.event |
+	sed -n "s/.*\"value\":\"\\([a-z]*\\)\".*/\\1/p" | head -n 1
+}
+
+test_expect_success 'global files are cached for the user' '
+	backdate missing .gitconfig &&
+	test-tool config get_value cache.value >/dev/null &&
+	test_path_is_file .cache/git/config-cache &&
+	test "$(global_cache_state test-tool config get_value cache.value)" = hit &&
+	git config --global cache.global eight &&
+	test "$(global_cache_state test-tool config get_value cache.global)" = stale &&
+	test-tool config get_value cache.global >actual &&
+	echo eight >expect &&
+	test_cmp expect actual &&
+	backdate .gitconfig &&
+	test-tool config get_value cache.global >/dev/null &&
+	test "$(global_cache_state test-tool config get_value cache.global)" = hit &&
+	test "$(cache_state test-tool config get_value cache.global)" = hit &&
+	test-tool config get_value cache.global >actual &&
+	test_cmp expect actual
+'
+
+test_expect_success 'the user cache follows XDG_CACHE_HOME' '
+	test "$(XDG_CACHE_HOME="$PWD/xdg-cache" &&
+		export XDG_CACHE_HOME &&
+		test-tool config get_value cache.global >/dev/null &&
+		global_cache_state test-tool config get_value cache.global)" = hit &&
+	test_path_is_file xdg-cache/git/config-cache
+'
+
+test_expect_success 'the user cache is not used once disabled' '
+	git config --global core.configCache false &&
+	backdate .gitconfig &&
+	test "$(global_cache_state test-tool config get_value cache.global)" = stale &&
+	test "$(global_cache_state test-tool config get_value cache.global)" = none &&
+	test_path_is_missing .cache/git/config-cache &&
+	git config --global core.configCache true &&
+	backdate .gitconfig
+'
+
+test_expect_success 'includes of "~/" follow HOME' '
+	echo "[cache]home = main" >home-include &&
+	git config --add include.path "~/home-include" &&
+	mkdir other-home &&
+	cp .gitconfig other-home/ &&
+	echo "[cache]home = other" >other-home/home-include &&
+	backdate .git/config home-include other-home/.gitconfig \
+		other-home/home-include &&
+	test-tool config get_value cache.home >/dev/null &&
+	test "$(cache_state test-tool config get_value cache.home)" = hit &&
+	HOME="$PWD/other-home" test-tool config get_value cache.home >actual &&
+	echo other >expect &&
+	test_cmp expect actual &&
+	git config --unset include.path home-include &&
+	backdate .git/config
+'
+
+test_expect_success 'global includes of "~/" follow HOME' '
+	XDG_CACHE_HOME="$PWD/xdg-cache" &&
+	export XDG_CACHE_HOME &&
+	git config --global include.path "~/home-include" &&
+	cp .gitconfig other-home/ &&
+	backdate .gitconfig other-home/.gitconfig &&
+	test-tool config get_value cache.home >/dev/null &&
+	test "$(global_cache_state test-tool config get_value cache.home)" = hit &&
+	HOME="$PWD/other-home" test-tool config get_value cache.home >actual &&
+	echo other >expect &&
+	test_cmp expect actual &&
+	test-tool config get_value cache.home >actual &&
+	echo main >expect &&
+	test_cmp expect actual &&
+	sane_unset XDG_CACHE_HOME
+'
+
+test_expect_success 'gitdir includes in global files are checked' '
+	git init sub &&
+	echo "[cache]sub = yes" >sub-include &&
+	git config --global "includeIf.gitdir:$PWD/sub/.git.path" \
+		"$PWD/sub-include" &&
+	backdate .gitconfig sub-include &&
+	test-tool config get_value cache.value >/dev/null &&
+	test "$(global_cache_state test-tool config get_value cache.value)" = hit &&
+	test_must_fail test-tool config get_value cache.sub &&
+	(
+		cd sub &&
+		test "$(global_cache_state test-tool config get_value cache.sub)" = stale &&
+		test-tool config get_value cache.sub >actual &&
+		echo yes >expect &&
+		test_cmp expect actual
+	) &&
+	test_must_fail test-tool config get_value cache.sub
+'
+
+test_expect_success 'the cache is shared however the repository is reached' '
+	test "$(cache_state test-tool config get_value cache.value)" = hit &&
+	(
+		cd .git &&
+		test "$(cache_state test-tool config get_value cache.value)" = hit
+	) &&
+	test "$(cache_state test-tool config get_value cache.value)" = hit
+'
+
+test_expect_success 'onbranch includes are not cached' '
+	git config includeIf.onbranch:main.path ../include &&
+	rm -f .git/config-cache &&
+	test-tool config get_value cache.value >/dev/null &&
+	test_path_is_missing .git/config-cache
+'
+
+test_expect_success 'the cache is not read unless enabled globally' '
+	git config --unset includeIf.onbranch:main.path &&
+	backdate .git/config &&
+	test-tool config get_value cache.value >/dev/null &&
+	test_path_is_file .git/config-cache &&
+	git config --global core.configCache false &&
+	git config core.configCache true &&
+	test "$(cache_state test-tool config get_value cache.value)" = "" &&
+	git config --global --unset core.configCache &&
+	test "$(cache_state test-tool config get_value cache.value)" = ""
+'
+
+test_expect_success 'upload-pack hook is not taken from the cache' '
+	test_commit hook &&
+	git config --global core.configCache true &&
+	git config uploadpack.packObjectsHook "touch hook-ran;" &&
+	backdate .git/config &&
+	test-tool config get_value cache.value >/dev/null &&
+	test "$(cache_state test-tool config get_value cache.value)" = hit &&
+	test-tool config iterate >iterate &&
+	grep -A5 "uploadpack.packobjectshook" iterate >actual &&
+	grep "scope=local" actual &&
+	git clone --no-local . dst &&
+	test_path_is_missing .git/hook-ran
+'
+
+test_done
@@ -0,0 +1,12 @@
+#!/bin/sh
+
+test_description='chunked diff algorithm'
+
+. ./test-lib.sh
+. "$TEST_DIRECTORY"/lib-diff-alternative.sh
+
+test_diff_frobnitz "diff-algorithm=chunked"
+
+test_diff_unique "diff-algorithm=chunked"
+
+test_done
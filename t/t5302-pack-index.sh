@@ -66,6 +66,36 @@ test_expect_success 'index-pack results should match pack-objects ones' '
 	cmp "test-2-${pack2}.idx" "2.idx"
 '
 
+test_expect_success 'index-pack with a tiny --max-memory budget' '
+	GIT_TRACE2_EVENT="$(pwd)/trace" \
+		git index-pack --max-memory=1k -o 4.idx "test-1-${pack1}.pack" &&
+	cmp "test-2-${pack2}.idx" "4.idx" &&
+	grep "\"key\":\"base_cache_limit\",\"value\":\"1024\"" trace &&
+	grep "\"region_leave\".*\"label\":\"resolve_deltas\"" trace
+'
+
+test_expect_success 'pack.indexMaxMemory is respected with threads' '
+	rm -f trace &&
+	GIT_TRACE2_EVENT="$(pwd)/trace" \
+		git -c pack.indexMaxMemory=2k index-pack --threads=4 \
+		-o 5.idx "test-1-${pack1}.pack" &&
+	cmp "test-2-${pack2}.idx" "5.idx" &&
+	grep "\"key\":\"base_cache_limit\",\"value\":\"2048\"" trace
+'
+
+test_expect_success 'the hashing queue stays within --max-memory' '
+	rm -f trace &&
+	largest=$(git cat-file --batch-check="%(objectsize)" <obj-list |
+		  sort -n | tail -n 1) &&
+	GIT_TRACE2_EVENT="$(pwd)/trace" \
+		git index-pack --threads=4 --max-memory=1k \
+		-o 6.idx "test-1-${pack1}.pack" &&
+	cmp "test-2-${pack2}.idx" "6.idx" &&
+	peak=$(sed -n "s/.*\"key\":\"hash_queue_peak\",\"value\":\"\([0-9]*\)\".*/\1/p" trace) &&
+	test -n "$peak" &&
+	test "$peak" -le "$largest"
+'
+
 test_expect_success 'index-pack --verify on index version 1' '
 	git index-pack --verify "test-1-${pack1}.pack"
 '
@@ -0,0 +1,59 @@
+#!/bin/sh
+
+test_description='delta base cache eviction and threads'
+. ./test-lib.sh
+
+test_expect_success 'setup' '
+	test_seq 1000 >big &&
+	for i in $(test_seq 20)
+	do
+		mkdir -p dir$i &&
+		echo "small $i" >dir$i/small &&
+		echo "line $i" >>big &&
+		git add big dir$i &&
+		test_tick &&
+		git commit -q -m "commit $i" || return 1
+	done &&
+	git repack -adf --depth=50 &&
+	git cat-file --batch-all-objects --batch >expect
+'
+
+test_expect_success 'tiny cache returns the same objects' '
+	git -c core.deltaBaseCacheLimit=2k \
+		cat-file --batch-all-objects --batch >actual &&
+	test_cmp expect actual
+'
+
+test_expect_success 'evictions are counted' '
+	GIT_TRACE2_EVENT="$(pwd)/trace.event" \
+		git -c core.deltaBaseCacheLimit=2k log -p >/dev/null &&
+	grep "\"name\":\"delta_base_cache/hit\"" trace.event &&
+	grep "\"name\":\"delta_base_cache/evict\"" trace.event &&
+	rm trace.event &&
+	GIT_TRACE2_EVENT="$(pwd)/trace.event" git log -p >/dev/null &&
+	! grep "\"name\":\"delta_base_cache/evict\"" trace.event
+'
+
+test_expect_success 'only missing delta bases count as misses' '
+	git cat-file --batch-check="%(objectname) %(deltabase)" \
+		--batch-all-objects >objects &&
+	nondelta=$(grep " $ZERO_OID\$" objects | head -n 1 | cut -d" " -f1) &&
+	delta=$(grep -v " $ZERO_OID\$" objects | head -n 1 | cut -d" " -f1) &&
+	rm -f trace.event &&
+	GIT_TRACE2_EVENT="$(pwd)/trace.event" \
+		git cat-file -p $nondelta >/dev/null &&
+	! grep "\"name\":\"delta_base_cache/miss\"" trace.event &&
+	rm trace.event &&
+	GIT_TRACE2_EVENT="$(pwd)/trace.event" \
+		git cat-file -p $delta >/dev/null &&
+	grep "\"name\":\"delta_base_cache/miss\"" trace.event
+'
+
+test_expect_success 'threads share a tiny cache' '
+	git grep --threads=1 -e line -e small $(git rev-list HEAD) >expect.grep &&
+	git -c core.deltaBaseCacheLimit=2k \
+		grep --threads=8 -e line -e small $(git rev-list HEAD) >actual.grep &&
+	test_cmp expect.grep actual.grep
+'
+
+test_done
@@ -0,0 +1,109 @@
+#!/bin/sh
+
+test_description='upload-pack serving packs from uploadpack.packCache'
+. ./test-lib.sh
+
+test_expect_success 'setup' '
+	test_commit one &&
+	test_commit two &&
+	write_script .git/hook <<-\EOF &&
+		echo >&2 "hook running"
+		"$@"
+	EOF
+	git config --global uploadpack.packObjectsHook ./hook
+'
+
+clone_and_check () {
+	rm -rf dst.git &&
+	git clone --bare --no-local . dst.git 2>stderr &&
+	git -C dst.git fsck &&
+	git rev-parse --all >expect &&
+	git -C dst.git rev-parse --all >actual &&
+	test_cmp expect actual
+}
+
+test_expect_success 'no cache is written by default' '
+	clone_and_check &&
+	grep "hook running" stderr &&
+	test_path_is_missing .git/upload-pack-cache
+'
+
+test_expect_success 'first clone populates the cache' '
+	test_config uploadpack.packCache true &&
+	clone_and_check &&
+	grep "hook running" stderr &&
+	ls .git/upload-pack-cache/*.pack >entries &&
+	test_line_count = 1 entries
+'
+
+test_expect_success 'identical request is served from the cache' '
+	test_config uploadpack.packCache true &&
+	clone_and_check &&
+	! grep "hook running" stderr
+'
+
+test_expect_success 'cache is used for protocol v2' '
+	test_config uploadpack.packCache true &&
+	rm -rf .git/upload-pack-cache dst.git &&
+	GIT_TRACE2_EVENT="$(pwd)/trace" \
+		git -c protocol.version=2 clone --bare --no-local . dst.git &&
+	grep "\"pack-cache\",\"value\":\"miss\"" trace &&
+	rm -rf dst.git trace &&
+	GIT_TRACE2_EVENT="$(pwd)/trace" \
+		git -c protocol.version=2 clone --bare --no-local . dst.git &&
+	grep "\"pack-cache\",\"value\":\"hit\"" trace &&
+	git -C dst.git fsck
+'
+
+test_expect_success 'ref update invalidates the cache' '
+	test_config uploadpack.packCache true &&
+	ls .git/upload-pack-cache/*.pack >old &&
+	test_commit three &&
+	clone_and_check &&
+	grep "hook running" stderr &&
+	ls .git/upload-pack-cache/*.pack >new &&
+	test_line_count = 1 new &&
+	! test_cmp old new
+'
+
+test_expect_success 'fetches with the same haves share an entry' '
+	test_config uploadpack.packCache true &&
+	git clone --no-local . inc1 &&
+	git clone --no-local . inc2 &&
+	test_commit four &&
+	git -C inc1 fetch 2>stderr &&
+	grep "hook running" stderr &&
+	git -C inc2 fetch 2>stderr &&
+	! grep "hook running" stderr &&
+	git -C inc2 fsck &&
+	git rev-parse master >expect &&
+	git -C inc2 rev-parse origin/master >actual &&
+	test_cmp expect actual
+'
+
+test_expect_success 'entries larger than packCacheLimit are not kept' '
+	test_config uploadpack.packCache true &&
+	test_config uploadpack.packCacheLimit 1 &&
+	rm -rf .git/upload-pack-cache &&
+	clone_and_check &&
+	ls .git/upload-pack-cache >entries &&
+	test_must_be_empty entries
+'
+
+test_expect_success 'least recently used entries are evicted first' '
+	test_config uploadpack.packCache true &&
+	rm -rf .git/upload-pack-cache inc1 &&
+	git clone --no-local . inc1 &&
+	test_commit five &&
+	clone_and_check &&
+	clone=$(ls .git/upload-pack-cache/*.pack) &&
+	test-tool chmtime =-60 $clone &&
+	test_config uploadpack.packCacheLimit \
+		$(test-tool path-utils file-size $clone) &&
+	git -C inc1 fetch &&
+	test_path_is_missing $clone &&
+	ls .git/upload-pack-cache/*.pack >entries &&
+	test_line_count = 1 entries
+'
+
+test_done
@@ -0,0 +1,92 @@
+#!/bin/sh
+
+test_description='fetch negotiation using prefetched refs as common commits'
+. ./test-lib.sh
+
+# count_rounds <trace>: number of fetch requests the client sent
+count_rounds () {
+	grep "fetch> command=fetch" "$1" | wc -l
+}
+
+test_expect_success 'setup' '
+	git init server &&
+	test_commit -C server base &&
+	git clone server client &&
+	test_commit -C server prefetched &&
+	git -C client maintenance run --task=prefetch &&
+	git -C server rev-parse prefetched >expect &&
+	git -C client rev-parse refs/prefetch/origin/master >actual &&
+	test_cmp expect actual &&
+
+	# many local commits, all newer than the prefetched one
+	git -C client checkout -b local &&
+	for i in $(test_seq 1 50)
+	do
+		test_commit -C client local-$i || return 1
+	done &&
+	test_commit -C server new &&
+
+	# do not let advertised tags give away common commits
+	git -C server tag -d base prefetched new
+'
+
+for negotiator in default skipping
+do
+	test_expect_success "$negotiator: prefetched tip is sent first" '
+		rm -rf fetcher trace &&
+		cp -R client fetcher &&
+		GIT_TRACE_PACKET="$(pwd)/trace" git -C fetcher \
+			-c protocol.version=2 \
+			-c fetch.negotiationAlgorithm=$negotiator \
+			fetch origin &&
+		test $(count_rounds trace) = 1 &&
+		grep "fetch> have $(git -C server rev-parse master^)" trace &&
+		git -C server rev-parse master >expect &&
+		git -C fetcher rev-parse origin/master >actual &&
+		test_cmp expect actual
+	'
+done
+
+test_expect_success 'rewound prefetched tip is not taken as common' '
+	rm -rf fetcher trace &&
+	cp -R client fetcher &&
+	git -C fetcher update-ref refs/prefetch/origin/master local-25 &&
+	GIT_TRACE_PACKET="$(pwd)/trace" git -C fetcher \
+		-c protocol.version=2 fetch origin &&
+	grep "fetch> have $(git -C client rev-parse local-25)" trace &&
+	grep "fetch> have $(git -C client rev-parse base)" trace &&
+	git -C server rev-parse master >expect &&
+	git -C fetcher rev-parse origin/master >actual &&
+	test_cmp expect actual
+'
+
+test_expect_success 'prefetched tip of a deleted branch is not sent first' '
+	rm -rf fetcher trace &&
+	cp -R client fetcher &&
+	git -C fetcher update-ref refs/prefetch/origin/gone local-25 &&
+	git -C fetcher update-ref -d refs/prefetch/origin/master &&
+	GIT_TRACE_PACKET="$(pwd)/trace" git -C fetcher \
+		-c protocol.version=2 fetch origin &&
+	grep "fetch> have" trace >haves &&
+	! head -n 1 haves | grep $(git -C client rev-parse local-25)
+'
+
+test_expect_success 'without prefetched refs, negotiation needs more rounds' '
+	rm -rf fetcher trace &&
+	cp -R client fetcher &&
+	git -C fetcher update-ref -d refs/prefetch/origin/master &&
+	GIT_TRACE_PACKET="$(pwd)/trace" git -C fetcher \
+		-c protocol.version=2 fetch origin &&
+	test $(count_rounds trace) -gt 1
+'
+
+test_expect_success '--negotiation-tip disables the prefetched tips' '
+	rm -rf fetcher trace &&
+	cp -R client fetcher &&
+	GIT_TRACE_PACKET="$(pwd)/trace" git -C fetcher \
+		-c protocol.version=2 \
+		fetch --negotiation-tip=local origin &&
+	! grep "fetch> have $(git -C server rev-parse master^)" trace
+'
+
+test_done
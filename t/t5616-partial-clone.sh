@@ -529,6 +529,87 @@ test_expect_success 'fetch from a partial clone, protocol v2' '
 	grep "version 2" trace
 '
 
+test_expect_success 'setup object-info server' '
+	rm -rf server &&
+	test_create_repo server &&
+	test_commit -C server one &&
+	test_commit -C server two &&
+	git -C server config uploadpack.allowfilter 1 &&
+	git -C server config transfer.advertiseObjectInfo true
+'
+
+test_expect_success 'object-info is not used unless remote.<name>.objectInfo is set' '
+	rm -rf client trace &&
+	git -c protocol.version=2 clone --no-checkout --filter=blob:none \
+		"file://$(pwd)/server" client &&
+	git -C server rev-parse HEAD:one.t >in &&
+	git -C server cat-file --batch-check <in >expect &&
+	GIT_TRACE_PACKET="$(pwd)/trace" git -C client -c protocol.version=2 \
+		cat-file --batch-check <in >actual &&
+	test_cmp expect actual &&
+	! grep "command=object-info" trace &&
+	git -C client rev-list --objects --missing=print HEAD >objects &&
+	! grep "^?$(cat in)" objects
+'
+
+test_expect_success 'cat-file --batch-check uses object-info instead of fetching' '
+	rm -rf client trace &&
+	git -c protocol.version=2 clone --no-checkout --filter=blob:none \
+		"file://$(pwd)/server" client &&
+	git -C client config remote.origin.objectInfo true &&
+	git -C server rev-parse HEAD:one.t >in &&
+	git -C server cat-file --batch-check <in >expect &&
+	GIT_TRACE_PACKET="$(pwd)/trace" git -C client -c protocol.version=2 \
+		cat-file --batch-check <in >actual &&
+	test_cmp expect actual &&
+	grep "command=object-info" trace &&
+	git -C client rev-list --objects --missing=print HEAD >objects &&
+	grep "^?$(cat in)" objects
+'
+
+test_expect_success 'cat-file -s and -t use object-info' '
+	blob=$(git -C server rev-parse HEAD:one.t) &&
+	git -C server cat-file -s $blob >expect &&
+	git -C server cat-file -t $blob >>expect &&
+	git -C client -c protocol.version=2 cat-file -s $blob >actual &&
+	git -C client -c protocol.version=2 cat-file -t $blob >>actual &&
+	test_cmp expect actual &&
+	git -C client rev-list --objects --missing=print HEAD >objects &&
+	grep "^?$blob" objects
+'
+
+test_expect_success 'cat-file --batch-check --buffer asks about all objects at once' '
+	rm -rf trace &&
+	git -C server rev-parse HEAD:one.t HEAD:two.t HEAD:one.t >in &&
+	git -C server cat-file --batch-check <in >expect &&
+	GIT_TRACE_PACKET="$(pwd)/trace" git -C client -c protocol.version=2 \
+		cat-file --batch-check --buffer <in >actual &&
+	test_cmp expect actual &&
+	test $(grep -c "git> command=object-info" trace) = 1 &&
+	git -C client rev-list --objects --missing=print HEAD >objects &&
+	grep "^?$(git -C server rev-parse HEAD:two.t)" objects
+'
+
+test_expect_success 'object-info answers are remembered' '
+	rm -rf trace &&
+	git -C server rev-parse HEAD:one.t HEAD:one.t >in &&
+	git -C server cat-file --batch-check <in >expect &&
+	GIT_TRACE_PACKET="$(pwd)/trace" git -C client -c protocol.version=2 \
+		cat-file --batch-check <in >actual &&
+	test_cmp expect actual &&
+	test $(grep -c "git> command=object-info" trace) = 1
+'
+
+test_expect_success 'objects are fetched if object-info is not advertised' '
+	test_config -C server transfer.advertiseObjectInfo false &&
+	git -C server rev-parse HEAD:one.t >in &&
+	git -C server cat-file --batch-check <in >expect &&
+	git -C client -c protocol.version=2 cat-file --batch-check <in >actual &&
+	test_cmp expect actual &&
+	git -C client rev-list --objects --missing=print HEAD >objects &&
+	! grep "^?$(cat in)" objects
+'
+
 . "$TEST_DIRECTORY"/lib-httpd.sh
 start_httpd
 
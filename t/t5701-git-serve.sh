@@ -237,4 +237,75 @@ test_expect_success 'unexpected lines are not allowed in fetch request' '
 	grep "unexpected line: .this-is-not-a-command." err
 '
 
+test_expect_success 'object-info is advertised only when enabled' '
+	GIT_TEST_SIDEBAND_ALL=0 test-tool serve-v2 \
+		--advertise-capabilities >out &&
+	test-tool pkt-line unpack <out >actual &&
+	! grep object-info actual &&
+
+	test_config transfer.advertiseObjectInfo true &&
+	GIT_TEST_SIDEBAND_ALL=0 test-tool serve-v2 \
+		--advertise-capabilities >out &&
+	test-tool pkt-line unpack <out >actual &&
+	grep "^object-info$" actual
+'
+
+test_expect_success 'object-info requires advertisement' '
+	test-tool pkt-line pack >in <<-EOF &&
+	command=object-info
+	object-format=$(test_oid algo)
+	0001
+	size
+	oid $(git rev-parse two:two.t)
+	0000
+	EOF
+
+	test_must_fail test-tool serve-v2 --stateless-rpc 2>err <in &&
+	test_i18ngrep "invalid command" err
+'
+
+test_expect_success 'basics of object-info' '
+	test_config transfer.advertiseObjectInfo true &&
+	missing=$(test_oid deadbeef) &&
+	test-tool pkt-line pack >in <<-EOF &&
+	command=object-info
+	object-format=$(test_oid algo)
+	0001
+	size
+	type
+	oid $(git rev-parse two:two.t)
+	oid $(git rev-parse two)
+	oid $missing
+	0000
+	EOF
+
+	cat >expect <<-EOF &&
+	attrs size type
+	$(git rev-parse two:two.t) $(git cat-file -s two:two.t) blob
+	$(git rev-parse two) $(git cat-file -s two) commit
+	EOF
+	# a missing object has empty attributes
+	echo "$missing  " >>expect &&
+	echo 0000 >>expect &&
+
+	test-tool serve-v2 --stateless-rpc <in >out &&
+	test-tool pkt-line unpack <out >actual &&
+	test_cmp expect actual
+'
+
+test_expect_success 'object-info rejects malformed oids' '
+	test_config transfer.advertiseObjectInfo true &&
+	test-tool pkt-line pack >in <<-EOF &&
+	command=object-info
+	object-format=$(test_oid algo)
+	0001
+	size
+	oid not-an-oid
+	0000
+	EOF
+
+	test_must_fail test-tool serve-v2 --stateless-rpc 2>err <in &&
+	grep "expected oid" err
+'
+
 test_done
@@ -0,0 +1,83 @@
+#!/bin/sh
+
+test_description='topological order with core.depthCache'
+. ./test-lib.sh
+
+GIT_TEST_COMMIT_GRAPH=0
+
+# Print the number of depths a command had to compute.
+computed_depths () {
+	rm -f trace.event &&
+	GIT_TRACE2_EVENT="$PWD/trace.event" "$@" >/dev/null &&
+	grep "\"key\":\"depth-cache/computed\"" trace.event |
+	sed -n "s/.*\"value\":\"\\([0-9]*\\)\".*/\\1/p"
+}
+
+check_topo_order () {
+	git -c core.depthCache=false "$@" >expect &&
+	git "$@" >actual &&
+	test_cmp expect actual
+}
+
+test_expect_success 'setup' '
+	test_commit A &&
+	test_commit B &&
+	git checkout -b side A &&
+	test_commit C &&
+	test_commit D &&
+	git checkout master &&
+	test_merge E side &&
+	git checkout -b other B &&
+	test_commit F &&
+	git checkout master &&
+	test_commit G &&
+	test_merge H other &&
+	git config core.commitGraph false &&
+	git config core.depthCache true
+'
+
+test_expect_success 'first walk computes and stores the depths' '
+	test "$(computed_depths git log --topo-order)" = 8 &&
+	test_path_is_file .git/objects/info/depth-cache
+'
+
+test_expect_success 'later walks use the stored depths' '
+	test "$(computed_depths git log --topo-order)" = 0 &&
+	check_topo_order log --topo-order --format=%s &&
+	check_topo_order log --graph --oneline &&
+	check_topo_order log --date-order --format=%s &&
+	check_topo_order log --author-date-order --format=%s &&
+	check_topo_order rev-list --topo-order --parents HEAD &&
+	check_topo_order rev-list --topo-order side..master &&
+	check_topo_order rev-list --topo-order --first-parent HEAD &&
+	check_topo_order rev-list --topo-order --boundary A..H
+'
+
+test_expect_success 'only new commits are computed' '
+	test_commit I &&
+	test "$(computed_depths git log --topo-order)" = 1 &&
+	check_topo_order log --graph --oneline
+'
+
+test_expect_success 'grafts use separate depths' '
+	test_when_finished "rm -f .git/info/grafts" &&
+	echo "$(git rev-parse D) $(git rev-parse B)" >.git/info/grafts &&
+	test "$(computed_depths git log --topo-order)" = 8 &&
+	check_topo_order log --graph --oneline &&
+	check_topo_order rev-list --topo-order --parents HEAD
+'
+
+test_expect_success 'replace refs use separate depths' '
+	test_when_finished "git replace -d $(git rev-parse C)" &&
+	git replace --graft C B &&
+	test "$(computed_depths git log --topo-order)" = 9 &&
+	check_topo_order log --graph --oneline
+'
+
+test_expect_success 'corrupt depth cache is ignored' '
+	echo garbage >.git/objects/info/depth-cache &&
+	check_topo_order log --graph --oneline &&
+	test "$(computed_depths git log --topo-order)" = 0
+'
+
+test_done
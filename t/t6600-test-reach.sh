@@ -437,4 +437,84 @@ test_expect_success 'get_reachable_subset:none' '
 	test_three_modes get_reachable_subset
 '
 
+test_expect_success 'for-each-ref ahead-behind:base' '
+	for x in $(test_seq 1 10)
+	do
+		for y in $(test_seq 1 10)
+		do
+			mx=$(( x < 5 ? x : 5 )) &&
+			my=$(( y < 5 ? y : 5 )) &&
+			echo "refs/heads/commit-$x-$y $((x * y - mx * my)) $((25 - mx * my))" ||
+			return 1
+		done
+	done | sort >expect &&
+	: >input &&
+	run_three_modes git for-each-ref --sort=refname \
+		--format="%(refname) %(ahead-behind:commit-5-5)" \
+		"refs/heads/commit-*"
+'
+
+test_expect_success 'for-each-ref ahead-behind with several bases' '
+	cat >expect <<-\EOF &&
+	refs/tags/tag-3-8 0 3 0 76 23 0
+	refs/tags/tag-8-3 15 18 0 76 23 0
+	refs/tags/tag-9-9 54 0 0 19 80 0
+	EOF
+	: >input &&
+	run_three_modes git for-each-ref --sort=refname \
+		--format="%(refname) %(ahead-behind:commit-3-9) %(ahead-behind:commit-10-10) %(ahead-behind:commit-1-1)" \
+		refs/tags/tag-3-8 refs/tags/tag-8-3 refs/tags/tag-9-9
+'
+
+test_expect_success 'for-each-ref upstream:track uses the same counts' '
+	test_config branch.commit-9-3.remote . &&
+	test_config branch.commit-9-3.merge refs/heads/commit-4-6 &&
+	test_config branch.commit-2-8.remote . &&
+	test_config branch.commit-2-8.merge refs/heads/commit-4-6 &&
+	test_config branch.commit-1-1.remote . &&
+	test_config branch.commit-1-1.merge refs/heads/missing &&
+	cat >expect <<-\EOF &&
+	refs/heads/commit-1-1 [gone]
+	refs/heads/commit-2-8 [ahead 4, behind 12]
+	refs/heads/commit-9-3 [ahead 15, behind 12]
+	EOF
+	: >input &&
+	run_three_modes git for-each-ref --sort=refname \
+		--format="%(refname) %(upstream:track)" \
+		refs/heads/commit-1-1 refs/heads/commit-2-8 refs/heads/commit-9-3
+'
+
+test_expect_success 'for-each-ref --merged' '
+	for x in $(test_seq 1 10)
+	do
+		for y in $(test_seq 1 10)
+		do
+			if test $x -le 5 && test $y -le 5 ||
+			   test $x -le 3 && test $y -le 8
+			then
+				echo refs/heads/commit-$x-$y
+			fi || return 1
+		done
+	done | sort >expect &&
+	: >input &&
+	run_three_modes git for-each-ref --format="%(refname)" \
+		--merged=commit-5-5 --merged=commit-3-8 "refs/heads/commit-*"
+'
+
+test_expect_success 'for-each-ref --no-merged' '
+	for x in $(test_seq 1 10)
+	do
+		for y in $(test_seq 1 10)
+		do
+			if test $x -gt 7 || test $y -gt 2
+			then
+				echo refs/heads/commit-$x-$y
+			fi || return 1
+		done
+	done | sort >expect &&
+	: >input &&
+	run_three_modes git for-each-ref --format="%(refname)" \
+		--no-merged=commit-7-2 "refs/heads/commit-*"
+'
+
 test_done
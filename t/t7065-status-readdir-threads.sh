@@ -0,0 +1,69 @@
+#!/bin/sh
+
+test_description='status with directory listings read by worker threads'
+
+. ./test-lib.sh
+
+test_expect_success 'setup' '
+	for d in a a/b a/b/c a/d e e/f g
+	do
+		mkdir -p $d &&
+		echo tracked >$d/tracked &&
+		echo untracked >$d/untracked || return 1
+	done &&
+	mkdir -p h/i &&
+	echo untracked >h/i/untracked &&
+	cat >.gitignore <<-\EOF &&
+	.gitignore
+	ignored
+	expect*
+	actual*
+	EOF
+	echo ignored >a/b/ignored &&
+	echo ignored >e/ignored &&
+	git add a/b/c/tracked a/b/tracked a/d/tracked a/tracked \
+		e/f/tracked e/tracked g/tracked &&
+	git commit -m initial
+'
+
+for opts in "" "--ignored" "--ignored=matching" "-uall" "-uall --ignored"
+do
+	test_expect_success "status${opts:+ $opts} matches the serial walk" '
+		git -c core.readDirectoryThreads=1 status --porcelain $opts >expect &&
+		git -c core.readDirectoryThreads=4 status --porcelain $opts >actual &&
+		test_cmp expect actual
+	'
+done
+
+test_expect_success 'directories are read ahead' '
+	GIT_TRACE2_EVENT="$(pwd)/trace" \
+		git -c core.readDirectoryThreads=4 status --porcelain >actual &&
+	grep "\"key\":\"prefetch/dirs\"" trace &&
+	git -c core.readDirectoryThreads=1 status --porcelain >expect &&
+	test_cmp expect actual
+'
+
+test_expect_success 'a directory removed from the worktree' '
+	test_when_finished "git checkout -- e" &&
+	rm -r e/f &&
+	git -c core.readDirectoryThreads=1 status --porcelain -uall >expect &&
+	git -c core.readDirectoryThreads=4 status --porcelain -uall >actual &&
+	test_cmp expect actual
+'
+
+test_expect_success 'clean -n matches the serial walk' '
+	git -c core.readDirectoryThreads=1 clean -n -d >expect &&
+	git -c core.readDirectoryThreads=0 clean -n -d >actual &&
+	test_cmp expect actual
+'
+
+test_expect_success 'untracked cache is filled the same way' '
+	test_config core.untrackedCache true &&
+	git -c core.readDirectoryThreads=4 status --porcelain -uall >actual &&
+	git -c core.readDirectoryThreads=4 status --porcelain -uall >actual2 &&
+	git -c core.untrackedCache=false status --porcelain -uall >expect &&
+	test_cmp expect actual &&
+	test_cmp expect actual2
+'
+
+test_done
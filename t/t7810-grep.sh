@@ -1690,6 +1690,22 @@ test_expect_success 'grep --color -e A --and -e B -p with context' '
 	test_cmp expected actual
 '
 
+test_expect_success 'grep -n counts lines between distant matches' '
+	test_when_finished "rm -f sparse" &&
+	{
+		test_seq 1 1000 | sed -e "s/^/filler /" &&
+		echo needle &&
+		test_seq 1 1000 | sed -e "s/^/filler /" &&
+		printf "needle without newline"
+	} >sparse &&
+	cat >expect <<-\EOF &&
+	sparse:1001:needle
+	sparse:2002:needle without newline
+	EOF
+	git grep --no-index -n needle sparse >actual &&
+	test_cmp expect actual
+'
+
 test_expect_success 'grep can find things only in the work tree' '
 	: >work-tree-only &&
 	git add work-tree-only &&
@@ -145,4 +145,31 @@ test_expect_success 'grep --textconv blob honors textconv' '
 	test_cmp expect actual
 '
 
+test_expect_success 'setup copy of a without textconv' '
+	cp a 0 &&
+	git add 0 &&
+	git commit -m "copy of a"
+'
+
+for threads in 1 4
+do
+	test_expect_success "grep --textconv over trees sharing a blob (threads=$threads)" '
+		cat >expect <<-\EOF &&
+		HEAD:a:binaryQfileQm[*]cQ*æQð
+		HEAD~0:a:binaryQfileQm[*]cQ*æQð
+		EOF
+		git grep --threads=$threads --textconv Qfile HEAD HEAD~0 >actual &&
+		test_cmp expect actual
+	'
+
+	test_expect_success "grep -L over trees sharing a blob (threads=$threads)" '
+		cat >expect <<-\EOF &&
+		HEAD:0
+		HEAD~0:0
+		EOF
+		git grep --threads=$threads --textconv -L Qfile HEAD HEAD~0 -- 0 a >actual &&
+		test_cmp expect actual
+	'
+done
+
 test_done
@@ -114,4 +114,11 @@ do
 	'
 done
 
+test_expect_success 'threaded copy and move detection gives the same result' '
+	git blame --root -C -C -M --line-porcelain combined >expect &&
+	git -c blame.threads=4 blame --root -C -C -M --line-porcelain \
+		combined >actual &&
+	test_cmp expect actual
+'
+
 test_done
@@ -0,0 +1,104 @@
+#!/bin/sh
+
+test_description='git blame with blame.cache'
+. ./test-lib.sh
+
+# Run a blame and print the number of cache hits and stores it reports.
+cache_stats () {
+	rm -f trace.event &&
+	GIT_TRACE2_EVENT="$PWD/trace.event" "$@" >/dev/null &&
+	for key in hits stores
+	do
+		grep "\"key\":\"cache/$key\"" trace.event |
+		sed -n "s/.*\"value\":\"\\([0-9]*\\)\".*/\\1/p"
+	done | tr "\n" " "
+}
+
+test_expect_success 'setup' '
+	for i in $(test_seq 1 12)
+	do
+		test_seq 1 $i | sed "s/^/line $i./" >>file &&
+		sed "s/^line $((i / 2))\.1$/changed in $i/" file >file.new &&
+		mv file.new file &&
+		git add file &&
+		test_tick &&
+		git commit -m "commit $i" || return 1
+	done &&
+	git config blame.cache true
+'
+
+test_expect_success 'blaming a whole file stores the result' '
+	git -c blame.cache=false blame HEAD~4 -- file >expect &&
+	test "$(cache_stats git blame HEAD~4 -- file)" = "0 1 " &&
+	git blame HEAD~4 -- file >actual &&
+	test_cmp expect actual &&
+	test "$(cache_stats git blame HEAD~4 -- file)" = "1 1 "
+'
+
+test_expect_success 'later commits reuse the stored result' '
+	git -c blame.cache=false blame --porcelain file >expect &&
+	test "$(cache_stats git blame HEAD~2 -- file)" = "1 1 " &&
+	git blame --porcelain file >actual &&
+	test_cmp expect actual
+'
+
+test_expect_success 'line ranges use the cache but do not store' '
+	git -c blame.cache=false blame -L 20,40 HEAD~1 -- file >expect &&
+	test "$(cache_stats git blame -L 20,40 HEAD~1 -- file)" = "1 0 " &&
+	git blame -L 20,40 HEAD~1 -- file >actual &&
+	test_cmp expect actual
+'
+
+test_expect_success 'unchanged working tree file is stored for HEAD' '
+	rm -rf .git/blame-cache &&
+	test "$(cache_stats git blame file)" = "0 1 " &&
+	test "$(cache_stats git blame HEAD -- file)" = "1 1 "
+'
+
+test_expect_success 'modified working tree file is not stored' '
+	test_when_finished "git checkout file" &&
+	rm -rf .git/blame-cache &&
+	echo new >>file &&
+	test "$(cache_stats git blame file)" = "0 0 "
+'
+
+test_expect_success 'move and copy detection do not use the cache' '
+	rm -f trace.event &&
+	GIT_TRACE2_EVENT="$PWD/trace.event" git blame -C HEAD -- file >/dev/null &&
+	! grep "cache/hits" trace.event
+'
+
+test_expect_success 'options that change the diff use separate entries' '
+	git -c blame.cache=false blame -w HEAD~1 -- file >expect &&
+	test "$(cache_stats git blame -w HEAD~1 -- file)" = "0 1 " &&
+	git blame -w HEAD~1 -- file >actual &&
+	test_cmp expect actual
+'
+
+test_expect_success 'replace refs and grafts use separate entries' '
+	test_when_finished "rm -f .git/info/grafts" &&
+	root=$(git rev-parse HEAD~3) &&
+	git blame HEAD~2 -- file >/dev/null &&
+	git replace --graft $root &&
+	git -c blame.cache=false blame HEAD~2 -- file >expect &&
+	test "$(cache_stats git blame HEAD~2 -- file)" = "0 1 " &&
+	git blame HEAD~2 -- file >actual &&
+	test_cmp expect actual &&
+	git replace -d $root &&
+	echo $root >.git/info/grafts &&
+	test "$(cache_stats git blame HEAD~2 -- file)" = "0 1 " &&
+	git blame HEAD~2 -- file >actual &&
+	test_cmp expect actual
+'
+
+test_expect_success 'corrupt cache files are ignored' '
+	git -c blame.cache=false blame HEAD~2 -- file >expect &&
+	for f in .git/blame-cache/*
+	do
+		echo garbage >"$f" || return 1
+	done &&
+	git blame HEAD~2 -- file >actual &&
+	test_cmp expect actual
+'
+
+test_done
@@ -51,6 +51,8 @@ struct json_writer;
  * [] trace2_region*    -- emit region nesting messages.
  * [] trace2_data*      -- emit region/thread/repo data messages.
  * [] trace2_printf*    -- legacy trace[1] messages.
+ * [] trace2_timer*     -- measure time spent in hot code.
+ * [] trace2_counter*   -- count events in hot code.
  */
 
 /*
@@ -480,6 +482,99 @@ void trace2_printf(const char *fmt, ...);
 /* clang-format on */
 #endif
 
+/*
+ * Define the set of stopwatch timers.
+ *
+ * We can add more at any time, but they must be defined at compile
+ * time (to avoid the need to dynamically allocate and synchronize
+ * them between different threads).
+ *
+ * These must start at 0 and be contiguous (because we use them
+ * elsewhere as array indexes).
+ *
+ * Any values added to this enum must also be added to the
+ * `tr2_timer_metadata[]` in `trace2/tr2_tmr.c`.
+ */
+enum trace2_timer_id {
+	/*
+	 * Define two timers for testing.  See `t/helper/test-trace2.c`.
+	 * These can be used for ad hoc testing, but should not be used
+	 * for permanent analysis code.
+	 */
+	TRACE2_TIMER_ID_TEST1 = 0, /* emits summary event only */
+	TRACE2_TIMER_ID_TEST2,     /* emits summary and thread events */
+
+	TRACE2_TIMER_ID_INDEX_LSTAT,  /* lstat() in refresh_index() */
+	TRACE2_TIMER_ID_UNPACK_ENTRY, /* unpack_entry() from a pack */
+
+	/* Add additional timer definitions before here. */
+	TRACE2_NUMBER_OF_TIMERS
+};
+
+/*
+ * Start/Stop the indicated stopwatch timer in the current thread.
+ *
+ * The time spent by the current thread between the _start and _stop
+ * calls will be added to the thread's partial sum for this timer.
+ *
+ * Timers are silently ignored if Trace2 is disabled, and may be
+ * nested on one thread, in which case only the outermost interval
+ * is measured.
+ *
+ * When a thread exits (see trace2_thread_exit()), its timers are
+ * added to the process-wide sums. A "timer" event with the sum over
+ * all threads is emitted for each timer that was used when the process
+ * exits. Timers may also ask for a "th_timer" event for each thread
+ * that used them.
+ *
+ * Threads that do not call trace2_thread_start() and
+ * trace2_thread_exit() do not contribute to the sums.
+ */
+void trace2_timer_start(enum trace2_timer_id tid);
+void trace2_timer_stop(enum trace2_timer_id tid);
+
+/*
+ * Define the set of global counters.
+ *
+ * We can add more at any time, but they must be defined at compile
+ * time (to avoid the need to dynamically allocate and synchronize
+ * them between different threads).
+ *
+ * These must start at 0 and be contiguous (because we use them
+ * elsewhere as array indexes).
+ *
+ * Any values added to this enum must also be added to the
+ * `tr2_counter_metadata[]` in `trace2/tr2_ctr.c`.
+ */
+enum trace2_counter_id {
+	/*
+	 * Define two counters for testing.  See `t/helper/test-trace2.c`.
+	 * These can be used for ad hoc testing, but should not be used
+	 * for permanent analysis code.
+	 */
+	TRACE2_COUNTER_ID_TEST1 = 0, /* emits summary event only */
+	TRACE2_COUNTER_ID_TEST2,     /* emits summary and thread events */
+
+	TRACE2_COUNTER_ID_PACK_WINDOW_MAPS,       /* use_pack() mmaps */
+	TRACE2_COUNTER_ID_DELTA_BASE_CACHE_HIT,   /* objects served from it */
+	TRACE2_COUNTER_ID_DELTA_BASE_CACHE_MISS,  /* delta bases not in it */
+	TRACE2_COUNTER_ID_DELTA_BASE_CACHE_EVICT,
+	TRACE2_COUNTER_ID_INDEX_LSTAT,            /* lstat() in refresh_index() */
+	TRACE2_COUNTER_ID_LOOSE_OBJECT_LOOKUP,    /* searches of the loose objects */
+
+	/* Add additional counter definitions before here. */
+	TRACE2_NUMBER_OF_COUNTERS
+};
+
+/*
+ * Increment a global counter by `value`.
+ *
+ * Like the timers, counters are accumulated per thread and summed
+ * when the threads exit. A "counter" event is emitted for each
+ * counter that is not zero when the process exits.
+ */
+void trace2_counter_add(enum trace2_counter_id cid, uint64_t value);
+
 /*
  * Optional platform-specific code to dump information about the
  * current and any parent process(es).  This is intended to allow
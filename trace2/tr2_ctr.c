@@ -0,0 +1,116 @@
+#include "cache.h"
+#include "thread-utils.h"
+#include "trace2/tr2_tgt.h"
+#include "trace2/tr2_tls.h"
+#include "trace2/tr2_ctr.h"
+
+/*
+ * A global counter block to aggregate values from the partial sums
+ * from each thread.
+ */
+static struct tr2_counter_block final_counter_block; /* access under tr2tls_lock */
+
+/*
+ * Define metadata for each global counter.
+ *
+ * This array must match the "enum trace2_counter_id" and the values
+ * in "struct tr2_counter_block.counter[*]".
+ */
+static struct tr2_counter_metadata tr2_counter_metadata[TRACE2_NUMBER_OF_COUNTERS] = {
+	[TRACE2_COUNTER_ID_TEST1] = {
+		.category = "test",
+		.name = "test1",
+		.want_per_thread_events = 0,
+	},
+	[TRACE2_COUNTER_ID_TEST2] = {
+		.category = "test",
+		.name = "test2",
+		.want_per_thread_events = 1,
+	},
+	[TRACE2_COUNTER_ID_PACK_WINDOW_MAPS] = {
+		.category = "pack",
+		.name = "window_maps",
+		.want_per_thread_events = 0,
+	},
+	[TRACE2_COUNTER_ID_DELTA_BASE_CACHE_HIT] = {
+		.category = "pack",
+		.name = "delta_base_cache/hit",
+		.want_per_thread_events = 0,
+	},
+	[TRACE2_COUNTER_ID_DELTA_BASE_CACHE_MISS] = {
+		.category = "pack",
+		.name = "delta_base_cache/miss",
+		.want_per_thread_events = 0,
+	},
+	[TRACE2_COUNTER_ID_DELTA_BASE_CACHE_EVICT] = {
+		.category = "pack",
+		.name = "delta_base_cache/evict",
+		.want_per_thread_events = 0,
+	},
+	[TRACE2_COUNTER_ID_INDEX_LSTAT] = {
+		.category = "index",
+		.name = "refresh/lstat",
+		.want_per_thread_events = 0,
+	},
+	[TRACE2_COUNTER_ID_LOOSE_OBJECT_LOOKUP] = {
+		.category = "object",
+		.name = "loose_lookup",
+		.want_per_thread_events = 0,
+	},
+
+	/* Add additional metadata before here. */
+};
+
+void tr2_counter_increment(enum trace2_counter_id cid, uint64_t value)
+{
+	struct tr2tls_thread_ctx *ctx = tr2tls_get_self();
+
+	ctx->counter_block.counter[cid].value += value;
+}
+
+void tr2_update_final_counters(void)
+{
+	struct tr2tls_thread_ctx *ctx = tr2tls_get_self();
+	enum trace2_counter_id cid;
+
+	tr2tls_lock();
+
+	for (cid = 0; cid < TRACE2_NUMBER_OF_COUNTERS; cid++)
+		final_counter_block.counter[cid].value +=
+			ctx->counter_block.counter[cid].value;
+
+	tr2tls_unlock();
+}
+
+void tr2_emit_per_thread_counters(tr2_tgt_evt_counter_t *fn_apply)
+{
+	struct tr2tls_thread_ctx *ctx = tr2tls_get_self();
+	enum trace2_counter_id cid;
+
+	for (cid = 0; cid < TRACE2_NUMBER_OF_COUNTERS; cid++) {
+		struct tr2_counter_metadata *meta = &tr2_counter_metadata[cid];
+		struct tr2_counter *c = &ctx->counter_block.counter[cid];
+
+		if (!c->value)
+			continue; /* counter was not used by this thread */
+		if (!meta->want_per_thread_events)
+			continue;
+
+		fn_apply(meta, c, 0);
+	}
+}
+
+void tr2_emit_final_counters(tr2_tgt_evt_counter_t *fn_apply)
+{
+	enum trace2_counter_id cid;
+
+	for (cid = 0; cid < TRACE2_NUMBER_OF_COUNTERS; cid++) {
+		struct tr2_counter_metadata *meta = &tr2_counter_metadata[cid];
+		struct tr2_counter *c = &final_counter_block.counter[cid];
+
+		if (!c->value)
+			continue; /* counter was not used by any thread */
+
+		fn_apply(meta, c, 1);
+	}
+}
@@ -0,0 +1,69 @@
+#ifndef TR2_CTR_H
+#define TR2_CTR_H
+
+#include "trace2.h"
+#include "trace2/tr2_tgt.h"
+
+/*
+ * Define a mechanism to allow global "counters".
+ *
+ * Counters can be used to count interesting activity that does not fit
+ * the "region and data" model, such as code called from many different
+ * regions and/or where data for individual calls are not interesting
+ * or are too numerous to be efficiently logged.
+ *
+ * Counter values are accumulated in each thread's TLS data and summed
+ * across all threads when they exit, so incrementing a counter does
+ * not need a lock.
+ */
+
+/*
+ * The properties of a counter, indexed by `enum trace2_counter_id`.
+ */
+struct tr2_counter_metadata {
+	const char *category;
+	const char *name;
+
+	/*
+	 * True if the counter should also emit a "th_counter" event for
+	 * each thread that used it, in addition to the process-wide
+	 * "counter" summary.
+	 */
+	unsigned int want_per_thread_events:1;
+};
+
+struct tr2_counter {
+	uint64_t value;
+};
+
+/*
+ * The counters of a thread, or the sum over all threads.
+ */
+struct tr2_counter_block {
+	struct tr2_counter counter[TRACE2_NUMBER_OF_COUNTERS];
+};
+
+/*
+ * Add `value` to the given counter of the current thread.
+ */
+void tr2_counter_increment(enum trace2_counter_id cid, uint64_t value);
+
+/*
+ * Add the counters of the current thread to the process-wide sums.
+ * This is called when a thread exits, and for the main thread at
+ * exit.
+ */
+void tr2_update_final_counters(void);
+
+/*
+ * Emit a "th_counter" event for each of the current thread's counters
+ * that asked for per-thread events and is not zero.
+ */
+void tr2_emit_per_thread_counters(tr2_tgt_evt_counter_t *fn_apply);
+
+/*
+ * Emit a "counter" event for each counter that is not zero.
+ */
+void tr2_emit_final_counters(tr2_tgt_evt_counter_t *fn_apply);
+
+#endif /* TR2_CTR_H */
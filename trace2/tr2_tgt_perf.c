@@ -10,6 +10,8 @@
 #include "trace2/tr2_tbuf.h"
 #include "trace2/tr2_tgt.h"
 #include "trace2/tr2_tls.h"
+#include "trace2/tr2_tmr.h"
+#include "trace2/tr2_ctr.h"
 
 static struct tr2_dst tr2dst_perf = { TR2_SYSENV_PERF, 0, 0, 0, 0 };
 
@@ -519,6 +521,43 @@ static void fn_printf_va_fl(const char *file, int line,
 	strbuf_release(&buf_payload);
 }
 
+static void fn_timer(const struct tr2_timer_metadata *meta,
+		     const struct tr2_timer *timer,
+		     int is_final_data)
+{
+	const char *event_name = is_final_data ? "timer" : "th_timer";
+	struct strbuf buf_payload = STRBUF_INIT;
+	uint64_t us_elapsed_absolute = tr2tls_absolute_elapsed(getnanotime() / 1000);
+
+	strbuf_addf(&buf_payload, "name:%s", meta->name);
+	strbuf_addf(&buf_payload, " intervals:%"PRIu64, timer->interval_count);
+	strbuf_addf(&buf_payload, " total:%8.6f", ((double)timer->total_ns) / 1000000000.0);
+	strbuf_addf(&buf_payload, " min:%8.6f", ((double)timer->min_ns) / 1000000000.0);
+	strbuf_addf(&buf_payload, " max:%8.6f", ((double)timer->max_ns) / 1000000000.0);
+
+	perf_io_write_fl(__FILE__, __LINE__, event_name, NULL,
+			 &us_elapsed_absolute, NULL, meta->category,
+			 &buf_payload);
+	strbuf_release(&buf_payload);
+}
+
+static void fn_counter(const struct tr2_counter_metadata *meta,
+		       const struct tr2_counter *counter,
+		       int is_final_data)
+{
+	const char *event_name = is_final_data ? "counter" : "th_counter";
+	struct strbuf buf_payload = STRBUF_INIT;
+	uint64_t us_elapsed_absolute = tr2tls_absolute_elapsed(getnanotime() / 1000);
+
+	strbuf_addf(&buf_payload, "name:%s", meta->name);
+	strbuf_addf(&buf_payload, " value:%"PRIu64, counter->value);
+
+	perf_io_write_fl(__FILE__, __LINE__, event_name, NULL,
+			 &us_elapsed_absolute, NULL, meta->category,
+			 &buf_payload);
+	strbuf_release(&buf_payload);
+}
+
 struct tr2_tgt tr2_tgt_perf = {
 	&tr2dst_perf,
 
@@ -548,4 +587,6 @@ struct tr2_tgt tr2_tgt_perf = {
 	fn_data_fl,
 	fn_data_json_fl,
 	fn_printf_va_fl,
+	fn_timer,
+	fn_counter,
 };
@@ -2,6 +2,8 @@
 #define TR2_TLS_H
 
 #include "strbuf.h"
+#include "trace2/tr2_ctr.h"
+#include "trace2/tr2_tmr.h"
 
 /*
  * Arbitry limit for thread names for column alignment.
@@ -14,6 +16,9 @@ struct tr2tls_thread_ctx {
 	int alloc;
 	int nr_open_regions; /* plays role of "nr" in ALLOC_GROW */
 	int thread_id;
+
+	struct tr2_timer_block timer_block;
+	struct tr2_counter_block counter_block;
 };
 
 /*
@@ -95,6 +100,13 @@ void tr2tls_release(void);
  */
 int tr2tls_locked_increment(int *p);
 
+/*
+ * Lock and unlock the mutex that protects the process-wide sums of
+ * the timers and counters.
+ */
+void tr2tls_lock(void);
+void tr2tls_unlock(void);
+
 /*
  * Capture the process start time and do nothing else.
  */
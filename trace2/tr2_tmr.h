@@ -0,0 +1,80 @@
+#ifndef TR2_TMR_H
+#define TR2_TMR_H
+
+#include "trace2.h"
+#include "trace2/tr2_tgt.h"
+
+/*
+ * Define a mechanism to allow "stopwatch" timers.
+ *
+ * Timers can be used to measure "interesting" activity that does not
+ * fit the "region" model, such as code called from many different
+ * regions (like zlib) and/or where data for individual calls to the
+ * code are not interesting or are too numerous to be efficiently
+ * logged.
+ *
+ * Timer values are accumulated in each thread's TLS data and summed
+ * across all threads when they exit. There is no need for a lock
+ * while a timer is running.
+ */
+
+/*
+ * The properties of a timer, indexed by `enum trace2_timer_id`.
+ */
+struct tr2_timer_metadata {
+	const char *category;
+	const char *name;
+
+	/*
+	 * True if the timer should also emit a "th_timer" event for
+	 * each thread that used it, in addition to the process-wide
+	 * "timer" summary.
+	 */
+	unsigned int want_per_thread_events:1;
+};
+
+/*
+ * A timer that accumulates intervals. Nested calls of the same timer
+ * on one thread only measure the outermost interval.
+ */
+struct tr2_timer {
+	uint64_t recursion_count;
+	uint64_t start_ns;
+	uint64_t total_ns;
+	uint64_t min_ns;
+	uint64_t max_ns;
+	uint64_t interval_count;
+};
+
+/*
+ * The timers of a thread, or the sum over all threads.
+ */
+struct tr2_timer_block {
+	struct tr2_timer timer[TRACE2_NUMBER_OF_TIMERS];
+};
+
+/*
+ * Start or stop the given timer on the current thread.
+ */
+void tr2_start_timer(enum trace2_timer_id tid);
+void tr2_stop_timer(enum trace2_timer_id tid);
+
+/*
+ * Add the timers of the current thread to the process-wide sums.
+ * This is called when a thread exits, and for the main thread at
+ * exit.
+ */
+void tr2_update_final_timers(void);
+
+/*
+ * Emit a "th_timer" event for each of the current thread's timers
+ * that asked for per-thread events and was used.
+ */
+void tr2_emit_per_thread_timers(tr2_tgt_evt_timer_t *fn_apply);
+
+/*
+ * Emit a "timer" event for each timer that was used by any thread.
+ */
+void tr2_emit_final_timers(tr2_tgt_evt_timer_t *fn_apply);
+
+#endif /* TR2_TMR_H */
@@ -1264,13 +1264,28 @@ static struct ref *get_refs_list_using_list(struct transport *transport,
 	return ret;
 }
 
+static int get_object_info(struct transport *transport,
+			   const struct oid_array *oids,
+			   unsigned long *sizes, enum object_type *types)
+{
+	get_helper(transport);
+
+	if (process_connect(transport, 0)) {
+		do_take_over(transport);
+		return transport->vtable->get_object_info(transport, oids,
+							  sizes, types);
+	}
+	return -1;
+}
+
 static struct transport_vtable vtable = {
 	set_helper_option,
 	get_refs_list,
 	fetch,
 	push_refs,
 	connect_helper,
-	release_helper
+	release_helper,
+	get_object_info
 };
 
 int transport_helper_init(struct transport *transport, const char *name)
@@ -4,6 +4,7 @@
 struct ref;
 struct transport;
 struct strvec;
+struct oid_array;
 
 struct transport_vtable {
 	/**
@@ -65,6 +66,16 @@ struct transport_vtable {
 	 * use. disconnect() releases these resources.
 	 **/
 	int (*disconnect)(struct transport *connection);
+
+	/**
+	 * Ask the remote side for the sizes and types of the given
+	 * objects without fetching them. Returns -1 if the transport or
+	 * the remote side cannot do this; see
+	 * transport_get_object_info().
+	 **/
+	int (*get_object_info)(struct transport *transport,
+			       const struct oid_array *oids,
+			       unsigned long *sizes, enum object_type *types);
 };
 
 #endif
@@ -360,6 +360,7 @@ static int fetch_refs_via_pack(struct transport *transport,
 	args.stateless_rpc = transport->stateless_rpc;
 	args.server_options = transport->server_options;
 	args.negotiation_tips = data->options.negotiation_tips;
+	args.prefetched_refs = data->options.prefetched_refs;
 
 	if (!data->got_remote_heads) {
 		int i;
@@ -403,6 +404,28 @@ static int fetch_refs_via_pack(struct transport *transport,
 	return ret;
 }
 
+static int get_object_info_via_connect(struct transport *transport,
+				       const struct oid_array *oids,
+				       unsigned long *sizes,
+				       enum object_type *types)
+{
+	struct git_transport_data *data = transport->data;
+	struct packet_reader reader;
+
+	if (!data->got_remote_heads)
+		handshake(transport, 0, NULL, 0);
+	if (data->version != protocol_v2)
+		return -1;
+
+	packet_reader_init(&reader, data->fd[0], NULL, 0,
+			   PACKET_READ_CHOMP_NEWLINE |
+			   PACKET_READ_GENTLE_ON_EOF |
+			   PACKET_READ_DIE_ON_ERR_PACKET);
+	return get_remote_object_info(data->fd[1], &reader, oids, sizes, types,
+				      transport->server_options,
+				      transport->stateless_rpc);
+}
+
 static int push_had_errors(struct ref *ref)
 {
 	for (; ref; ref = ref->next) {
@@ -842,7 +865,8 @@ static struct transport_vtable taken_over_vtable = {
 	fetch_refs_via_pack,
 	git_transport_push,
 	NULL,
-	disconnect_git
+	disconnect_git,
+	get_object_info_via_connect
 };
 
 void transport_take_over(struct transport *transport,
@@ -991,7 +1015,8 @@ static struct transport_vtable bundle_vtable = {
 	fetch_refs_from_bundle,
 	NULL,
 	NULL,
-	close_bundle
+	close_bundle,
+	NULL
 };
 
 static struct transport_vtable builtin_smart_vtable = {
@@ -1000,7 +1025,8 @@ static struct transport_vtable builtin_smart_vtable = {
 	fetch_refs_via_pack,
 	git_transport_push,
 	connect_git,
-	disconnect_git
+	disconnect_git,
+	get_object_info_via_connect
 };
 
 struct transport *transport_get(struct remote *remote, const char *url)
@@ -1428,6 +1454,16 @@ int transport_connect(struct transport *transport, const char *name,
 		die(_("operation not supported by protocol"));
 }
 
+int transport_get_object_info(struct transport *transport,
+			      const struct oid_array *oids,
+			      unsigned long *sizes, enum object_type *types)
+{
+	if (!transport->vtable->get_object_info)
+		return -1;
+	return transport->vtable->get_object_info(transport, oids,
+						  sizes, types);
+}
+
 int transport_disconnect(struct transport *transport)
 {
 	int ret = 0;
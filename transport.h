@@ -46,6 +46,13 @@ struct git_transport_options {
 	 * transport_set_option().
 	 */
 	struct oid_array *negotiation_tips;
+
+	/*
+	 * This is only used during fetch. See the documentation of
+	 * prefetched_refs in struct fetch_pack_args. Like
+	 * negotiation_tips, set this field directly.
+	 */
+	struct ref *prefetched_refs;
 };
 
 enum transport_family {
@@ -249,6 +256,18 @@ const struct git_hash_algo *transport_get_hash_algo(struct transport *transport)
 int transport_fetch_refs(struct transport *transport, struct ref *refs);
 void transport_unlock_pack(struct transport *transport);
 int transport_disconnect(struct transport *transport);
+
+/*
+ * Ask the remote for the sizes and types of "oids" with the protocol v2
+ * "object-info" command, without fetching the objects. On success, sizes[i]
+ * and types[i] describe oids->oid[i], or types[i] is OBJ_BAD if the remote
+ * does not have it, and 0 is returned. Returns -1 if the remote does not
+ * support "object-info". The connection is kept for further requests until
+ * transport_disconnect() is called.
+ */
+int transport_get_object_info(struct transport *transport,
+			      const struct oid_array *oids,
+			      unsigned long *sizes, enum object_type *types);
 char *transport_anonymize_url(const char *url);
 void transport_take_over(struct transport *transport,
 			 struct child_process *child);
@@ -27,6 +27,8 @@
 #include "commit-graph.h"
 #include "commit-reach.h"
 #include "shallow.h"
+#include "tempfile.h"
+#include "dir.h"
 
 /* Remember to update object flag allocation in object.h */
 #define THEY_HAVE	(1u << 11)
@@ -99,6 +101,8 @@ struct upload_pack_data {
 	unsigned daemon_mode : 1;				/* v0 only */
 	unsigned filter_capability_requested : 1;		/* v0 only */
 
+	unsigned long pack_cache_limit;
+	unsigned use_pack_cache : 1;
 	unsigned use_thin_pack : 1;
 	unsigned use_ofs_delta : 1;
 	unsigned no_progress : 1;
@@ -141,6 +145,7 @@ static void upload_pack_data_init(struct upload_pack_data *data)
 	packet_writer_init(&data->writer, 1);
 
 	data->keepalive = 5;
+	data->pack_cache_limit = 1024 * 1024 * 1024;
 }
 
 static void upload_pack_data_clear(struct upload_pack_data *data)
@@ -184,9 +189,9 @@ static void send_client_data(int fd, const char *data, ssize_t sz,
 
 static int write_one_shallow(const struct commit_graft *graft, void *cb_data)
 {
-	FILE *fp = cb_data;
+	struct strbuf *buf = cb_data;
 	if (graft->nr_parent == -1)
-		fprintf(fp, "--shallow %s\n", oid_to_hex(&graft->oid));
+		strbuf_addf(buf, "--shallow %s\n", oid_to_hex(&graft->oid));
 	return 0;
 }
 
@@ -195,8 +200,25 @@ struct output_state {
 	int used;
 	unsigned packfile_uris_started : 1;
 	unsigned packfile_started : 1;
+
+	/* pack cache entry being written, if any */
+	struct tempfile *cache;
 };
 
+/*
+ * Send pack data to the client, and also record it in the pack cache
+ * entry we are writing (if any). A failure to write the cache entry is
+ * not fatal; we simply stop caching this response.
+ */
+static void send_pack_data(struct output_state *os, const char *data,
+			   ssize_t sz, int use_sideband)
+{
+	send_client_data(1, data, sz, use_sideband);
+	if (os->cache &&
+	    write_in_full(get_tempfile_fd(os->cache), data, sz) < 0)
+		delete_tempfile(&os->cache);
+}
+
 static int relay_pack_data(int pack_objects_out, struct output_state *os,
 			   int use_sideband, int write_packfile_line)
 {
@@ -251,17 +273,181 @@ static int relay_pack_data(int pack_objects_out, struct output_state *os,
 	}
 
 	if (os->used > 1) {
-		send_client_data(1, os->buffer, os->used - 1, use_sideband);
+		send_pack_data(os, os->buffer, os->used - 1, use_sideband);
 		os->buffer[0] = os->buffer[os->used - 1];
 		os->used = 1;
 	} else {
-		send_client_data(1, os->buffer, os->used, use_sideband);
+		send_pack_data(os, os->buffer, os->used, use_sideband);
 		os->used = 0;
 	}
 
 	return readsz;
 }
 
+/*
+ * The pack cache stores the output of pack-objects in
+ * "$GIT_DIR/upload-pack-cache", so that an identical request (e.g., a
+ * fresh clone of the default branch) can be answered by streaming the
+ * stored pack instead of enumerating and compressing objects again.
+ *
+ * Entries are named "<refs>-<request>.pack", where <refs> is a hash of
+ * all refs we advertise and <request> is a hash of the pack-objects
+ * arguments and input. Any ref update therefore changes the name under
+ * which a request is looked up, and entries written for an older set
+ * of refs are removed when a new entry is stored.
+ */
+static int hash_one_ref(const char *refname, const struct object_id *oid,
+			int flag, void *cb_data)
+{
+	git_hash_ctx *ctx = cb_data;
+
+	the_hash_algo->update_fn(ctx, refname, strlen(refname) + 1);
+	the_hash_algo->update_fn(ctx, oid->hash, the_hash_algo->rawsz);
+	return 0;
+}
+
+static void pack_cache_path(struct strbuf *path, const struct strvec *args,
+			    const struct strbuf *input)
+{
+	git_hash_ctx ctx;
+	unsigned char hash[GIT_MAX_RAWSZ];
+	int i;
+
+	strbuf_addstr(path, git_path("upload-pack-cache/"));
+
+	the_hash_algo->init_fn(&ctx);
+	head_ref_namespaced(hash_one_ref, &ctx);
+	for_each_namespaced_ref(hash_one_ref, &ctx);
+	the_hash_algo->final_fn(hash, &ctx);
+	strbuf_addf(path, "%s-", hash_to_hex(hash));
+
+	the_hash_algo->init_fn(&ctx);
+	for (i = 0; i < args->nr; i++) {
+		/* progress goes to stderr and does not affect the pack */
+		if (!strcmp(args->v[i], "--progress"))
+			continue;
+		the_hash_algo->update_fn(&ctx, args->v[i],
+					 strlen(args->v[i]) + 1);
+	}
+	the_hash_algo->update_fn(&ctx, input->buf, input->len);
+	the_hash_algo->final_fn(hash, &ctx);
+	strbuf_addf(path, "%s.pack", hash_to_hex(hash));
+}
+
+struct pack_cache_entry {
+	char *name;
+	off_t size;
+	timestamp_t mtime;
+};
+
+static int pack_cache_entry_newer(const void *va, const void *vb)
+{
+	const struct pack_cache_entry *a = va, *b = vb;
+
+	if (a->mtime != b->mtime)
+		return a->mtime < b->mtime ? 1 : -1;
+	return strcmp(a->name, b->name);
+}
+
+/*
+ * Remove cache entries that were written for a different set of refs
+ * than the entry at "path", and then the least recently used entries
+ * until the remaining ones fit in "limit" bytes. Serving an entry
+ * refreshes its mtime, which is what "least recently used" goes by.
+ */
+static void prune_pack_cache(const char *path, unsigned long limit)
+{
+	const char *base = strrchr(path, '/') + 1;
+	size_t refs_len = strchr(base, '-') - base + 1;
+	struct strbuf buf = STRBUF_INIT;
+	struct pack_cache_entry *entries = NULL;
+	size_t nr = 0, alloc = 0, i;
+	uintmax_t total = 0;
+	size_t dirlen;
+	struct dirent *de;
+	DIR *dir;
+
+	strbuf_add(&buf, path, base - path);
+	dirlen = buf.len;
+	dir = opendir(buf.buf);
+	if (!dir) {
+		strbuf_release(&buf);
+		return;
+	}
+	while ((de = readdir(dir)) != NULL) {
+		struct stat st;
+
+		if (!ends_with(de->d_name, ".pack"))
+			continue;
+		strbuf_setlen(&buf, dirlen);
+		strbuf_addstr(&buf, de->d_name);
+		if (strncmp(de->d_name, base, refs_len)) {
+			unlink_or_warn(buf.buf);
+			continue;
+		}
+		if (stat(buf.buf, &st))
+			continue;
+		ALLOC_GROW(entries, nr + 1, alloc);
+		entries[nr].name = xstrdup(de->d_name);
+		entries[nr].size = st.st_size;
+		entries[nr].mtime = st.st_mtime;
+		nr++;
+	}
+	closedir(dir);
+
+	QSORT(entries, nr, pack_cache_entry_newer);
+	for (i = 0; i < nr; i++) {
+		total += entries[i].size;
+		if (total > limit) {
+			strbuf_setlen(&buf, dirlen);
+			strbuf_addstr(&buf, entries[i].name);
+			unlink_or_warn(buf.buf);
+		}
+		free(entries[i].name);
+	}
+	free(entries);
+	strbuf_release(&buf);
+}
+
+static struct tempfile *create_pack_cache_entry(const char *path)
+{
+	struct strbuf tmpl = STRBUF_INIT;
+	struct tempfile *tmp;
+
+	if (safe_create_leading_directories_const(path))
+		return NULL;
+	strbuf_add(&tmpl, path, strrchr(path, '/') + 1 - path);
+	strbuf_addstr(&tmpl, "tmp_pack_XXXXXX");
+	tmp = mks_tempfile(tmpl.buf);
+	strbuf_release(&tmpl);
+	return tmp;
+}
+
+/*
+ * Stream the cached pack at "path" to the client. Returns -1 if there is
+ * no usable entry (in which case nothing has been sent), 1 if reading
+ * failed after we started sending, and 0 on success.
+ */
+static int send_cached_pack(const char *path, int use_sideband)
+{
+	char buf[LARGE_PACKET_DATA_MAX];
+	ssize_t sz;
+	int fd = open(path, O_RDONLY);
+
+	if (fd < 0)
+		return -1;
+	/* mark the entry as recently used for prune_pack_cache() */
+	utime(path, NULL);
+	while ((sz = xread(fd, buf, sizeof(buf))) > 0)
+		send_client_data(1, buf, sz, use_sideband);
+	close(fd);
+	if (sz < 0) {
+		error_errno("unable to read cached pack '%s'", path);
+		return 1;
+	}
+	return 0;
+}
+
 static void create_pack_file(struct upload_pack_data *pack_data,
 			     const struct string_list *uri_protocols)
 {
@@ -270,9 +456,10 @@ static void create_pack_file(struct upload_pack_data *pack_data,
 	char progress[128];
 	char abort_msg[] = "aborting due to possible repository "
 		"corruption on the remote side.";
+	struct strbuf input = STRBUF_INIT;
+	struct strbuf cache_path = STRBUF_INIT;
 	ssize_t sz;
 	int i;
-	FILE *pipe_fd;
 
 	if (!pack_data->pack_objects_hook)
 		pack_objects.git_cmd = 1;
@@ -318,6 +505,41 @@ static void create_pack_file(struct upload_pack_data *pack_data,
 					 uri_protocols->items[i].string);
 	}
 
+	if (pack_data->shallow_nr)
+		for_each_commit_graft(write_one_shallow, &input);
+
+	for (i = 0; i < pack_data->want_obj.nr; i++)
+		strbuf_addf(&input, "%s\n",
+			    oid_to_hex(&pack_data->want_obj.objects[i].item->oid));
+	strbuf_addstr(&input, "--not\n");
+	for (i = 0; i < pack_data->have_obj.nr; i++)
+		strbuf_addf(&input, "%s\n",
+			    oid_to_hex(&pack_data->have_obj.objects[i].item->oid));
+	for (i = 0; i < pack_data->extra_edge_obj.nr; i++)
+		strbuf_addf(&input, "%s\n",
+			    oid_to_hex(&pack_data->extra_edge_obj.objects[i].item->oid));
+	strbuf_addch(&input, '\n');
+
+	/*
+	 * packfile-uris responses interleave out-of-band lines with the
+	 * pack data, so we do not cache them.
+	 */
+	if (pack_data->use_pack_cache && !uri_protocols) {
+		pack_cache_path(&cache_path, &pack_objects.args, &input);
+		switch (send_cached_pack(cache_path.buf,
+					 pack_data->use_sideband)) {
+		case 0:
+			trace2_data_string("upload-pack", the_repository,
+					   "pack-cache", "hit");
+			goto done;
+		case 1:
+			goto fail;
+		}
+		trace2_data_string("upload-pack", the_repository,
+				   "pack-cache", "miss");
+		output_state.cache = create_pack_cache_entry(cache_path.buf);
+	}
+
 	pack_objects.in = -1;
 	pack_objects.out = -1;
 	pack_objects.err = -1;
@@ -325,24 +547,12 @@ static void create_pack_file(struct upload_pack_data *pack_data,
 	if (start_command(&pack_objects))
 		die("git upload-pack: unable to fork git-pack-objects");
 
-	pipe_fd = xfdopen(pack_objects.in, "w");
-
-	if (pack_data->shallow_nr)
-		for_each_commit_graft(write_one_shallow, pipe_fd);
-
-	for (i = 0; i < pack_data->want_obj.nr; i++)
-		fprintf(pipe_fd, "%s\n",
-			oid_to_hex(&pack_data->want_obj.objects[i].item->oid));
-	fprintf(pipe_fd, "--not\n");
-	for (i = 0; i < pack_data->have_obj.nr; i++)
-		fprintf(pipe_fd, "%s\n",
-			oid_to_hex(&pack_data->have_obj.objects[i].item->oid));
-	for (i = 0; i < pack_data->extra_edge_obj.nr; i++)
-		fprintf(pipe_fd, "%s\n",
-			oid_to_hex(&pack_data->extra_edge_obj.objects[i].item->oid));
-	fprintf(pipe_fd, "\n");
-	fflush(pipe_fd);
-	fclose(pipe_fd);
+	/*
+	 * A write error here means pack-objects went away early; we notice
+	 * (and relay its complaints) when collecting its output below.
+	 */
+	write_in_full(pack_objects.in, input.buf, input.len);
+	close(pack_objects.in);
 
 	/* We read from pack_objects.err to capture stderr output for
 	 * progress bar, and pack_objects.out to capture the pack data.
@@ -442,12 +652,22 @@ static void create_pack_file(struct upload_pack_data *pack_data,
 
 	/* flush the data */
 	if (output_state.used > 0) {
-		send_client_data(1, output_state.buffer, output_state.used,
-				 pack_data->use_sideband);
+		send_pack_data(&output_state, output_state.buffer,
+			       output_state.used, pack_data->use_sideband);
 		fprintf(stderr, "flushed.\n");
 	}
+	if (output_state.cache &&
+	    fsync(get_tempfile_fd(output_state.cache)) < 0)
+		delete_tempfile(&output_state.cache);
+	if (output_state.cache &&
+	    !rename_tempfile(&output_state.cache, cache_path.buf))
+		prune_pack_cache(cache_path.buf, pack_data->pack_cache_limit);
+
+done:
 	if (pack_data->use_sideband)
 		packet_flush(1);
+	strbuf_release(&input);
+	strbuf_release(&cache_path);
 	return;
 
  fail:
@@ -1298,6 +1518,10 @@ static int upload_pack_config(const char *var, const char *value, void *cb_data)
 		data->allow_ref_in_want = git_config_bool(var, value);
 	} else if (!strcmp("uploadpack.allowsidebandall", var)) {
 		data->allow_sideband_all = git_config_bool(var, value);
+	} else if (!strcmp("uploadpack.packcache", var)) {
+		data->use_pack_cache = git_config_bool(var, value);
+	} else if (!strcmp("uploadpack.packcachelimit", var)) {
+		data->pack_cache_limit = git_config_ulong(var, value);
 	} else if (!strcmp("core.precomposeunicode", var)) {
 		precomposed_unicode = git_config_bool(var, value);
 	}
@@ -146,6 +146,89 @@ int xdi_diff_outf(mmfile_t *mf1, mmfile_t *mf2,
 	return ret;
 }
 
+struct line_cache_entry {
+	struct oidmap_entry ent;
+	struct list_head lru;
+	xdlinehash_t lh;
+	size_t charged;
+};
+
+static void charge_line_cache_entry(struct xdiff_line_cache *cache,
+				    struct line_cache_entry *e)
+{
+	size_t size = e->lh.nrec * (sizeof(*e->lh.ends) + sizeof(*e->lh.ha));
+
+	cache->used += size - e->charged;
+	e->charged = size;
+}
+
+void xdiff_line_cache_init(struct xdiff_line_cache *cache, size_t budget)
+{
+	oidmap_init(&cache->map, 0);
+	INIT_LIST_HEAD(&cache->lru);
+	cache->budget = budget;
+	cache->used = 0;
+}
+
+xdlinehash_t *xdiff_line_cache_get(struct xdiff_line_cache *cache,
+				   const struct object_id *oid)
+{
+	struct line_cache_entry *e;
+	struct list_head *pos;
+	int n = 0;
+
+	/*
+	 * Only the entries handed out by the last two calls can have
+	 * been filled in by xdiff since we last looked.
+	 */
+	list_for_each(pos, &cache->lru) {
+		if (n++ == 2)
+			break;
+		charge_line_cache_entry(cache,
+					list_entry(pos, struct line_cache_entry, lru));
+	}
+
+	e = oidmap_get(&cache->map, oid);
+	if (e) {
+		list_del(&e->lru);
+	} else {
+		e = xcalloc(1, sizeof(*e));
+		oidcpy(&e->ent.oid, oid);
+		oidmap_put(&cache->map, e);
+	}
+	list_add(&e->lru, &cache->lru);
+
+	while (cache->used > cache->budget) {
+		struct line_cache_entry *victim =
+			list_entry(cache->lru.prev, struct line_cache_entry, lru);
+
+		if (cache->lru.next == &victim->lru ||
+		    cache->lru.next->next == &victim->lru)
+			break;
+		list_del(&victim->lru);
+		oidmap_remove(&cache->map, &victim->ent.oid);
+		cache->used -= victim->charged;
+		xdl_free_line_hash(&victim->lh);
+		free(victim);
+	}
+	return &e->lh;
+}
+
+void xdiff_line_cache_clear(struct xdiff_line_cache *cache)
+{
+	struct list_head *pos, *tmp;
+
+	list_for_each_safe(pos, tmp, &cache->lru) {
+		struct line_cache_entry *e =
+			list_entry(pos, struct line_cache_entry, lru);
+
+		xdl_free_line_hash(&e->lh);
+		free(e);
+	}
+	oidmap_free(&cache->map, 0);
+	xdiff_line_cache_init(cache, cache->budget);
+}
+
 int read_mmfile(mmfile_t *ptr, const char *filename)
 {
 	struct stat st;
@@ -3,6 +3,8 @@
 
 #include "cache.h"
 #include "xdiff/xdiff.h"
+#include "list.h"
+#include "oidmap.h"
 
 /*
  * xdiff isn't equipped to handle content over a gigabyte;
@@ -23,6 +25,24 @@ int xdi_diff_outf(mmfile_t *mf1, mmfile_t *mf2,
 		  xdiff_emit_line_fn line_fn,
 		  void *consume_callback_data,
 		  xpparam_t const *xpp, xdemitconf_t const *xecfg);
+/*
+ * Line hashes (see xdlinehash_t) of blobs, for callers that diff the
+ * same blobs many times, like blame.  Once the hashes take up more than
+ * "budget" bytes, those used least recently are dropped; the two looked
+ * up last are always kept, so that both sides of a diff can be taken
+ * from the cache.
+ */
+struct xdiff_line_cache {
+	struct oidmap map;
+	struct list_head lru;
+	size_t budget, used;
+};
+
+void xdiff_line_cache_init(struct xdiff_line_cache *cache, size_t budget);
+xdlinehash_t *xdiff_line_cache_get(struct xdiff_line_cache *cache,
+				   const struct object_id *oid);
+void xdiff_line_cache_clear(struct xdiff_line_cache *cache);
+
 int read_mmfile(mmfile_t *ptr, const char *filename);
 void read_mmblob(mmfile_t *ptr, const struct object_id *oid);
 int buffer_is_binary(const char *ptr, unsigned long size);
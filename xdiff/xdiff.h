@@ -43,7 +43,8 @@ extern "C" {
 
 #define XDF_PATIENCE_DIFF (1 << 14)
 #define XDF_HISTOGRAM_DIFF (1 << 15)
-#define XDF_DIFF_ALGORITHM_MASK (XDF_PATIENCE_DIFF | XDF_HISTOGRAM_DIFF)
+#define XDF_CHUNKED_DIFF (1 << 16)
+#define XDF_DIFF_ALGORITHM_MASK (XDF_PATIENCE_DIFF | XDF_HISTOGRAM_DIFF | XDF_CHUNKED_DIFF)
 #define XDF_DIFF_ALG(x) ((x) & XDF_DIFF_ALGORITHM_MASK)
 
 #define XDF_INDENT_HEURISTIC (1 << 23)
@@ -76,12 +77,29 @@ typedef struct s_mmbuffer {
 	long size;
 } mmbuffer_t;
 
+/*
+ * Where each line of a file ends, and the hash of the line under the
+ * given whitespace flags.  A caller that diffs the same content over and
+ * over can keep one of these around for it and pass it in xpparam_t, so
+ * that the lines are split and hashed only once.  Start out with all
+ * zeroes and release with xdl_free_line_hash().
+ */
+typedef struct s_xdlinehash {
+	long nrec;
+	unsigned long flags;
+	long *ends;
+	unsigned long *ha;
+} xdlinehash_t;
+
 typedef struct s_xpparam {
 	unsigned long flags;
 
 	/* See Documentation/diff-options.txt. */
 	char **anchors;
 	size_t anchors_nr;
+
+	/* Optional line hashes for the first and second file. */
+	xdlinehash_t *line_hash1, *line_hash2;
 } xpparam_t;
 
 typedef struct s_xdemitcb {
@@ -120,6 +138,8 @@ typedef struct s_bdiffparam {
 void *xdl_mmfile_first(mmfile_t *mmf, long *size);
 long xdl_mmfile_size(mmfile_t *mmf);
 
+void xdl_free_line_hash(xdlinehash_t *lh);
+
 int xdl_diff(mmfile_t *mf1, mmfile_t *mf2, xpparam_t const *xpp,
 	     xdemitconf_t const *xecfg, xdemitcb_t *ecb);
 
@@ -309,6 +309,107 @@ int xdl_recs_cmp(diffdata_t *dd1, long off1, long lim1,
 }
 
 
+/*
+ * Split the files at the longest ordered sequence of lines that occur
+ * exactly once in either file, the way patience diff starts out, and
+ * run xdl_recs_cmp() on each region between two such anchors.  Unlike
+ * the patience algorithm, this does not recurse into the regions, so
+ * the whole job takes a single pass over the lines to find the anchors
+ * (O(N log N) for the ordering) and memory linear in the number of
+ * lines, and the Myers algorithm is left with many small boxes instead
+ * of one huge one.
+ */
+static int xdl_recs_cmp_chunked(xdfenv_t *xe, diffdata_t *dd1, diffdata_t *dd2,
+				long *kvdf, long *kvdb, int need_min,
+				xdalgoenv_t *xenv) {
+	long i, c, nclass = 0, nanchors = 0, longest = 0;
+	long *cnt1, *cnt2, *pos2, *a1, *a2, *tails, *prev;
+	long off1, off2;
+	int ret = -1;
+
+	for (i = 0; i < xe->xdf1.nrec; i++)
+		if ((long) xe->xdf1.recs[i]->ha >= nclass)
+			nclass = xe->xdf1.recs[i]->ha + 1;
+	for (i = 0; i < xe->xdf2.nrec; i++)
+		if ((long) xe->xdf2.recs[i]->ha >= nclass)
+			nclass = xe->xdf2.recs[i]->ha + 1;
+
+	if (!(cnt1 = (long *) xdl_malloc((3 * nclass + 1) * sizeof(long))))
+		return -1;
+	cnt2 = cnt1 + nclass;
+	pos2 = cnt2 + nclass;
+	memset(cnt1, 0, 2 * nclass * sizeof(long));
+	for (i = 0; i < nclass; i++)
+		pos2[i] = -1;
+	for (i = 0; i < xe->xdf1.nrec; i++)
+		cnt1[xe->xdf1.recs[i]->ha]++;
+	for (i = 0; i < xe->xdf2.nrec; i++)
+		cnt2[xe->xdf2.recs[i]->ha]++;
+	for (i = 0; i < dd2->nrec; i++)
+		pos2[dd2->ha[i]] = i;
+
+	/*
+	 * Candidate anchors, in the order of the first file; "tails[k]"
+	 * is the candidate ending the best increasing run of length k+1
+	 * found so far and "prev" links each candidate to its predecessor
+	 * in that run.
+	 */
+	if (!(a1 = (long *) xdl_malloc((4 * dd1->nrec + 1) * sizeof(long)))) {
+		xdl_free(cnt1);
+		return -1;
+	}
+	a2 = a1 + dd1->nrec;
+	tails = a2 + dd1->nrec;
+	prev = tails + dd1->nrec;
+	for (i = 0; i < dd1->nrec; i++) {
+		long lo = 0, hi = longest;
+
+		c = dd1->ha[i];
+		if (cnt1[c] != 1 || cnt2[c] != 1 || pos2[c] < 0)
+			continue;
+		a1[nanchors] = i;
+		a2[nanchors] = pos2[c];
+		while (lo < hi) {
+			long mid = lo + (hi - lo) / 2;
+
+			if (a2[tails[mid]] < a2[nanchors])
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		prev[nanchors] = lo ? tails[lo - 1] : -1;
+		tails[lo] = nanchors;
+		if (lo == longest)
+			longest++;
+		nanchors++;
+	}
+
+	/* Turn the predecessor links of the longest run into "next" links. */
+	for (c = -1, i = longest ? tails[longest - 1] : -1; i >= 0; ) {
+		long p = prev[i];
+
+		prev[i] = c;
+		c = i;
+		i = p;
+	}
+
+	for (off1 = off2 = 0; c >= 0; c = prev[c]) {
+		if (xdl_recs_cmp(dd1, off1, a1[c], dd2, off2, a2[c],
+				 kvdf, kvdb, need_min, xenv) < 0)
+			goto out;
+		off1 = a1[c] + 1;
+		off2 = a2[c] + 1;
+	}
+	ret = xdl_recs_cmp(dd1, off1, dd1->nrec, dd2, off2, dd2->nrec,
+			   kvdf, kvdb, need_min, xenv);
+
+out:
+	xdl_free(cnt1);
+	xdl_free(a1);
+	return ret;
+}
+
+
 int xdl_do_diff(mmfile_t *mf1, mmfile_t *mf2, xpparam_t const *xpp,
 		xdfenv_t *xe) {
 	long ndiags;
@@ -359,7 +460,10 @@ int xdl_do_diff(mmfile_t *mf1, mmfile_t *mf2, xpparam_t const *xpp,
 	dd2.rchg = xe->xdf2.rchg;
 	dd2.rindex = xe->xdf2.rindex;
 
-	if (xdl_recs_cmp(&dd1, 0, dd1.nrec, &dd2, 0, dd2.nrec,
+	if (XDF_DIFF_ALG(xpp->flags) == XDF_CHUNKED_DIFF ?
+	    xdl_recs_cmp_chunked(xe, &dd1, &dd2, kvdf, kvdb,
+				 (xpp->flags & XDF_NEED_MINIMAL) != 0, &xenv) < 0 :
+	    xdl_recs_cmp(&dd1, 0, dd1.nrec, &dd2, 0, dd2.nrec,
 			 kvdf, kvdb, (xpp->flags & XDF_NEED_MINIMAL) != 0, &xenv) < 0) {
 
 		xdl_free(kvd);
@@ -169,6 +169,10 @@ static int xdl_prepare_ctx(unsigned int pass, mmfile_t *mf, long narec, xpparam_
 	unsigned long *ha;
 	char *rchg;
 	long *rindex;
+	xdlinehash_t *lh = pass == 1 ? xpp->line_hash1 : xpp->line_hash2;
+	unsigned long wsflags = xpp->flags & XDF_WHITESPACE_FLAGS;
+	long ncached = 0, *lends = NULL;
+	unsigned long *lha = NULL;
 
 	ha = NULL;
 	rindex = NULL;
@@ -180,6 +184,10 @@ static int xdl_prepare_ctx(unsigned int pass, mmfile_t *mf, long narec, xpparam_
 		goto abort;
 	if (!(recs = (xrecord_t **) xdl_malloc(narec * sizeof(xrecord_t *))))
 		goto abort;
+	if (lh &&
+	    (!(lends = (long *) xdl_malloc(narec * sizeof(long))) ||
+	     !(lha = (unsigned long *) xdl_malloc(narec * sizeof(unsigned long)))))
+		goto abort;
 
 	if (XDF_DIFF_ALG(xpp->flags) == XDF_HISTOGRAM_DIFF)
 		hbits = hsize = 0;
@@ -193,14 +201,45 @@ static int xdl_prepare_ctx(unsigned int pass, mmfile_t *mf, long narec, xpparam_
 
 	nrec = 0;
 	if ((cur = blk = xdl_mmfile_first(mf, &bsize)) != NULL) {
+		/*
+		 * The caller may hand us the same content cut short at
+		 * a line boundary (see trim_common_tail()), or in full
+		 * after having cut it short before; only the lines that
+		 * fit in are taken from the cache.
+		 */
+		if (lh && lh->ends && lh->flags == wsflags) {
+			long lo = 0, hi = lh->nrec;
+
+			while (lo < hi) {
+				long mid = lo + (hi - lo) / 2;
+
+				if (lh->ends[mid] <= bsize)
+					lo = mid + 1;
+				else
+					hi = mid;
+			}
+			ncached = lo;
+		}
 		for (top = blk + bsize; cur < top; ) {
 			prev = cur;
-			hav = xdl_hash_record(&cur, top, xpp->flags);
+			if (nrec < ncached) {
+				cur = blk + lh->ends[nrec];
+				hav = lh->ha[nrec];
+			} else
+				hav = xdl_hash_record(&cur, top, xpp->flags);
 			if (nrec >= narec) {
 				narec *= 2;
 				if (!(rrecs = (xrecord_t **) xdl_realloc(recs, narec * sizeof(xrecord_t *))))
 					goto abort;
 				recs = rrecs;
+				if (lh &&
+				    (!(lends = (long *) xdl_realloc(lends, narec * sizeof(long))) ||
+				     !(lha = (unsigned long *) xdl_realloc(lha, narec * sizeof(unsigned long)))))
+					goto abort;
+			}
+			if (lh) {
+				lends[nrec] = cur - blk;
+				lha[nrec] = hav;
 			}
 			if (!(crec = xdl_cha_alloc(&xdf->rcha)))
 				goto abort;
@@ -215,6 +254,20 @@ static int xdl_prepare_ctx(unsigned int pass, mmfile_t *mf, long narec, xpparam_
 		}
 	}
 
+	/* Keep the line hashes if we went beyond what the cache knew. */
+	if (lh && (!lh->ends || lh->flags != wsflags || nrec > lh->nrec)) {
+		xdl_free_line_hash(lh);
+		lh->nrec = nrec;
+		lh->flags = wsflags;
+		lh->ends = lends;
+		lh->ha = lha;
+	} else {
+		xdl_free(lends);
+		xdl_free(lha);
+	}
+	lends = NULL;
+	lha = NULL;
+
 	if (!(rchg = (char *) xdl_malloc((nrec + 2) * sizeof(char))))
 		goto abort;
 	memset(rchg, 0, (nrec + 2) * sizeof(char));
@@ -238,6 +291,8 @@ static int xdl_prepare_ctx(unsigned int pass, mmfile_t *mf, long narec, xpparam_
 	return 0;
 
 abort:
+	xdl_free(lends);
+	xdl_free(lha);
 	xdl_free(ha);
 	xdl_free(rindex);
 	xdl_free(rchg);
@@ -319,6 +374,14 @@ void xdl_free_env(xdfenv_t *xe) {
 }
 
 
+void xdl_free_line_hash(xdlinehash_t *lh) {
+
+	xdl_free(lh->ends);
+	xdl_free(lh->ha);
+	memset(lh, 0, sizeof(*lh));
+}
+
+
 static int xdl_clean_mmatch(char const *dis, long i, long s, long e) {
 	long r, rdis0, rpdis0, rdis1, rpdis1;
 
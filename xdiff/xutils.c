@@ -297,15 +297,24 @@ static unsigned long xdl_hash_record_with_whitespace(char const **data,
 unsigned long xdl_hash_record(char const **data, char const *top, long flags) {
 	unsigned long ha = 5381;
 	char const *ptr = *data;
+	char const *eol;
 
 	if (flags & XDF_WHITESPACE_FLAGS)
 		return xdl_hash_record_with_whitespace(data, top, flags);
 
-	for (; ptr < top && *ptr != '\n'; ptr++) {
+	/*
+	 * Find the end of the line with memchr(), which is much faster
+	 * than testing each byte, so that the hashing loop below has
+	 * nothing else to do.
+	 */
+	eol = memchr(ptr, '\n', top - ptr);
+	if (!eol)
+		eol = top;
+	for (; ptr < eol; ptr++) {
 		ha += (ha << 5);
 		ha ^= (unsigned long) *ptr;
 	}
-	*data = ptr < top ? ptr + 1: ptr;
+	*data = eol < top ? eol + 1: eol;
 
 	return ha;
 }